@@ -24,6 +24,9 @@ class ProxyPDF(ConanFile):
         # String Formatting
         self.requires("fmt/12.1.0")
 
+        # Fast Hashing
+        self.requires("xxhash/0.8.3")
+
         # Enum Reflection
         self.requires("magic_enum/0.9.7")
 
@@ -33,6 +36,9 @@ class ProxyPDF(ConanFile):
         # Unzipping during Auto-Update
         self.requires("libarchive/3.8.7")
 
+        # Fast Compression of intermediate images
+        self.requires("zstd/1.5.7", force=True)
+
         # Find executable without QCoreApplication
         self.requires("whereami/cci.20220112")
 
@@ -43,7 +49,6 @@ class ProxyPDF(ConanFile):
         self.requires("catch2/3.7.1")
 
         # Conflict Resolution
-        self.requires("zstd/1.5.7", override=True)
         self.requires("openjpeg/2.5.2", override=True)
         self.requires("icu/74.2", override=True)
         self.requires("libjpeg/9f", override=True)
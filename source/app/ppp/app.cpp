@@ -98,17 +98,17 @@ const std::string& PrintProxyPrepApplication::GetTheme() const
     return m_Theme;
 }
 
-void PrintProxyPrepApplication::SetCube(std::string cube_name, cv::Mat cube)
+void PrintProxyPrepApplication::SetCube(std::string cube_name, const cv::Mat& cube)
 {
     TRACY_AUTO_SCOPE();
     TRACY_SCOPED_LOCK(m_CubesMutex);
 
     if (!m_Cubes.contains(cube_name))
     {
-        m_Cubes[std::move(cube_name)] = std::move(cube);
+        m_Cubes.try_emplace(std::move(cube_name), cube);
     }
 }
-const cv::Mat* PrintProxyPrepApplication::GetCube(const std::string& cube_name) const
+const ColorCubeLut* PrintProxyPrepApplication::GetCube(const std::string& cube_name) const
 {
     TRACY_AUTO_SCOPE();
     TRACY_SCOPED_LOCK(m_CubesMutex);
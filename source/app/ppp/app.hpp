@@ -9,6 +9,7 @@
 
 #include <nlohmann/json_fwd.hpp>
 
+#include <ppp/color_cube_lut.hpp>
 #include <ppp/constants.hpp>
 #include <ppp/json_util.hpp>
 #include <ppp/util.hpp>
@@ -42,8 +43,9 @@ class PrintProxyPrepApplication
     void SetTheme(std::string theme);
     const std::string& GetTheme() const;
 
-    void SetCube(std::string cube_name, cv::Mat cube);
-    const cv::Mat* GetCube(const std::string& cube_name) const;
+    // Cubes are only kept in their prepared form, ready to be applied to images
+    void SetCube(std::string cube_name, const cv::Mat& cube);
+    const ColorCubeLut* GetCube(const std::string& cube_name) const;
 
     void SetUpscaleModel(std::string model_name, std::unique_ptr<Ort::Session> model);
     std::unique_ptr<Ort::Session> ReleaseUpscaleModel(std::string model_name);
@@ -71,7 +73,7 @@ class PrintProxyPrepApplication
     std::string m_Theme{ "Default" };
 
     mutable TRACY_DECLARE_MUTEX(std::mutex, m_CubesMutex);
-    std::unordered_map<std::string, cv::Mat> m_Cubes;
+    std::unordered_map<std::string, ColorCubeLut> m_Cubes;
 
     mutable std::mutex m_ModelsMutex;
     std::unordered_map<std::string, std::unique_ptr<Ort::Session>> m_Models;
@@ -56,7 +56,7 @@ void PreloadCube(std::string_view cube_name)
     application.SetCube(std::string{ cube_name }, LoadColorCube(cube_path));
 }
 
-const cv::Mat* GetCubeImage(std::string_view cube_name)
+const ColorCubeLut* GetCubeImage(std::string_view cube_name)
 {
     PreloadCube(cube_name);
 
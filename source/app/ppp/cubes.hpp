@@ -4,11 +4,8 @@
 #include <string_view>
 #include <vector>
 
-namespace cv
-{
-class Mat;
-}
+class ColorCubeLut;
 
 std::vector<std::string> GetCubeNames();
 void PreloadCube(std::string_view cube_name);
-const cv::Mat* GetCubeImage(std::string_view cube_name);
+const ColorCubeLut* GetCubeImage(std::string_view cube_name);
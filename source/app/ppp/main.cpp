@@ -6,7 +6,6 @@
 #include <QDesktopServices>
 #include <QLayout>
 #include <QMessageBox>
-#include <QThreadPool>
 
 #include <QtPlugin>
 #ifdef WIN32
@@ -32,8 +31,12 @@ Q_IMPORT_PLUGIN(QSvgIconPlugin)
 #include <ppp/app.hpp>
 #include <ppp/auto_update.hpp>
 #include <ppp/cubes.hpp>
+#include <ppp/image_allocator.hpp>
 #include <ppp/style.hpp>
+#include <ppp/upscale_cache.hpp>
+#include <ppp/upscale_models.hpp>
 #include <ppp/version_check.hpp>
+#include <ppp/worker_pools.hpp>
 
 #include <ppp/qt_util.hpp>
 #include <ppp/util/log.hpp>
@@ -252,6 +255,7 @@ int main(int argc, char** argv)
     QObject::connect(&plugin_router, &PluginRouter::PauseCropper, &cropper, &Cropper::PauseWork);
     QObject::connect(&plugin_router, &PluginRouter::UnpauseCropper, &cropper, &Cropper::RestartWork);
     QObject::connect(&plugin_router, &PluginRouter::RefreshCardGrid, card_area, &CardArea::FullRefresh);
+    QObject::connect(&plugin_router, &PluginRouter::CardImageDecoded, &cropper, &Cropper::CardImageDecoded);
 
     QObject::connect(
         &plugin_router,
@@ -760,6 +764,10 @@ int main(int argc, char** argv)
         // Write preview cache to file
         QObject::connect(&cropper, &Cropper::PreviewWorkDone, &project, &Project::CropperDone);
 
+        // Generate previews of the cards the user is looking at first
+        QObject::connect(card_area, &CardArea::VisibleCardsChanged, &cropper, &Cropper::CardsVisible);
+        QObject::connect(print_preview, &PrintPreview::VisibleCardsChanged, &cropper, &Cropper::CardsVisible);
+
         // Toast to user when crop work is done
         QObject::connect(&cropper,
                          &Cropper::CropWorkDone,
@@ -797,6 +805,8 @@ int main(int argc, char** argv)
                          });
     }
 
+    InstallPooledImageAllocator();
+
     {
         TRACY_AUTO_SCOPE();
         TRACY_SCOPE_NAME(set_max_worker_threads);
@@ -804,11 +814,17 @@ int main(int argc, char** argv)
         auto apply_max_worker_threads{
             [&config]()
             {
-                QThreadPool::globalInstance()->setMaxThreadCount(config.m_MaxWorkerThreads);
+                ApplyMaxWorkerThreads(config.m_MaxWorkerThreads);
+                ApplyUpscaleSessionOptions(config);
             }
         };
         apply_max_worker_threads();
         QObject::connect(&config, &Config::MaxWorkerThreadsChanged, main_window, apply_max_worker_threads);
+
+        ApplyMaxWorkerMemory(config.m_MaxWorkerMemory);
+        QObject::connect(&config, &Config::MaxWorkerMemoryChanged, main_window, &ApplyMaxWorkerMemory);
+
+        ApplyUpscaleCacheSize(config.m_UpscaleCacheSize);
     }
 
     {
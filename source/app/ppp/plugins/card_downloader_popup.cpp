@@ -15,7 +15,6 @@
 #include <QNetworkReply>
 #include <QProgressBar>
 #include <QPushButton>
-#include <QThreadPool>
 
 #include <ppp/project/image_ops.hpp>
 #include <ppp/project/project.hpp>
@@ -23,12 +22,15 @@
 #include <ppp/app.hpp>
 #include <ppp/config.hpp>
 #include <ppp/qt_util.hpp>
+#include <ppp/upscale_cache.hpp>
 #include <ppp/upscale_models.hpp>
+#include <ppp/worker_pools.hpp>
 
 #include <ppp/ui/main_window.hpp>
 #include <ppp/ui/widget_util/widget_label.hpp>
 
 #include <ppp/plugins/decklist_textbox.hpp>
+#include <ppp/plugins/download_scheduler.hpp>
 #include <ppp/plugins/plugin_interface.hpp>
 
 CardDownloaderImageWorker::CardDownloaderImageWorker(const Project& project,
@@ -52,51 +54,105 @@ CardDownloaderImageWorker::CardDownloaderImageWorker(const Project& project,
 
 void CardDownloaderImageWorker::run()
 {
+    // Re-downloading the same card with the same settings is common, e.g. when importing
+    // an updated MPCFill xml, so upscaled results are cached by the downloaded data
+    const std::optional<UpscaleCacheKey> cache_key{
+        !m_UpscaleModel.isEmpty()
+            ? std::optional{ MakeUpscaleCacheKey(m_ImageData,
+                                                 m_UpscaleModel.toStdString(),
+                                                 m_PhysicalCardSize,
+                                                 m_MaxDensity,
+                                                 m_FillCorners,
+                                                 m_Project.CardCornerRadius()) }
+            : std::nullopt
+    };
+    if (cache_key.has_value())
+    {
+        if (auto cached_data{ ReadUpscaleCache(cache_key.value()) })
+        {
+            LogInfo("Using cached upscale of card image {}", m_ImageName.toStdString());
+            m_ImageData = std::move(cached_data).value();
+            WriteOutFiles();
+            Done(nullptr);
+            return;
+        }
+    }
+
+    if (!m_FillCorners && m_UpscaleModel.isEmpty())
+    {
+        // Nothing to do, so the downloaded data is written as is
+        WriteOutFiles();
+        Done(nullptr);
+        return;
+    }
+
+    // The image is decoded and encoded only once, no matter how many steps run
+    Image image{
+        Image::Decode(EncodedImageView{
+            reinterpret_cast<const std::byte*>(m_ImageData.constData()),
+            static_cast<size_t>(m_ImageData.size()),
+        }),
+    };
+
     if (m_FillCorners)
     {
         LogInfo("Filling corners of image {}...", m_ImageName.toStdString());
-
-        auto image{
-            Image::Decode(EncodedImageView{
-                reinterpret_cast<const std::byte*>(m_ImageData.constData()),
-                static_cast<size_t>(m_ImageData.size()),
-            }),
-        };
-        const auto image_with_corners{
-            image.FillCorners(m_Project.CardSize(), m_Project.CardCornerRadius() * 1.65f)
-        };
-        const auto encoded_image{ image_with_corners.EncodePng() };
-        m_ImageData.assign((const char*)encoded_image.data(), (const char*)encoded_image.data() + encoded_image.size());
+        image = image.FillCorners(m_Project.CardSize(), m_Project.CardCornerRadius() * 1.65f);
     }
 
     if (!m_UpscaleModel.isEmpty())
     {
         LogInfo("Upscaling card image {}", m_ImageName.toStdString());
 
-        auto image{
-            Image::Decode(EncodedImageView{
-                reinterpret_cast<const std::byte*>(m_ImageData.constData()),
-                static_cast<size_t>(m_ImageData.size()),
-            }),
-        };
-
         auto* app{ static_cast<PrintProxyPrepApplication*>(qApp) };
-        auto upscaled_image{ RunModel(*app, m_UpscaleModel.toStdString(), image, m_PhysicalCardSize, m_MaxDensity) };
+        image = RunModel(*app, m_UpscaleModel.toStdString(), image, m_PhysicalCardSize, m_MaxDensity);
+    }
 
-        const auto encoded_image{ upscaled_image.EncodePng() };
-        m_ImageData.assign((const char*)encoded_image.data(), (const char*)encoded_image.data() + encoded_image.size());
+    const auto encoded_image{ image.EncodePng() };
+    m_ImageData.assign((const char*)encoded_image.data(), (const char*)encoded_image.data() + encoded_image.size());
+
+    if (cache_key.has_value())
+    {
+        WriteUpscaleCache(cache_key.value(), m_ImageData);
     }
 
-    for (const auto& out_file : m_OutFiles)
+    WriteOutFiles();
+    Done(std::make_shared<const Image>(std::move(image)));
+}
+
+void CardDownloaderImageWorker::WriteOutFiles()
+{
+    if (m_OutFiles.empty())
     {
-        LogInfo("Writing image {}...", m_ImageName.toStdString());
+        return;
+    }
 
-        QFile file(out_file);
+    LogInfo("Writing image {}...", m_ImageName.toStdString());
+
+    const QString& first_file{ m_OutFiles.front() };
+    {
+        QFile file(first_file);
         file.open(QIODevice::WriteOnly);
         file.write(m_ImageData);
     }
 
-    Done();
+    // Duplicates share the data of the first file, unless the file system can't link
+    const fs::path first_path{ first_file.toStdString() };
+    for (const auto& out_file : m_OutFiles | std::views::drop(1))
+    {
+        const fs::path out_path{ out_file.toStdString() };
+
+        std::error_code error;
+        fs::create_hard_link(first_path, out_path, error);
+        if (error)
+        {
+            fs::copy_file(first_path, out_path, fs::copy_options::overwrite_existing, error);
+        }
+        if (error)
+        {
+            LogError("Failed writing duplicate image {}: {}", out_path.string(), error.message());
+        }
+    }
 }
 
 CardDownloaderPopup::CardDownloaderPopup(QWidget* parent,
@@ -225,6 +281,9 @@ void CardDownloaderPopup::ImageAvailable(const QByteArray& image_data, const QSt
         out_file = m_OutputDir.filePath(out_file);
     }
 
+    std::vector<QString> card_names{ m_Downloader->GetDuplicates(file_name) };
+    card_names.insert(card_names.begin(), file_name);
+
     auto* worker{ new CardDownloaderImageWorker{
         m_Project,
         file_name,
@@ -238,8 +297,22 @@ void CardDownloaderPopup::ImageAvailable(const QByteArray& image_data, const QSt
     QObject::connect(worker,
                      &CardDownloaderImageWorker::Done,
                      this,
-                     [this]()
+                     [this, card_names = std::move(card_names)](std::shared_ptr<const Image> image)
                      {
+                         if (image != nullptr)
+                         {
+                             const cv::Mat& underlying{ image->GetUnderlying() };
+                             const uint64_t image_memory{ underlying.total() * underlying.elemSize() };
+                             if (m_DecodedImagesMemory + image_memory <= c_MaxDecodedImagesMemory)
+                             {
+                                 m_DecodedImagesMemory += image_memory;
+                                 for (const auto& card_name : card_names)
+                                 {
+                                     m_DecodedImages[card_name] = image;
+                                 }
+                             }
+                         }
+
                          m_WaitingForImages--;
                          if (m_DownloaderDone)
                          {
@@ -253,7 +326,7 @@ void CardDownloaderPopup::ImageAvailable(const QByteArray& image_data, const QSt
 
     m_WaitingForImages++;
     m_TotalImages++;
-    QThreadPool::globalInstance()->start(worker);
+    StartWork(WorkerPool::Download, worker);
 }
 
 void CardDownloaderPopup::StartDownload()
@@ -310,11 +383,6 @@ void CardDownloaderPopup::StartDownload()
 
             if (m_Downloader->ParseInput(m_TextInput->toPlainText()))
             {
-                connect(m_NetworkManager.get(),
-                        &QNetworkAccessManager::finished,
-                        m_Downloader.get(),
-                        &CardArtDownloader::HandleReply);
-
                 connect(m_Downloader.get(),
                         &CardArtDownloader::Progress,
                         this,
@@ -324,7 +392,8 @@ void CardDownloaderPopup::StartDownload()
                         this,
                         &CardDownloaderPopup::ImageAvailable);
 
-                if (m_Downloader->BeginDownload(*m_NetworkManager))
+                m_Scheduler = std::make_unique<DownloadScheduler>(*m_NetworkManager);
+                if (m_Downloader->BeginDownload(*m_Scheduler))
                 {
                     m_ProgressBar->setVisible(true);
                 }
@@ -404,6 +473,12 @@ void CardDownloaderPopup::StartDownload()
 
 void CardDownloaderPopup::FinalizeDownload()
 {
+    LogWorkerPoolStats("Download finished");
+    if (m_Scheduler != nullptr)
+    {
+        m_Scheduler->LogStats("Download finished");
+    }
+
     const auto upscale_model{ UpscaleModel().toStdString() };
     if (!upscale_model.empty())
     {
@@ -464,6 +539,11 @@ void CardDownloaderPopup::FinalizeDownload()
         if (fs::exists(output_dir / path))
         {
             fs::rename(output_dir / path, target_dir / path);
+
+            if (auto it{ m_DecodedImages.find(card) }; it != m_DecodedImages.end())
+            {
+                m_Router.CardImageDecoded(path, std::move(it->second));
+            }
         }
 
         m_Project.CardAdded(path);
@@ -479,6 +559,9 @@ void CardDownloaderPopup::FinalizeDownload()
         }
     }
 
+    m_DecodedImages.clear();
+    m_DecodedImagesMemory = 0;
+
     if (DownloadBacksides())
     {
         m_Project.SetBacksideDefault(m_Downloader->DefaultBackside().toStdString());
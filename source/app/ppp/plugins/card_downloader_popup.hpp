@@ -2,10 +2,12 @@
 
 #include <memory>
 #include <optional>
+#include <unordered_map>
 
 #include <QRunnable>
 #include <QTemporaryDir>
 
+#include <ppp/image.hpp>
 #include <ppp/ui/popups/popups.hpp>
 #include <ppp/util.hpp>
 
@@ -22,6 +24,7 @@ class QNetworkReply;
 class Project;
 class PluginInterface;
 class DecklistTextEdit;
+class DownloadScheduler;
 
 class CardDownloaderImageWorker : public QObject, public QRunnable
 {
@@ -40,9 +43,12 @@ class CardDownloaderImageWorker : public QObject, public QRunnable
     virtual void run() override;
 
   signals:
-    void Done();
+    // Carries the decoded image if the worker had to decode it anyways
+    void Done(std::shared_ptr<const Image> image);
 
   private:
+    void WriteOutFiles();
+
     const Project& m_Project;
     QString m_ImageName;
     QByteArray m_ImageData;
@@ -93,6 +99,7 @@ class CardDownloaderPopup : public PopupBase
     QString OutputDir() const;
 
     std::unique_ptr<QNetworkAccessManager> m_NetworkManager{ nullptr };
+    std::unique_ptr<DownloadScheduler> m_Scheduler{ nullptr };
 
     DecklistTextEdit* m_TextInput{ nullptr };
     QLabel* m_Hint{ nullptr };
@@ -119,4 +126,10 @@ class CardDownloaderPopup : public PopupBase
     std::optional<uint32_t> m_LogHookId{ std::nullopt };
 
     std::unique_ptr<CardArtDownloader> m_Downloader;
+
+    // Decoded images are handed to the cropper once the download is finalized,
+    // images beyond the memory limit are left for the cropper to read again
+    static inline constexpr uint64_t c_MaxDecodedImagesMemory{ 1024ull * 1024 * 1024 };
+    std::unordered_map<QString, std::shared_ptr<const Image>> m_DecodedImages;
+    uint64_t m_DecodedImagesMemory{ 0 };
 };
@@ -7,8 +7,7 @@
 #include <QObject>
 #include <QString>
 
-class QNetworkAccessManager;
-class QNetworkReply;
+class DownloadScheduler;
 
 class CardArtDownloader : public QObject
 {
@@ -20,8 +19,9 @@ class CardArtDownloader : public QObject
     virtual ~CardArtDownloader() = default;
 
     virtual bool ParseInput(const QString& xml) = 0;
-    virtual bool BeginDownload(QNetworkAccessManager& network_manager) = 0;
-    virtual void HandleReply(QNetworkReply* reply) = 0;
+    // All requests go through the scheduler, downloaders set the policies for the
+    // hosts they talk to before making requests
+    virtual bool BeginDownload(DownloadScheduler& scheduler) = 0;
 
     virtual std::vector<QString> GetFiles() const = 0;
 
@@ -3,16 +3,13 @@
 #include <ranges>
 
 #include <QDomDocument>
-#include <QMetaEnum>
-#include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QRegularExpression>
 
-#include <ppp/qt_util.hpp>
-#include <ppp/version.hpp>
-
 #include <ppp/util/log.hpp>
 
+#include <ppp/plugins/download_scheduler.hpp>
+
 MPCFillDownloader::MPCFillDownloader(std::vector<QString> skip_files,
                                      const std::optional<QString>& backside_pattern)
     : CardArtDownloader{ std::move(skip_files), backside_pattern }
@@ -187,18 +184,28 @@ bool MPCFillDownloader::ParseInput(const QString& xml)
     return true;
 }
 
-bool MPCFillDownloader::BeginDownload(QNetworkAccessManager& network_manager)
+bool MPCFillDownloader::BeginDownload(DownloadScheduler& scheduler)
 {
     if (m_Set.m_Frontsides.empty())
     {
         return false;
     }
 
-    m_NetworkManager = &network_manager;
+    scheduler.SetHostPolicy("cdn.mpcautofill.com",
+                            DownloadHostPolicy{
+                                .m_MaxInFlight = 15,
+                            });
+
+    struct PendingRequest
+    {
+        QString m_Name;
+        QString m_Uri;
+    };
+    std::vector<PendingRequest> pending_requests{};
 
     std::vector<QString> requested_ids{};
     auto queue_download{
-        [this, &requested_ids](const QString& name, const QString& id)
+        [this, &requested_ids, &pending_requests](const QString& name, const QString& id)
         {
             if (std::ranges::contains(requested_ids, id))
             {
@@ -216,7 +223,7 @@ bool MPCFillDownloader::BeginDownload(QNetworkAccessManager& network_manager)
                 "https://cdn.mpcautofill.com/images/google_drive/full/%1.jpg?dpi=1500&jpgQuality=100"
             };
             auto request_uri{ QString(c_DirectDownload).arg(id) };
-            m_PendingRequests.push_back({
+            pending_requests.push_back({
                 name,
                 request_uri,
             });
@@ -237,52 +244,26 @@ bool MPCFillDownloader::BeginDownload(QNetworkAccessManager& network_manager)
         queue_download("__back.jpg", m_Set.m_BacksideId.value());
     }
 
-    m_TotalRequests = m_PendingRequests.size();
+    m_TotalRequests = pending_requests.size();
     Progress(0, static_cast<int>(m_TotalRequests));
 
-    constexpr auto c_MaxDownloadsInFlight{ 15 };
-    for (size_t i = 0; i < c_MaxDownloadsInFlight; ++i)
+    for (auto& [name, request_uri] : pending_requests)
     {
-        PushSingleRequest();
+        LogInfo("Requesting card {}", name.toStdString());
+        scheduler.Get(DownloadScheduler::MakeRequest(request_uri),
+                      [this, name](QNetworkReply* reply)
+                      {
+                          ImageAvailable(reply->readAll(), name);
+
+                          ++m_FinishedRequests;
+                          Progress(static_cast<int>(m_FinishedRequests),
+                                   static_cast<int>(m_TotalRequests));
+                      });
     }
 
     return true;
 }
 
-void MPCFillDownloader::HandleReply(QNetworkReply* reply)
-{
-    const auto file_name{
-        [this, reply]()
-        {
-            const QString id{ MPCFillIdFromUrl(reply->request().url().toString()) };
-            for (const auto& card : m_Set.m_Frontsides)
-            {
-                if (card.m_Id == id)
-                {
-                    return card.m_Name;
-                }
-
-                if (card.m_Backside.has_value() && card.m_Backside.value().m_Id == id)
-                {
-                    return card.m_Backside.value().m_Name;
-                }
-            }
-
-            return QString{ "__back.jpg" };
-        }()
-    };
-
-    ImageAvailable(reply->readAll(), file_name);
-
-    ++m_FinishedRequests;
-    Progress(static_cast<int>(m_FinishedRequests),
-             static_cast<int>(m_TotalRequests));
-
-    reply->deleteLater();
-
-    PushSingleRequest();
-}
-
 std::vector<QString> MPCFillDownloader::GetFiles() const
 {
     auto frontsides{
@@ -345,11 +326,6 @@ bool MPCFillDownloader::ProvidesBleedEdge() const
     return true;
 }
 
-QString MPCFillDownloader::MPCFillIdFromUrl(const QString& url)
-{
-    return url.split("full/").back().split(".jpg?").front();
-}
-
 MPCFillDownloader::CardParseResult MPCFillDownloader::ParseMPCFillCard(const QDomElement& element)
 {
     auto name{ element.firstChildElement("name").text() };
@@ -386,37 +362,3 @@ MPCFillDownloader::CardParseResult MPCFillDownloader::ParseMPCFillCard(const QDo
         .m_Slots = std::move(slots_uint),
     };
 }
-
-bool MPCFillDownloader::PushSingleRequest()
-{
-    if (m_PendingRequests.empty())
-    {
-        return false;
-    }
-
-    auto [name, request_uri]{ m_PendingRequests.back() };
-    m_PendingRequests.pop_back();
-
-    LogInfo("Requesting card {}", name.toStdString());
-
-    QNetworkRequest get_request{ std::move(request_uri) };
-    get_request.setHeader(QNetworkRequest::KnownHeaders::UserAgentHeader,
-                          ToQString(fmt::format("Proxy-PDF-Maker/{}", ProxyPdfVersion())));
-    get_request.setRawHeader("Accept",
-                             "*/*");
-
-    QNetworkReply* reply{ m_NetworkManager->get(std::move(get_request)) };
-
-    QObject::connect(reply,
-                     &QNetworkReply::errorOccurred,
-                     reply,
-                     [reply](QNetworkReply::NetworkError error)
-                     {
-                         LogError("Error during request {} {}: {}",
-                                  reply->request().url().toEncoded().toStdString(),
-                                  reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(),
-                                  QMetaEnum::fromType<QNetworkReply::NetworkError>().valueToKey(error));
-                     });
-
-    return true;
-}
@@ -15,8 +15,7 @@ class MPCFillDownloader : public CardArtDownloader
                       const std::optional<QString>& backside_pattern);
 
     virtual bool ParseInput(const QString& xml) override;
-    virtual bool BeginDownload(QNetworkAccessManager& network_manager) override;
-    virtual void HandleReply(QNetworkReply* reply) override;
+    virtual bool BeginDownload(DownloadScheduler& scheduler) override;
 
     virtual std::vector<QString> GetFiles() const override;
 
@@ -52,23 +51,12 @@ class MPCFillDownloader : public CardArtDownloader
         MPCFillCard m_Card;
         QList<uint32_t> m_Slots;
     };
-    struct PendingRequest
-    {
-        QString m_Name;
-        QString m_Uri;
-    };
 
-    static QString MPCFillIdFromUrl(const QString& url);
     static CardParseResult ParseMPCFillCard(const QDomElement& element);
 
-    bool PushSingleRequest();
-
     MPCFillSet m_Set{};
     std::unordered_map<QString, std::vector<QString>> m_Duplicates;
 
-    QNetworkAccessManager* m_NetworkManager{ nullptr };
-
     size_t m_TotalRequests{};
     size_t m_FinishedRequests{};
-    std::vector<PendingRequest> m_PendingRequests{};
 };
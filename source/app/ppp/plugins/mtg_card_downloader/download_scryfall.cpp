@@ -52,15 +52,17 @@ bool ScryfallDownloader::ParseInput(const QString& input)
     return true;
 }
 
-bool ScryfallDownloader::BeginDownload(QNetworkAccessManager& network_manager)
+bool ScryfallDownloader::BeginDownload(DownloadScheduler& scheduler)
 {
-    m_CollectionEndpoint = std::make_unique<ScryfallCollectionEndpoint>(network_manager);
+    ScryfallEndpoint::ApplyHostPolicies(scheduler);
+
+    m_CollectionEndpoint = std::make_unique<ScryfallCollectionEndpoint>(scheduler);
     QObject::connect(m_CollectionEndpoint.get(),
                      &ScryfallEndpoint::OnError,
                      this,
                      &ScryfallDownloader::OnError);
 
-    m_DataEndpoint = std::make_unique<ScryfallDataEndpoint>(network_manager);
+    m_DataEndpoint = std::make_unique<ScryfallDataEndpoint>(scheduler);
     QObject::connect(m_DataEndpoint.get(),
                      &ScryfallEndpoint::OnError,
                      this,
@@ -68,7 +70,7 @@ bool ScryfallDownloader::BeginDownload(QNetworkAccessManager& network_manager)
 
     if (!m_Queries.empty())
     {
-        m_SearchEndpoint = std::make_unique<ScryfallSearchEndpoint>(network_manager);
+        m_SearchEndpoint = std::make_unique<ScryfallSearchEndpoint>(scheduler);
         QObject::connect(m_SearchEndpoint.get(),
                          &ScryfallEndpoint::OnError,
                          this,
@@ -88,10 +90,6 @@ bool ScryfallDownloader::BeginDownload(QNetworkAccessManager& network_manager)
     return true;
 }
 
-void ScryfallDownloader::HandleReply(QNetworkReply* /*reply*/)
-{
-}
-
 std::vector<QString> ScryfallDownloader::GetFiles() const
 {
     auto cards{ m_Cards |
@@ -7,8 +7,6 @@
 
 #include <ppp/plugins/download_interface.hpp>
 
-class QNetworkAccessManager;
-class QNetworkReply;
 class QJsonDocument;
 
 struct DecklistCard;
@@ -28,8 +26,7 @@ class ScryfallDownloader : public CardArtDownloader
     virtual ~ScryfallDownloader() override;
 
     virtual bool ParseInput(const QString& input) override;
-    virtual bool BeginDownload(QNetworkAccessManager& network_manager) override;
-    virtual void HandleReply(QNetworkReply* reply) override;
+    virtual bool BeginDownload(DownloadScheduler& scheduler) override;
 
     virtual std::vector<QString> GetFiles() const override;
 
@@ -2,38 +2,40 @@
 
 #include <QByteArray>
 #include <QJsonArray>
-#include <QMetaEnum>
-#include <QNetworkAccessManager>
 #include <QNetworkReply>
 
-#include <ppp/qt_util.hpp>
-#include <ppp/version.hpp>
-
 #include <ppp/util/log.hpp>
 
-ScryfallEndpoint::ScryfallEndpoint(QNetworkAccessManager& network_manager,
-                                   QString endpoint_name,
-                                   std::chrono::milliseconds rate_limit)
-    : m_NetworkManager{ network_manager }
-    , m_EndpointName{ std::move(endpoint_name) }
+#include <ppp/plugins/download_scheduler.hpp>
+
+ScryfallEndpoint::ScryfallEndpoint(DownloadScheduler& scheduler)
+    : m_Scheduler{ scheduler }
 {
-    if (rate_limit.count() > 0)
-    {
-        static constexpr auto c_RateLimitBuffer{ 1.1f };
+}
 
-        m_RateLimiter.emplace();
-        m_RateLimiter.value().setInterval(static_cast<int>(rate_limit.count() * c_RateLimitBuffer));
-        m_RateLimiter.value().setSingleShot(true);
+ScryfallEndpoint::~ScryfallEndpoint() = default;
 
-        QObject::connect(&m_RateLimiter.value(),
-                         &QTimer::timeout,
-                         this,
-                         &ScryfallEndpoint::Available);
+void ScryfallEndpoint::ApplyHostPolicies(DownloadScheduler& scheduler)
+{
+    // The api asks for no more than 2 requests per second to search and collection
+    // endpoints, we keep a bit of a buffer to that
+    scheduler.SetHostPolicy("api.scryfall.com",
+                            DownloadHostPolicy{
+                                .m_MaxInFlight = 2,
+                                .m_RequestsPerSecond = 1.8f,
+                                .m_Burst = 1,
+                            });
+
+    // Image hosts have no rate limits
+    for (const auto* host : { "cards.scryfall.io", "backs.scryfall.io" })
+    {
+        scheduler.SetHostPolicy(host,
+                                DownloadHostPolicy{
+                                    .m_MaxInFlight = 8,
+                                });
     }
 }
 
-ScryfallEndpoint::~ScryfallEndpoint() = default;
-
 void ScryfallEndpoint::QueueRequest(QString request_uri, OnDoneFun on_done, QJsonDocument body)
 {
     if (request_uri.isEmpty())
@@ -44,12 +46,7 @@ void ScryfallEndpoint::QueueRequest(QString request_uri, OnDoneFun on_done, QJso
 
     LogInfo("Doing request \"{}\"...", request_uri.toStdString());
 
-    QNetworkRequest request{ std::move(request_uri) };
-    request.setHeader(QNetworkRequest::KnownHeaders::UserAgentHeader,
-                      ToQString(fmt::format("Proxy-PDF-Maker/{}", ProxyPdfVersion())));
-    request.setRawHeader("Accept",
-                         "*/*");
-
+    QNetworkRequest request{ DownloadScheduler::MakeRequest(request_uri) };
     if (!body.isNull())
     {
         request.setHeader(QNetworkRequest::ContentTypeHeader,
@@ -62,79 +59,29 @@ void ScryfallEndpoint::QueueRequest(QString request_uri, OnDoneFun on_done, QJso
 }
 void ScryfallEndpoint::QueueRequest(QNetworkRequest request, OnDoneFun on_done, QByteArray body)
 {
-
-    if (m_RateLimiter.has_value() && m_RateLimiter.value().isActive())
-    {
-        m_RequestQueue.push_back({ std::move(request), std::move(on_done), std::move(body) });
-        return;
-    }
-
-    DoRequest(std::move(request), std::move(on_done), std::move(body));
-}
-
-void ScryfallEndpoint::DoRequest(QNetworkRequest request, OnDoneFun on_done, QByteArray body)
-{
-    QNetworkReply* reply{
-        body.isEmpty() ? m_NetworkManager.get(std::move(request))
-                       : m_NetworkManager.post(std::move(request), std::move(body))
-    };
-
-    QObject::connect(reply,
-                     &QNetworkReply::errorOccurred,
-                     reply,
-                     [this, reply](QNetworkReply::NetworkError error)
-                     {
-                         LogError("Error during request {} {}: {}",
-                                  reply->request().url().toEncoded().toStdString(),
-                                  reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(),
-                                  QMetaEnum::fromType<QNetworkReply::NetworkError>().valueToKey(error));
-                         OnError();
-                     });
-    QObject::connect(reply,
-                     &QNetworkReply::finished,
-                     this,
-                     [reply, on_done = std::move(on_done)]()
-                     { on_done(reply); });
-
-    if (m_RateLimiter.has_value())
-    {
-        if (m_LastCall.has_value())
+    auto handle_reply{
+        [this, on_done = std::move(on_done)](QNetworkReply* reply)
         {
-            const auto now{ std::chrono::high_resolution_clock::now() };
-            const auto since_last{ now - m_LastCall.value() };
-            const auto ms_since_last{ std::chrono::duration_cast<std::chrono::milliseconds>(since_last).count() };
-            m_LastCall = now;
-
-            const auto interval{ m_RateLimiter.value().interval() };
-            if (ms_since_last < interval * 3)
+            if (reply->error() != QNetworkReply::NoError)
             {
-                LogInfo("{}, {}ms passed, out of {}ms",
-                        m_EndpointName.toStdString(),
-                        ms_since_last,
-                        interval);
+                OnError();
             }
+            on_done(reply);
         }
-        else
-        {
-            m_LastCall = std::chrono::high_resolution_clock::now();
-        }
+    };
 
-        m_RateLimiter.value().start();
+    if (body.isEmpty())
+    {
+        m_Scheduler.Get(std::move(request), std::move(handle_reply));
     }
-}
-
-void ScryfallEndpoint::Available()
-{
-    if (!m_RequestQueue.empty())
+    else
     {
-        auto& [request, on_done, body]{ m_RequestQueue.front() };
-        DoRequest(std::move(request), std::move(on_done), std::move(body));
-        m_RequestQueue.pop_front();
+        m_Scheduler.Post(std::move(request), std::move(body), std::move(handle_reply));
     }
 }
 
-ScryfallSearchEndpoint::ScryfallSearchEndpoint(QNetworkAccessManager& network_manager)
-    : ScryfallEndpoint{ network_manager, "api.scryfall.com/cards/search", std::chrono::milliseconds{ 500 } }
+ScryfallSearchEndpoint::ScryfallSearchEndpoint(DownloadScheduler& scheduler)
+    : ScryfallEndpoint{ scheduler }
 {
 }
 
@@ -204,8 +151,6 @@ void ScryfallSearchEndpoint::HandleReply(QNetworkReply* reply)
             DoRequest();
         }
     }
-
-    reply->deleteLater();
 }
 
 void ScryfallSearchEndpoint::DoRequest()
@@ -215,8 +160,8 @@ void ScryfallSearchEndpoint::DoRequest()
                                    std::bind_front(&ScryfallSearchEndpoint::HandleReply, this));
 }
 
-ScryfallCollectionEndpoint::ScryfallCollectionEndpoint(QNetworkAccessManager& network_manager)
-    : ScryfallEndpoint{ network_manager, "api.scryfall.com/cards/collection", std::chrono::milliseconds{ 500 } }
+ScryfallCollectionEndpoint::ScryfallCollectionEndpoint(DownloadScheduler& scheduler)
+    : ScryfallEndpoint{ scheduler }
 {
 }
 
@@ -229,8 +174,8 @@ void ScryfallCollectionEndpoint::Queue(QJsonDocument batch, OnDoneFun on_done)
         batch);
 }
 
-ScryfallDataEndpoint::ScryfallDataEndpoint(QNetworkAccessManager& network_manager)
-    : ScryfallEndpoint{ network_manager, "*.scryfall.io", std::chrono::milliseconds{ 0 } }
+ScryfallDataEndpoint::ScryfallDataEndpoint(DownloadScheduler& scheduler)
+    : ScryfallEndpoint{ scheduler }
 {
 }
 
@@ -1,6 +1,5 @@
 #pragma once
 
-#include <chrono>
 #include <deque>
 #include <functional>
 #include <optional>
@@ -10,22 +9,24 @@
 #include <QNetworkRequest>
 #include <QObject>
 #include <QString>
-#include <QTimer>
 
-class QNetworkAccessManager;
 class QNetworkReply;
 class QNetworkRequest;
 
+class DownloadScheduler;
+
+// Rate limits are not handled by the endpoints, instead they are part of the policy
+// for each host, see ScryfallEndpoint::ApplyHostPolicies
 class ScryfallEndpoint : public QObject
 {
     Q_OBJECT
 
   public:
-    ScryfallEndpoint(QNetworkAccessManager& network_manager,
-                     QString endpoint_name,
-                     std::chrono::milliseconds rate_limit);
+    ScryfallEndpoint(DownloadScheduler& scheduler);
     virtual ~ScryfallEndpoint();
 
+    static void ApplyHostPolicies(DownloadScheduler& scheduler);
+
   signals:
     void OnError();
 
@@ -35,22 +36,7 @@ class ScryfallEndpoint : public QObject
     void QueueRequest(QNetworkRequest request, OnDoneFun on_done, QByteArray body = {});
 
   private:
-    void DoRequest(QNetworkRequest request, OnDoneFun on_done, QByteArray body);
-    void Available();
-
-    QNetworkAccessManager& m_NetworkManager;
-    QString m_EndpointName;
-    std::optional<std::chrono::time_point<std::chrono::high_resolution_clock>> m_LastCall;
-    std::optional<QTimer> m_RateLimiter;
-
-    struct QueuedRequest
-    {
-        QNetworkRequest m_Request;
-        OnDoneFun m_OnDone;
-        QByteArray m_Body;
-    };
-
-    std::deque<QueuedRequest> m_RequestQueue;
+    DownloadScheduler& m_Scheduler;
 };
 
 class ScryfallSearchEndpoint : public ScryfallEndpoint
@@ -58,7 +44,7 @@ class ScryfallSearchEndpoint : public ScryfallEndpoint
     Q_OBJECT
 
   public:
-    ScryfallSearchEndpoint(QNetworkAccessManager& network_manager);
+    ScryfallSearchEndpoint(DownloadScheduler& scheduler);
 
     using OnDoneFun = std::function<void(const QJsonDocument&)>;
     void Queue(const QString& query, OnDoneFun on_done);
@@ -83,7 +69,7 @@ class ScryfallCollectionEndpoint : public ScryfallEndpoint
     Q_OBJECT
 
   public:
-    ScryfallCollectionEndpoint(QNetworkAccessManager& network_manager);
+    ScryfallCollectionEndpoint(DownloadScheduler& scheduler);
 
     inline static constexpr size_t c_BatchSize{ 75 };
 
@@ -96,7 +82,7 @@ class ScryfallDataEndpoint : public ScryfallEndpoint
     Q_OBJECT
 
   public:
-    ScryfallDataEndpoint(QNetworkAccessManager& network_manager);
+    ScryfallDataEndpoint(DownloadScheduler& scheduler);
 
     using OnDoneFun = std::function<void(const QByteArray&)>;
     void Call(const QString& uri, OnDoneFun on_done);
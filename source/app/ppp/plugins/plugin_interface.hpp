@@ -1,7 +1,10 @@
 #pragma once
 
+#include <memory>
+
 #include <QObject>
 
+#include <ppp/image.hpp>
 #include <ppp/util.hpp>
 
 class QWidget;
@@ -26,6 +29,7 @@ class PluginInterface : public QObject
         ROUTE(PauseCropper);
         ROUTE(UnpauseCropper);
         ROUTE(RefreshCardGrid);
+        ROUTE(CardImageDecoded);
         ROUTE(SetCardSizeChoice);
         ROUTE(SetEnableBackside);
         ROUTE(SetBacksideAutoPattern);
@@ -37,6 +41,10 @@ class PluginInterface : public QObject
     void UnpauseCropper();
     void RefreshCardGrid();
 
+    // Hands an image that was just written to the image folder to the cropper,
+    // which then doesn't have to read it again
+    void CardImageDecoded(const fs::path& card_name, std::shared_ptr<const Image> image);
+
     void SetCardSizeChoice(const std::string& card_size_choice);
     void SetEnableBackside(bool enabled);
 
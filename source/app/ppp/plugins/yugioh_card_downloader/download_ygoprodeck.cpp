@@ -5,21 +5,13 @@
 #include <QNetworkReply>
 #include <QRegularExpression>
 
-#include <ppp/qt_util.hpp>
-#include <ppp/version.hpp>
-
 #include <ppp/util/log.hpp>
 
+#include <ppp/plugins/download_scheduler.hpp>
+
 YGOProDeckDownloader::YGOProDeckDownloader(std::vector<QString> skip_files)
     : CardArtDownloader{ std::move(skip_files), std::nullopt }
 {
-    m_Timer.setSingleShot(true);
-    m_Timer.setInterval(50);
-
-    QObject::connect(&m_Timer,
-                     &QTimer::timeout,
-                     this,
-                     &YGOProDeckDownloader::NextRequest);
 }
 YGOProDeckDownloader::~YGOProDeckDownloader() = default;
 
@@ -76,32 +68,38 @@ bool YGOProDeckDownloader::ParseInput(const QString& input)
     return true;
 }
 
-bool YGOProDeckDownloader::BeginDownload(QNetworkAccessManager& network_manager)
+bool YGOProDeckDownloader::BeginDownload(DownloadScheduler& scheduler)
 {
-    m_NetworkManager = &network_manager;
+    // YGOProDeck asks for no more than 20 requests per second
+    scheduler.SetHostPolicy("images.ygoprodeck.com",
+                            DownloadHostPolicy{
+                                .m_MaxInFlight = 4,
+                                .m_RequestsPerSecond = 15.0f,
+                                .m_Burst = 1,
+                            });
 
     m_TotalRequests = static_cast<uint32_t>(m_Cards.size());
-    NextRequest();
-
     Progress(0, static_cast<int>(m_TotalRequests));
 
-    return true;
-}
-
-void YGOProDeckDownloader::HandleReply(QNetworkReply* reply)
-{
-    const auto& id{ m_CardIds[m_Progress] };
-    ImageAvailable(reply->readAll(), m_Cards.at(id).m_FileName);
-
-    ++m_Progress;
-    Progress(static_cast<int>(m_Progress), static_cast<int>(m_TotalRequests));
-
-    if (m_Progress != m_TotalRequests)
+    for (const auto& id : m_CardIds)
     {
-        m_Timer.start();
+        const auto request_uri{
+            QString{ "https://images.ygoprodeck.com/images/cards/%1.jpg" }
+                .arg(id)
+        };
+
+        const QString file_name{ m_Cards.at(id).m_FileName };
+        scheduler.Get(DownloadScheduler::MakeRequest(request_uri),
+                      [this, file_name](QNetworkReply* reply)
+                      {
+                          ImageAvailable(reply->readAll(), file_name);
+
+                          ++m_Progress;
+                          Progress(static_cast<int>(m_Progress), static_cast<int>(m_TotalRequests));
+                      });
     }
 
-    reply->deleteLater();
+    return true;
 }
 
 std::vector<QString> YGOProDeckDownloader::GetFiles() const
@@ -142,19 +140,3 @@ bool YGOProDeckDownloader::ProvidesBleedEdge() const
 {
     return false;
 }
-
-void YGOProDeckDownloader::NextRequest()
-{
-    const auto request_uri{
-        QString{ "https://images.ygoprodeck.com/images/cards/%1.jpg" }
-            .arg(m_CardIds[m_Progress])
-    };
-
-    QNetworkRequest request{ std::move(request_uri) };
-    request.setHeader(QNetworkRequest::KnownHeaders::UserAgentHeader,
-                      ToQString(fmt::format("Proxy-PDF-Maker/{}", ProxyPdfVersion())));
-    request.setRawHeader("Accept",
-                         "*/*");
-
-    m_NetworkManager->get(std::move(request));
-}
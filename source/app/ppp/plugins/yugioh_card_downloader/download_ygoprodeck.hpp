@@ -4,7 +4,6 @@
 #include <vector>
 
 #include <QString>
-#include <QTimer>
 
 #include <ppp/plugins/download_interface.hpp>
 
@@ -27,8 +26,7 @@ class YGOProDeckDownloader : public CardArtDownloader
     virtual ~YGOProDeckDownloader() override;
 
     virtual bool ParseInput(const QString& input) override;
-    virtual bool BeginDownload(QNetworkAccessManager& network_manager) override;
-    virtual void HandleReply(QNetworkReply* reply) override;
+    virtual bool BeginDownload(DownloadScheduler& scheduler) override;
 
     virtual std::vector<QString> GetFiles() const override;
 
@@ -44,10 +42,6 @@ class YGOProDeckDownloader : public CardArtDownloader
     void OnError(){};
 
   private:
-    void NextRequest();
-
-    QNetworkAccessManager* m_NetworkManager;
-
     struct CardInfo
     {
         uint32_t m_Amount{ 0 };
@@ -57,8 +51,6 @@ class YGOProDeckDownloader : public CardArtDownloader
     std::unordered_map<QString, uint32_t> m_FileNameIdMap;
     std::vector<uint32_t> m_CardIds;
 
-    QTimer m_Timer;
-
     uint32_t m_Progress{ 0 };
     size_t m_TotalRequests{};
 };
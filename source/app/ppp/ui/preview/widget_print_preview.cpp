@@ -116,6 +116,20 @@ PrintPreview::PrintPreview(Project& project,
                      {
                          m_TargetPage.reset();
                      });
+
+    m_VisibleCardsTimer.setSingleShot(true);
+    m_VisibleCardsTimer.setInterval(100);
+    QObject::connect(&m_VisibleCardsTimer,
+                     &QTimer::timeout,
+                     this,
+                     [this]()
+                     {
+                         VisibleCardsChanged(VisibleCardNames(*this));
+                     });
+    QObject::connect(verticalScrollBar(),
+                     &QScrollBar::valueChanged,
+                     &m_VisibleCardsTimer,
+                     qOverload<>(&QTimer::start));
 }
 
 void PrintPreview::Refresh()
@@ -313,6 +327,8 @@ void PrintPreview::Refresh()
     setWidget(pages_widget);
 
     verticalScrollBar()->setValue(current_scroll);
+
+    m_VisibleCardsTimer.start();
 }
 
 void PrintPreview::RequestRefresh()
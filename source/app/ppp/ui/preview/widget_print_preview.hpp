@@ -37,6 +37,9 @@ class PrintPreview : public QScrollArea
     void RestoreCardsOrder();
     void ReorderCards(size_t from, size_t to);
 
+    // Cards on screen and close to it, most important first
+    void VisibleCardsChanged(const std::vector<fs::path>& card_names);
+
   private:
     void GoToPage(uint32_t page);
 
@@ -63,4 +66,7 @@ class PrintPreview : public QScrollArea
 
     std::optional<uint32_t> m_TargetPage{ std::nullopt };
     QTimer m_NumberTypeTimer;
+
+    // Scrolling reports visible cards only once it settles down
+    QTimer m_VisibleCardsTimer;
 };
@@ -972,6 +972,7 @@ CardArea::CardArea(Project& project,
             [this](const QString& text)
             {
                 m_ScrollArea->ApplyFilter(text, m_DisplayColumns);
+                m_VisibleCardsTimer.start();
             }
         };
 
@@ -1041,7 +1042,29 @@ CardArea::CardArea(Project& project,
                          m_OnboardingHint->setVisible(!grid.HasCards());
                          m_Header->setVisible(grid.HasCards());
                          m_ScrollArea->setVisible(grid.HasCards());
+
+                         m_VisibleCardsTimer.start();
                      });
+
+    m_VisibleCardsTimer.setSingleShot(true);
+    m_VisibleCardsTimer.setInterval(100);
+    QObject::connect(&m_VisibleCardsTimer,
+                     &QTimer::timeout,
+                     this,
+                     [this]()
+                     {
+                         VisibleCardsChanged(VisibleCardNames(*m_ScrollArea));
+                     });
+
+    auto* scroll_bar{ m_ScrollArea->verticalScrollBar() };
+    QObject::connect(scroll_bar,
+                     &QScrollBar::valueChanged,
+                     &m_VisibleCardsTimer,
+                     qOverload<>(&QTimer::start));
+    QObject::connect(scroll_bar,
+                     &QScrollBar::rangeChanged,
+                     &m_VisibleCardsTimer,
+                     qOverload<>(&QTimer::start));
 }
 
 void CardArea::NewProjectOpened()
@@ -1159,6 +1182,12 @@ void CardArea::FullRefresh()
     m_RefreshTimer.start();
 }
 
+void CardArea::showEvent(QShowEvent* event)
+{
+    QWidget::showEvent(event);
+    m_VisibleCardsTimer.start();
+}
+
 int CardArea::MaximumColumnsFromAvailableWidth(int available_width) const
 {
     const auto margins{ contentsMargins() };
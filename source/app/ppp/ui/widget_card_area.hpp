@@ -42,7 +42,12 @@ class CardArea : public QWidget
   signals:
     void RequestOpenPluginsWindow();
 
+    // Cards on screen and close to it, most important first
+    void VisibleCardsChanged(const std::vector<fs::path>& card_names);
+
   private:
+    virtual void showEvent(QShowEvent* event) override;
+
     const Project& m_Project;
     uint32_t m_DisplayColumns;
 
@@ -57,4 +62,7 @@ class CardArea : public QWidget
     // to avoid cases where we get multiple requests
     // in quick succession
     QTimer m_RefreshTimer;
+
+    // Scrolling reports visible cards only once it settles down
+    QTimer m_VisibleCardsTimer;
 };
@@ -1,5 +1,7 @@
 #include <ppp/ui/widget_util/widget_card.hpp>
 
+#include <tuple>
+
 #include <QAction>
 #include <QCommonStyle>
 #include <QHBoxLayout>
@@ -10,6 +12,7 @@
 #include <QPixmap>
 #include <QPushButton>
 #include <QResizeEvent>
+#include <QScrollArea>
 #include <QStackedLayout>
 #include <QSvgRenderer>
 #include <QSvgWidget>
@@ -504,19 +507,19 @@ Image CardImage::GetImage(const ImagePreview& preview) const
             if (m_Project.IsCardRoundedRect())
             {
                 return finalize_image(
-                    preview.m_CroppedImage
+                    preview.m_CroppedImage.Get()
                         .RoundCorners(m_CardSize, m_CornerRadius));
             }
             else if (m_Project.IsCardSvg())
             {
                 return finalize_image(
-                    preview.m_CroppedImage
+                    preview.m_CroppedImage.Get()
                         .Mirror(false, m_OriginalParams.m_Backside)
                         .ClipSvg(m_Project.CardSvgData())
                         .Mirror(false, m_OriginalParams.m_Backside));
             }
         }
-        return CropImage(preview.m_UncroppedImage,
+        return CropImage(preview.m_UncroppedImage.Get(),
                          m_CardName,
                          m_CardSize,
                          m_FullBleed,
@@ -531,14 +534,14 @@ Image CardImage::GetImage(const ImagePreview& preview) const
             if (m_Project.IsCardRoundedRect())
             {
                 return preview
-                    .m_CroppedImage
+                    .m_CroppedImage.Get()
                     .RoundCorners(m_CardSize, m_CornerRadius)
                     .Rotate(m_OriginalParams.m_Rotation);
             }
             else if (m_Project.IsCardSvg())
             {
                 return preview
-                    .m_CroppedImage
+                    .m_CroppedImage.Get()
                     .Mirror(false, m_OriginalParams.m_Backside)
                     .ClipSvg(m_Project.CardSvgData())
                     .Mirror(false, m_OriginalParams.m_Backside)
@@ -547,7 +550,7 @@ Image CardImage::GetImage(const ImagePreview& preview) const
         }
 
         return preview
-            .m_CroppedImage
+            .m_CroppedImage.Get()
             .Rotate(m_OriginalParams.m_Rotation);
     }
 }
@@ -928,3 +931,57 @@ void StackedCardBacksideView::mouseReleaseEvent(QMouseEvent* event)
         event->accept();
     }
 }
+
+std::vector<fs::path> VisibleCardNames(const QScrollArea& scroll_area)
+{
+    TRACY_AUTO_SCOPE();
+
+    const QWidget* content{ scroll_area.widget() };
+    if (content == nullptr || !scroll_area.isVisible())
+    {
+        return {};
+    }
+
+    const QWidget* viewport{ scroll_area.viewport() };
+    const int margin{ viewport->height() };
+    const QRect near_visible_rect{ viewport->rect().adjusted(0, -margin, 0, margin) };
+
+    struct VisibleCard
+    {
+        QRect m_Rect;
+        const fs::path* m_CardName;
+    };
+    std::vector<VisibleCard> visible_cards;
+    for (const CardImage* card_image : content->findChildren<CardImage*>())
+    {
+        if (!card_image->isVisibleTo(content) || card_image->GetCardName().empty())
+        {
+            continue;
+        }
+
+        const QRect rect{ card_image->mapTo(viewport, QPoint{ 0, 0 }), card_image->size() };
+        if (near_visible_rect.intersects(rect))
+        {
+            visible_cards.push_back({ rect, &card_image->GetCardName() });
+        }
+    }
+
+    // Visible cards first, then those just outside, each top to bottom
+    const auto sort_key{
+        [viewport_rect = viewport->rect()](const VisibleCard& card)
+        {
+            return std::tuple{ !viewport_rect.intersects(card.m_Rect), card.m_Rect.y(), card.m_Rect.x() };
+        }
+    };
+    std::ranges::sort(visible_cards, {}, sort_key);
+
+    std::vector<fs::path> card_names;
+    for (const VisibleCard& card : visible_cards)
+    {
+        if (std::ranges::find(card_names, *card.m_CardName) == card_names.end())
+        {
+            card_names.push_back(*card.m_CardName);
+        }
+    }
+    return card_names;
+}
@@ -11,6 +11,7 @@
 #include <ppp/project/card_info.hpp>
 
 class QAction;
+class QScrollArea;
 
 class Project;
 struct ImagePreview;
@@ -205,3 +206,7 @@ class StackedCardBacksideView : public QStackedWidget
     QWidget* m_Backside;
     QWidget* m_BacksideContainer;
 };
+
+// Names of all card images in the scroll area that are visible or within one page of
+// becoming visible, in reading order and without duplicates
+std::vector<fs::path> VisibleCardNames(const QScrollArea& scroll_area);
@@ -0,0 +1,262 @@
+#include <ppp/upscale_cache.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <QFile>
+#include <QSaveFile>
+
+#include <xxhash.h>
+
+#include <ppp/qt_util.hpp>
+
+#include <ppp/util/at_scope_exit.hpp>
+#include <ppp/util/log.hpp>
+
+#include <ppp/profile/profile.hpp>
+
+static const fs::path c_UpscaleCacheDir{ "./res/cache/upscaled" };
+
+static std::atomic_uint64_t s_MaxCacheSize{ 2048ull * 1024 * 1024 };
+
+// Size and time of last use of all cached images, the cache directory is only scanned
+// once when the cache size is applied at startup, afterwards this is kept up to date on
+// every read, write and eviction
+struct UpscaleCacheEntry
+{
+    uint64_t m_Size{ 0 };
+    fs::file_time_type m_LastUse{};
+};
+struct UpscaleCacheIndex
+{
+    bool m_Scanned{ false };
+    std::unordered_map<fs::path, UpscaleCacheEntry> m_Entries;
+    uint64_t m_TotalSize{ 0 };
+};
+
+// Guards the index, reads and writes of single files are safe without it
+static TRACY_DECLARE_MUTEX(std::mutex, s_IndexMutex);
+static UpscaleCacheIndex s_Index{};
+
+static void ScanUpscaleCache()
+{
+    TRACY_AUTO_SCOPE();
+
+    if (s_Index.m_Scanned)
+    {
+        return;
+    }
+    s_Index.m_Scanned = true;
+
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator{ c_UpscaleCacheDir, error })
+    {
+        if (!entry.is_regular_file(error))
+        {
+            continue;
+        }
+
+        const uint64_t size{ entry.file_size(error) };
+        if (error)
+        {
+            continue;
+        }
+
+        s_Index.m_Entries[entry.path()] = UpscaleCacheEntry{
+            .m_Size{ size },
+            .m_LastUse{ entry.last_write_time(error) },
+        };
+        s_Index.m_TotalSize += size;
+    }
+}
+
+static fs::path GetCachePath(UpscaleCacheKey key)
+{
+    return c_UpscaleCacheDir / fmt::format("{:016x}{:016x}.png", key.m_High, key.m_Low);
+}
+
+UpscaleCacheKey MakeUpscaleCacheKey(const QByteArray& source_data,
+                                    std::string_view model_name,
+                                    Size physical_size,
+                                    PixelDensity max_density,
+                                    bool fill_corners,
+                                    Length corner_radius)
+{
+    TRACY_AUTO_SCOPE();
+
+    struct Parameters
+    {
+        float m_Width;
+        float m_Height;
+        float m_MaxDensity;
+        float m_CornerRadius;
+        uint32_t m_FillCorners;
+    };
+    const Parameters parameters{
+        .m_Width{ physical_size.x.value },
+        .m_Height{ physical_size.y.value },
+        .m_MaxDensity{ max_density.value },
+        .m_CornerRadius{ fill_corners ? corner_radius.value : 0.0f },
+        .m_FillCorners{ fill_corners ? 1u : 0u },
+    };
+
+    XXH3_state_t* state{ XXH3_createState() };
+    AtScopeExit free_state{
+        [state]()
+        {
+            XXH3_freeState(state);
+        }
+    };
+    XXH3_128bits_reset(state);
+    XXH3_128bits_update(state, source_data.constData(), static_cast<size_t>(source_data.size()));
+    XXH3_128bits_update(state, model_name.data(), model_name.size());
+    XXH3_128bits_update(state, &parameters, sizeof(parameters));
+    const XXH128_hash_t hash{ XXH3_128bits_digest(state) };
+
+    return UpscaleCacheKey{
+        .m_High{ hash.high64 },
+        .m_Low{ hash.low64 },
+    };
+}
+
+void ApplyUpscaleCacheSize(uint32_t max_cache_size)
+{
+    s_MaxCacheSize.store(static_cast<uint64_t>(max_cache_size) * 1024 * 1024, std::memory_order_relaxed);
+
+    if (max_cache_size > 0)
+    {
+        TRACY_SCOPED_LOCK(s_IndexMutex);
+        ScanUpscaleCache();
+    }
+}
+
+std::optional<QByteArray> ReadUpscaleCache(UpscaleCacheKey key)
+{
+    TRACY_AUTO_SCOPE();
+
+    if (s_MaxCacheSize.load(std::memory_order_relaxed) == 0)
+    {
+        return std::nullopt;
+    }
+
+    const fs::path cache_path{ GetCachePath(key) };
+    QFile file{ ToQString(cache_path) };
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return std::nullopt;
+    }
+
+    QByteArray upscaled_data{ file.readAll() };
+    file.close();
+    if (upscaled_data.isEmpty())
+    {
+        return std::nullopt;
+    }
+
+    // Modification time doubles as the time of last use for eviction, so that it
+    // survives restarts
+    const auto now{ fs::file_time_type::clock::now() };
+    std::error_code error;
+    fs::last_write_time(cache_path, now, error);
+
+    {
+        TRACY_SCOPED_LOCK(s_IndexMutex);
+        ScanUpscaleCache();
+        const auto it{ s_Index.m_Entries.find(cache_path) };
+        if (it != s_Index.m_Entries.end())
+        {
+            it->second.m_LastUse = now;
+        }
+    }
+
+    return upscaled_data;
+}
+
+static void EvictUpscaleCache(uint64_t max_cache_size)
+{
+    TRACY_AUTO_SCOPE();
+
+    if (s_Index.m_TotalSize <= max_cache_size)
+    {
+        return;
+    }
+
+    using EntryIt = decltype(s_Index.m_Entries)::iterator;
+    std::vector<EntryIt> entries;
+    entries.reserve(s_Index.m_Entries.size());
+    for (auto it = s_Index.m_Entries.begin(); it != s_Index.m_Entries.end(); ++it)
+    {
+        entries.push_back(it);
+    }
+    std::ranges::sort(entries,
+                      {},
+                      [](EntryIt entry)
+                      { return entry->second.m_LastUse; });
+
+    std::error_code error;
+    uint32_t evicted{ 0 };
+    for (EntryIt entry : entries)
+    {
+        if (s_Index.m_TotalSize <= max_cache_size)
+        {
+            break;
+        }
+
+        // Files that were removed by someone else are dropped as well
+        fs::remove(entry->first, error);
+        if (!error)
+        {
+            s_Index.m_TotalSize -= entry->second.m_Size;
+            s_Index.m_Entries.erase(entry);
+            ++evicted;
+        }
+    }
+
+    LogInfo("Evicted {} upscaled images from cache, {} MiB remaining", evicted, s_Index.m_TotalSize / (1024 * 1024));
+}
+
+void WriteUpscaleCache(UpscaleCacheKey key, const QByteArray& upscaled_data)
+{
+    TRACY_AUTO_SCOPE();
+
+    const uint64_t max_cache_size{ s_MaxCacheSize.load(std::memory_order_relaxed) };
+    if (max_cache_size == 0)
+    {
+        return;
+    }
+
+    std::error_code error;
+    fs::create_directories(c_UpscaleCacheDir, error);
+    if (error)
+    {
+        return;
+    }
+
+    // Written atomically, so that concurrent reads never see a partial image
+    const fs::path cache_path{ GetCachePath(key) };
+    QSaveFile file{ ToQString(cache_path) };
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(upscaled_data) != upscaled_data.size() ||
+        !file.commit())
+    {
+        LogError("Failed writing upscaled image to cache...");
+        return;
+    }
+
+    TRACY_SCOPED_LOCK(s_IndexMutex);
+    ScanUpscaleCache();
+
+    // Overwriting an existing entry only changes the size by the difference
+    UpscaleCacheEntry& entry{ s_Index.m_Entries[cache_path] };
+    s_Index.m_TotalSize -= entry.m_Size;
+    entry = UpscaleCacheEntry{
+        .m_Size{ static_cast<uint64_t>(upscaled_data.size()) },
+        .m_LastUse{ fs::file_time_type::clock::now() },
+    };
+    s_Index.m_TotalSize += entry.m_Size;
+
+    EvictUpscaleCache(max_cache_size);
+}
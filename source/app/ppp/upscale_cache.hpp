@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include <QByteArray>
+
+#include <ppp/util.hpp>
+
+// Identifies an upscaled image by everything that went into producing it
+struct UpscaleCacheKey
+{
+    uint64_t m_High{ 0 };
+    uint64_t m_Low{ 0 };
+};
+
+UpscaleCacheKey MakeUpscaleCacheKey(const QByteArray& source_data,
+                                    std::string_view model_name,
+                                    Size physical_size,
+                                    PixelDensity max_density,
+                                    bool fill_corners,
+                                    Length corner_radius);
+
+// Size limit of the cache in MiB, once exceeded the least recently used results are
+// evicted, zero disables the cache
+void ApplyUpscaleCacheSize(uint32_t max_cache_size);
+
+// Returns the encoded result of a previous upscale, marking it as recently used
+std::optional<QByteArray> ReadUpscaleCache(UpscaleCacheKey key);
+void WriteUpscaleCache(UpscaleCacheKey key, const QByteArray& upscaled_data);
@@ -1,20 +1,37 @@
 #include <ppp/upscale_models.hpp>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <latch>
+#include <memory>
+#include <mutex>
 #include <ranges>
+#include <unordered_set>
+#include <vector>
 
 #include <QApplication>
 #include <QDirIterator>
 #include <QFile>
+#include <QRunnable>
 
 #include <opencv2/opencv.hpp>
 
+#include <magic_enum/magic_enum.hpp>
+
 #include <onnxruntime/core/session/onnxruntime_cxx_api.h>
 
+#include <xxhash.h>
+
 #include <ppp/app.hpp>
+#include <ppp/config.hpp>
 #include <ppp/image.hpp>
+#include <ppp/qt_util.hpp>
 #include <ppp/util.hpp>
+#include <ppp/worker_pools.hpp>
 
+#include <ppp/util/at_scope_exit.hpp>
 #include <ppp/util/log.hpp>
 
 struct DownloadableModel
@@ -33,6 +50,24 @@ inline constexpr std::array c_DownloadableModels{
     }
 };
 
+// Number of inferences that run at once per upscaled image
+static constexpr size_t c_MaxConcurrentBatches{ 2 };
+
+struct UpscaleSessionOptions
+{
+    UpscaleOptimizationLevel m_OptimizationLevel{ UpscaleOptimizationLevel::All };
+    uint32_t m_IntraOpThreads{ 0 };
+    uint32_t m_InterOpThreads{ 1 };
+    bool m_CpuMemoryArena{ true };
+};
+
+static std::mutex s_SessionOptionsMutex;
+static UpscaleSessionOptions s_SessionOptions;
+
+// Models that have not yet been run since they were loaded
+static std::mutex s_FirstRunMutex;
+static std::unordered_set<std::string> s_FirstRunPending;
+
 std::vector<std::string> GetModelNames()
 {
     std::vector<std::string> model_names{ "None" };
@@ -90,6 +125,84 @@ std::optional<std::string_view> GetModelUrl(std::string_view model_name)
     return std::nullopt;
 }
 
+void ApplyUpscaleSessionOptions(const Config& config)
+{
+    const uint32_t intra_op_threads{
+        config.m_UpscaleIntraOpThreads != 0
+            ? config.m_UpscaleIntraOpThreads
+            : std::max(config.m_MaxWorkerThreads / static_cast<uint32_t>(c_MaxConcurrentBatches), 1u)
+    };
+
+    std::lock_guard lock{ s_SessionOptionsMutex };
+    s_SessionOptions = UpscaleSessionOptions{
+        .m_OptimizationLevel{ config.m_UpscaleOptimizationLevel },
+        .m_IntraOpThreads{ intra_op_threads },
+        .m_InterOpThreads{ std::max(config.m_UpscaleInterOpThreads, 1u) },
+        .m_CpuMemoryArena{ config.m_UpscaleCpuMemoryArena },
+    };
+}
+
+static GraphOptimizationLevel ToOrtOptimizationLevel(UpscaleOptimizationLevel level)
+{
+    switch (level)
+    {
+    case UpscaleOptimizationLevel::Disabled:
+        return ORT_DISABLE_ALL;
+    case UpscaleOptimizationLevel::Basic:
+        return ORT_ENABLE_BASIC;
+    case UpscaleOptimizationLevel::Extended:
+        return ORT_ENABLE_EXTENDED;
+    case UpscaleOptimizationLevel::All:
+    default:
+        return ORT_ENABLE_ALL;
+    }
+}
+
+// Hashes the model file together with everything that changes the optimized graph,
+// returns nothing if the model can't be read
+static std::optional<uint64_t> HashModel(const fs::path& model_path,
+                                         UpscaleOptimizationLevel optimization_level,
+                                         std::string_view provider)
+{
+    QFile model_file{ ToQString(model_path) };
+    if (!model_file.open(QFile::ReadOnly))
+    {
+        return std::nullopt;
+    }
+
+    XXH3_state_t* state{ XXH3_createState() };
+    AtScopeExit free_state{
+        [state]()
+        {
+            XXH3_freeState(state);
+        }
+    };
+    XXH3_64bits_reset(state);
+
+    static constexpr qint64 c_ChunkSize{ 1024 * 1024 };
+    std::vector<char> chunk(c_ChunkSize);
+    while (true)
+    {
+        const qint64 read{ model_file.read(chunk.data(), c_ChunkSize) };
+        if (read < 0)
+        {
+            return std::nullopt;
+        }
+        if (read == 0)
+        {
+            break;
+        }
+        XXH3_64bits_update(state, chunk.data(), static_cast<size_t>(read));
+    }
+
+    const std::string_view ort_version{ OrtGetApiBase()->GetVersionString() };
+    const std::string_view level_name{ magic_enum::enum_name(optimization_level) };
+    XXH3_64bits_update(state, ort_version.data(), ort_version.size());
+    XXH3_64bits_update(state, level_name.data(), level_name.size());
+    XXH3_64bits_update(state, provider.data(), provider.size());
+    return XXH3_64bits_digest(state);
+}
+
 void LoadModel(PrintProxyPrepApplication& application, std::string_view model_name)
 {
     if (application.GetUpscaleModel(std::string{ model_name }) != nullptr)
@@ -98,38 +211,182 @@ void LoadModel(PrintProxyPrepApplication& application, std::string_view model_na
     }
 
     static Ort::Env s_Env{ ORT_LOGGING_LEVEL_WARNING };
-    // TODO: load providers??
+
+    const auto start_point{ std::chrono::high_resolution_clock::now() };
+
+    const UpscaleSessionOptions options{
+        [&]()
+        {
+            std::lock_guard lock{ s_SessionOptionsMutex };
+            return s_SessionOptions;
+        }()
+    };
 
     Ort::SessionOptions session_options;
+    session_options.SetIntraOpNumThreads(static_cast<int>(options.m_IntraOpThreads));
+    session_options.SetInterOpNumThreads(static_cast<int>(options.m_InterOpThreads));
+    if (options.m_CpuMemoryArena)
+    {
+        session_options.EnableCpuMemArena();
+    }
+    else
+    {
+        session_options.DisableCpuMemArena();
+    }
 
+    std::string_view provider{ "CPUExecutionProvider" };
     const auto available_providers{ Ort::GetAvailableProviders() };
     if (std::ranges::contains(available_providers, "CUDAExecutionProvider"))
     {
         OrtCUDAProviderOptions cuda_options;
         session_options.AppendExecutionProvider_CUDA(cuda_options);
+        provider = "CUDAExecutionProvider";
     }
 
-    auto session{
-        std::make_unique<Ort::Session>(
-            s_Env,
-            fs::path{ GetModelFilename(model_name) }.c_str(),
-            session_options),
+    const fs::path model_path{ GetModelFilename(model_name) };
+    const std::optional<fs::path> optimized_model_path{
+        [&]() -> std::optional<fs::path>
+        {
+            if (options.m_OptimizationLevel == UpscaleOptimizationLevel::Disabled)
+            {
+                return std::nullopt;
+            }
+
+            const auto hash{ HashModel(model_path, options.m_OptimizationLevel, provider) };
+            if (!hash.has_value())
+            {
+                return std::nullopt;
+            }
+
+            return fs::path{ fmt::format("./res/models/optimized/{}-{:016x}.onnx", model_name, hash.value()) };
+        }()
     };
 
+    std::unique_ptr<Ort::Session> session;
+    std::string_view source{ "model" };
+    if (optimized_model_path.has_value() && fs::exists(optimized_model_path.value()))
+    {
+        // Already optimized, so we skip straight to loading the graph
+        Ort::SessionOptions cached_session_options{ session_options.Clone() };
+        cached_session_options.SetGraphOptimizationLevel(ORT_DISABLE_ALL);
+        try
+        {
+            session = std::make_unique<Ort::Session>(
+                s_Env,
+                optimized_model_path.value().c_str(),
+                cached_session_options);
+            source = "cached optimized model";
+        }
+        catch (const Ort::Exception& e)
+        {
+            LogError("Failed loading optimized model {}, optimizing again: {}",
+                     optimized_model_path.value().string(),
+                     e.what());
+
+            std::error_code error;
+            fs::remove(optimized_model_path.value(), error);
+        }
+    }
+
+    if (session == nullptr)
+    {
+        session_options.SetGraphOptimizationLevel(ToOrtOptimizationLevel(options.m_OptimizationLevel));
+        if (optimized_model_path.has_value())
+        {
+            std::error_code error;
+            fs::create_directories(optimized_model_path.value().parent_path(), error);
+            if (!error)
+            {
+                session_options.SetOptimizedModelFilePath(optimized_model_path.value().c_str());
+            }
+        }
+
+        session = std::make_unique<Ort::Session>(
+            s_Env,
+            model_path.c_str(),
+            session_options);
+    }
+
+    const auto duration{ std::chrono::high_resolution_clock::now() - start_point };
+    LogInfo("Created session for upscale model {} from {} in {}ms, optimization {}, {} intra-op and {} inter-op threads",
+            model_name,
+            source,
+            std::chrono::duration_cast<std::chrono::milliseconds>(duration).count(),
+            magic_enum::enum_name(options.m_OptimizationLevel),
+            options.m_IntraOpThreads,
+            options.m_InterOpThreads);
+
+    {
+        std::lock_guard lock{ s_FirstRunMutex };
+        s_FirstRunPending.insert(std::string{ model_name });
+    }
+
     application.SetUpscaleModel(std::string{ model_name }, std::move(session));
 }
 
 void UnloadModel(PrintProxyPrepApplication& application, std::string_view model_name)
 {
+    {
+        std::lock_guard lock{ s_FirstRunMutex };
+        s_FirstRunPending.erase(std::string{ model_name });
+    }
     application.ReleaseUpscaleModel(std::string{ model_name });
 }
 
+// Converts a tile of an 8-bit bgr image into normalized, planar rgb floats, as expected by the models
+static void PackTile(const cv::Mat& bgr_tile, float* planes)
+{
+    const size_t plane_size{ bgr_tile.total() };
+    float* r{ planes };
+    float* g{ planes + plane_size };
+    float* b{ planes + 2 * plane_size };
+    for (int y = 0; y < bgr_tile.rows; y++)
+    {
+        const cv::Vec3b* row{ bgr_tile.ptr<cv::Vec3b>(y) };
+        for (int x = 0; x < bgr_tile.cols; x++)
+        {
+            static constexpr float c_Normalize{ 1.0f / 255.0f };
+            *r++ = row[x][2] * c_Normalize;
+            *g++ = row[x][1] * c_Normalize;
+            *b++ = row[x][0] * c_Normalize;
+        }
+    }
+}
+
+// Converts the given region of a model's planar rgb output into an 8-bit bgr image,
+// clamping values on the way
+static void UnpackTile(const float* planes, cv::Size tile_size, const cv::Rect& region, cv::Mat& bgr_out)
+{
+    const size_t plane_size{ static_cast<size_t>(tile_size.area()) };
+    const float* r{ planes };
+    const float* g{ planes + plane_size };
+    const float* b{ planes + 2 * plane_size };
+    for (int y = 0; y < region.height; y++)
+    {
+        const size_t row_offset{ static_cast<size_t>(region.y + y) * tile_size.width + region.x };
+        cv::Vec3b* row{ bgr_out.ptr<cv::Vec3b>(y) };
+        for (int x = 0; x < region.width; x++)
+        {
+            const auto to_uchar{
+                [](float v)
+                {
+                    return cv::saturate_cast<uchar>(std::clamp(v, 0.0f, 1.0f) * 255.0f);
+                }
+            };
+            const size_t i{ row_offset + x };
+            row[x] = cv::Vec3b{ to_uchar(b[i]), to_uchar(g[i]), to_uchar(r[i]) };
+        }
+    }
+}
+
 Image RunModel(PrintProxyPrepApplication& application,
                std::string_view model_name,
                const Image& image,
                Size physical_size,
                PixelDensity max_density)
 {
+    const auto start_point{ std::chrono::high_resolution_clock::now() };
+
     auto* session{ application.GetUpscaleModel(std::string{ model_name }) };
     const Ort::TypeInfo input_type_info{ session->GetInputTypeInfo(0) };
     const auto input_tensor_info{ input_type_info.GetTensorTypeAndShapeInfo() };
@@ -141,6 +398,10 @@ Image RunModel(PrintProxyPrepApplication& application,
         return image;
     }
 
+    const Ort::TypeInfo output_type_info{ session->GetOutputTypeInfo(0) };
+    const auto output_tensor_info{ output_type_info.GetTensorTypeAndShapeInfo() };
+    const auto output_shape{ output_tensor_info.GetShape() };
+
     static constexpr auto c_PadToTwo{
         [](int tile_overlap)
         {
@@ -173,142 +434,56 @@ Image RunModel(PrintProxyPrepApplication& application,
     const int half_overlap{ tile_overlap / 2 };
     const int tile_delta{ tile_size - tile_overlap };
 
-    const auto& underlying{ image.GetUnderlying() };
-    const auto padding{ c_ComputePadding(underlying, full_size ? 16 : tile_delta, tile_overlap) };
-    auto input_mat{ c_PadImage(underlying, padding) };
-
-    // convert to float-rgb image
-    cv::cvtColor(input_mat, input_mat, cv::COLOR_BGR2RGB);
-    input_mat.convertTo(input_mat, CV_32F, 1.0 / 255.0);
-
-    const auto run_model{
-        [](Ort::Session* model, const cv::Mat& input) -> std::pair<cv::Mat, uint32_t>
+    const cv::Mat bgr_image{
+        [&]()
         {
-            const int input_height{ input.rows };
-            const int input_width{ input.cols };
-
-            // flatten all channels
-            std::vector<cv::Mat> channels(3);
-            cv::split(input, channels);
-            for (cv::Mat& channel : channels)
+            const auto& underlying{ image.GetUnderlying() };
+            cv::Mat bgr;
+            switch (underlying.channels())
             {
-                channel = channel.reshape(1, 1);
+            case 4:
+                cv::cvtColor(underlying, bgr, cv::COLOR_BGRA2BGR);
+                break;
+            case 1:
+                cv::cvtColor(underlying, bgr, cv::COLOR_GRAY2BGR);
+                break;
+            default:
+                bgr = underlying;
+                break;
             }
-
-            // concatenate all channels
-            cv::Mat flat_image;
-            cv::hconcat(channels, flat_image);
-
-            // create an allocator
-            Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-
-            // put image into a tensor
-            const std::vector<int64_t> input_shape{
-                1,
-                3,
-                static_cast<int64_t>(input_height),
-                static_cast<int64_t>(input_width),
-            };
-            const size_t input_size{ flat_image.total() };
-            const Ort::Value input_tensor{
-                Ort::Value::CreateTensor<float>(
-                    memory_info,
-                    (float*)flat_image.data,
-                    input_size,
-                    input_shape.data(),
-                    input_shape.size()),
-            };
-
-            // get input/output names
-            auto input_name{ model->GetInputNameAllocated(0, Ort::AllocatorWithDefaultOptions{}) };
-            auto output_name{ model->GetOutputNameAllocated(0, Ort::AllocatorWithDefaultOptions{}) };
-            auto* input_name_ptr{ input_name.get() };
-            auto* output_name_ptr{ output_name.get() };
-
-            // run model
-            Ort::Value output_tensor{ nullptr };
-            model->Run(
-                Ort::RunOptions{ nullptr },
-                &input_name_ptr,
-                &input_tensor,
-                1,
-                &output_name_ptr,
-                &output_tensor,
-                1);
-
-            // collect info about the output
-            const auto output_shape{ output_tensor.GetTensorTypeAndShapeInfo().GetShape() };
-            const auto output_height{ static_cast<int>(output_shape[2]) };
-            const auto output_width{ static_cast<int>(output_shape[3]) };
-            const auto data_size_per_channel{ output_height * output_width };
-            auto* output_data{ output_tensor.GetTensorMutableData<float>() };
-
-            // convert to a cv::Mat
-            cv::Mat output_mat;
-            cv::merge(
-                std::vector{
-                    cv::Mat{
-                        output_height,
-                        output_width,
-                        CV_32F,
-                        output_data + 0 * data_size_per_channel,
-                    },
-                    cv::Mat{
-                        output_height,
-                        output_width,
-                        CV_32F,
-                        output_data + 1 * data_size_per_channel,
-                    },
-                    cv::Mat{
-                        output_height,
-                        output_width,
-                        CV_32F,
-                        output_data + 2 * data_size_per_channel,
-                    },
-                },
-                output_mat);
-
-            const auto upscale_factor{ static_cast<int>(output_width / input_width) };
-            return { output_mat, upscale_factor };
-        }
+            return bgr;
+        }()
     };
+    const auto padding{ c_ComputePadding(bgr_image, full_size ? 16 : tile_delta, tile_overlap) };
+    const cv::Mat input_mat{ c_PadImage(bgr_image, padding) };
 
-    cv::Mat output_mat;
-    int upscale_factor;
-    if (full_size)
+    // Each tile is placed at its position and only contributes the given region,
+    // the overlap with neighbouring tiles is discarded, except at the image borders
+    struct Tile
     {
-        std::tie(output_mat, upscale_factor) = run_model(session, input_mat);
-    }
-    else
-    {
-        const Ort::TypeInfo output_type_info{ session->GetOutputTypeInfo(0) };
-        const auto output_tensor_info{ output_type_info.GetTensorTypeAndShapeInfo() };
-        const auto output_shape{ output_tensor_info.GetShape() };
-        upscale_factor = static_cast<int>(output_shape[2] / input_shape[2]);
-
-        const int input_height{ input_mat.rows };
-        const int input_width{ input_mat.cols };
+        cv::Point m_Pos;
+        cv::Rect m_Region;
+    };
+    const cv::Size tile_dimensions{ full_size ? input_mat.size() : cv::Size{ tile_size, tile_size } };
+    const std::vector<Tile> tiles{
+        [&]()
+        {
+            if (full_size)
+            {
+                return std::vector{ Tile{ cv::Point{ 0, 0 }, cv::Rect{ cv::Point{ 0, 0 }, input_mat.size() } } };
+            }
 
-        const int output_height{ static_cast<int>(input_height * upscale_factor) };
-        const int output_width{ static_cast<int>(input_width * upscale_factor) };
-        output_mat = cv::Mat::zeros(cv::Size{ output_width, output_height }, CV_32FC3);
+            const dla::ivec2 num_tiles{
+                static_cast<int>((input_mat.cols - tile_overlap) / tile_delta),
+                static_cast<int>((input_mat.rows - tile_overlap) / tile_delta),
+            };
 
-        const dla::ivec2 tiles{
-            static_cast<int>((input_width - tile_overlap) / tile_delta),
-            static_cast<int>((input_height - tile_overlap) / tile_delta),
-        };
-        for (int x{ 0 }; x < tiles.x; ++x)
-        {
-            for (int y{ 0 }; y < tiles.y; ++y)
+            std::vector<Tile> tiles;
+            tiles.reserve(num_tiles.x * num_tiles.y);
+            for (int x{ 0 }; x < num_tiles.x; ++x)
             {
-                try
+                for (int y{ 0 }; y < num_tiles.y; ++y)
                 {
-                    const int pos_x{ x * tile_delta };
-                    const int pos_y{ y * tile_delta };
-                    const cv::Rect in_rect{ pos_x, pos_y, tile_size, tile_size };
-                    const cv::Mat input_tile{ input_mat(in_rect) };
-                    const auto [output_tile, _]{ run_model(session, input_tile) };
-
                     cv::Rect tile_rect{
                         half_overlap,
                         half_overlap,
@@ -321,7 +496,7 @@ Image RunModel(PrintProxyPrepApplication& application,
                         tile_rect.x -= half_overlap;
                         tile_rect.width += half_overlap;
                     }
-                    else if (x == tiles.x - 1)
+                    else if (x == num_tiles.x - 1)
                     {
                         tile_rect.width += half_overlap;
                     }
@@ -331,24 +506,151 @@ Image RunModel(PrintProxyPrepApplication& application,
                         tile_rect.y -= half_overlap;
                         tile_rect.height += half_overlap;
                     }
-                    else if (y == tiles.y - 1)
+                    else if (y == num_tiles.y - 1)
                     {
                         tile_rect.height += half_overlap;
                     }
 
-                    const cv::Rect out_tile_rect{
-                        tile_rect.x * upscale_factor,
-                        tile_rect.y * upscale_factor,
-                        tile_rect.width * upscale_factor,
-                        tile_rect.height * upscale_factor,
+                    tiles.push_back(Tile{ cv::Point{ x * tile_delta, y * tile_delta }, tile_rect });
+                }
+            }
+            return tiles;
+        }()
+    };
+
+    // Models with a dynamic batch size get several tiles per run, which keeps the
+    // execution provider busy, otherwise we stick to what the model expects
+    static constexpr int64_t c_MaxBatchSize{ 4 };
+    const bool dynamic_batch_size{ input_shape[0] < 0 };
+    const int64_t batch_capacity{
+        full_size            ? 1
+        : dynamic_batch_size ? c_MaxBatchSize
+                             : input_shape[0]
+    };
+    const size_t num_batches{ (tiles.size() + batch_capacity - 1) / batch_capacity };
+
+    // With a static output shape we know the upscale factor up front and can bind
+    // preallocated outputs, otherwise the output is allocated by onnxruntime
+    const std::optional<int> static_upscale_factor{
+        !full_size && output_shape[2] > 0
+            ? std::optional{ static_cast<int>(output_shape[2] / input_shape[2]) }
+            : std::nullopt
+    };
+
+    Ort::AllocatorWithDefaultOptions allocator;
+    const auto input_name{ session->GetInputNameAllocated(0, allocator) };
+    const auto output_name{ session->GetOutputNameAllocated(0, allocator) };
+    const Ort::MemoryInfo memory_info{ Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault) };
+
+    // Zeroed so that tiles that failed to run show up black instead of as garbage
+    cv::Mat output_mat;
+    int upscale_factor{ static_upscale_factor.value_or(0) };
+    if (static_upscale_factor.has_value())
+    {
+        output_mat = cv::Mat::zeros(input_mat.rows * upscale_factor, input_mat.cols * upscale_factor, CV_8UC3);
+    }
+
+    // Buffers and bindings are owned by each thread running batches and reused across batches
+    const auto run_batches{
+        [&](std::atomic_size_t& next_batch)
+        {
+            std::vector<float> input_buffer;
+            std::vector<float> output_buffer;
+            Ort::IoBinding binding{ *session };
+
+            const size_t input_tile_size{ 3 * static_cast<size_t>(tile_dimensions.area()) };
+            for (size_t batch{ next_batch++ }; batch < num_batches; batch = next_batch++)
+            {
+                try
+                {
+                    const size_t first_tile{ batch * batch_capacity };
+                    const size_t num_tiles{ std::min(static_cast<size_t>(batch_capacity), tiles.size() - first_tile) };
+                    const int64_t batch_size{ dynamic_batch_size ? static_cast<int64_t>(num_tiles) : batch_capacity };
+
+                    // Unused slots of fixed-size batches are left zeroed
+                    input_buffer.assign(batch_size * input_tile_size, 0.0f);
+                    for (size_t i = 0; i < num_tiles; i++)
+                    {
+                        const Tile& tile{ tiles[first_tile + i] };
+                        PackTile(input_mat(cv::Rect{ tile.m_Pos, tile_dimensions }), input_buffer.data() + i * input_tile_size);
+                    }
+
+                    const std::array<int64_t, 4> batch_input_shape{
+                        batch_size,
+                        3,
+                        tile_dimensions.height,
+                        tile_dimensions.width,
                     };
-                    const cv::Rect out_rect{
-                        pos_x * upscale_factor + out_tile_rect.x,
-                        pos_y * upscale_factor + out_tile_rect.y,
-                        out_tile_rect.width,
-                        out_tile_rect.height,
+                    const Ort::Value input_tensor{
+                        Ort::Value::CreateTensor<float>(memory_info,
+                                                        input_buffer.data(),
+                                                        input_buffer.size(),
+                                                        batch_input_shape.data(),
+                                                        batch_input_shape.size()),
                     };
-                    output_tile(out_tile_rect).copyTo(output_mat(out_rect));
+                    binding.BindInput(input_name.get(), input_tensor);
+
+                    Ort::Value output_tensor{ nullptr };
+
+                    if (static_upscale_factor.has_value())
+                    {
+                        const std::array<int64_t, 4> batch_output_shape{
+                            batch_size,
+                            3,
+                            tile_dimensions.height * upscale_factor,
+                            tile_dimensions.width * upscale_factor,
+                        };
+                        output_buffer.resize(batch_size * input_tile_size * upscale_factor * upscale_factor);
+                        output_tensor = Ort::Value::CreateTensor<float>(memory_info,
+                                                                        output_buffer.data(),
+                                                                        output_buffer.size(),
+                                                                        batch_output_shape.data(),
+                                                                        batch_output_shape.size());
+                        binding.BindOutput(output_name.get(), output_tensor);
+                    }
+                    else
+                    {
+                        binding.BindOutput(output_name.get(), memory_info);
+                    }
+
+                    session->Run(Ort::RunOptions{ nullptr }, binding);
+
+                    const float* output_data{ output_buffer.data() };
+                    std::vector<Ort::Value> output_values;
+                    if (!static_upscale_factor.has_value())
+                    {
+                        // The upscale factor is only known once the first batch ran, so
+                        // the output is set up then, batches run one after another here
+                        output_values = binding.GetOutputValues();
+                        if (output_mat.empty())
+                        {
+                            const auto output_width{ output_values[0].GetTensorTypeAndShapeInfo().GetShape()[3] };
+                            upscale_factor = static_cast<int>(output_width / tile_dimensions.width);
+                            output_mat = cv::Mat::zeros(input_mat.rows * upscale_factor, input_mat.cols * upscale_factor, CV_8UC3);
+                        }
+                        output_data = output_values[0].GetTensorData<float>();
+                    }
+
+                    const cv::Size output_tile_dimensions{ tile_dimensions * upscale_factor };
+                    const size_t output_tile_size{ 3 * static_cast<size_t>(output_tile_dimensions.area()) };
+                    for (size_t i = 0; i < num_tiles; i++)
+                    {
+                        const Tile& tile{ tiles[first_tile + i] };
+                        const cv::Rect out_tile_rect{
+                            tile.m_Region.x * upscale_factor,
+                            tile.m_Region.y * upscale_factor,
+                            tile.m_Region.width * upscale_factor,
+                            tile.m_Region.height * upscale_factor,
+                        };
+                        const cv::Rect out_rect{
+                            tile.m_Pos.x * upscale_factor + out_tile_rect.x,
+                            tile.m_Pos.y * upscale_factor + out_tile_rect.y,
+                            out_tile_rect.width,
+                            out_tile_rect.height,
+                        };
+                        cv::Mat out_region{ output_mat(out_rect) };
+                        UnpackTile(output_data + i * output_tile_size, output_tile_dimensions, out_tile_rect, out_region);
+                    }
                 }
                 catch (const std::exception& e)
                 {
@@ -356,13 +658,66 @@ Image RunModel(PrintProxyPrepApplication& application,
                 }
             }
         }
+    };
+
+    // Batches write to separate regions of the output, so they can run concurrently,
+    // helpers run on the download pool ahead of other downloads and the calling thread
+    // runs batches as well
+    std::atomic_size_t next_batch{ 0 };
+    {
+        const size_t num_helpers{
+            static_upscale_factor.has_value()
+                ? std::min(c_MaxConcurrentBatches, num_batches) - 1
+                : 0
+        };
+
+        static constexpr int c_HelperPriority{ 1 };
+
+        std::latch helpers_done{ static_cast<std::ptrdiff_t>(num_helpers) };
+        std::vector<std::unique_ptr<QRunnable>> helpers;
+        for (size_t i = 0; i < num_helpers; i++)
+        {
+            auto& helper{
+                helpers.emplace_back(QRunnable::create(
+                    [&]()
+                    {
+                        run_batches(next_batch);
+                        helpers_done.count_down();
+                    }))
+            };
+            helper->setAutoDelete(false);
+            StartWork(WorkerPool::Download, helper.get(), c_HelperPriority);
+        }
+        run_batches(next_batch);
+
+        // The pool may be busy with other work that is waiting on us, helpers that
+        // did not start yet are taken back, there is nothing left for them to do
+        for (auto& helper : helpers)
+        {
+            if (TryTakeWork(WorkerPool::Download, helper.get()))
+            {
+                helpers_done.count_down();
+            }
+        }
+        helpers_done.wait();
     }
 
-    // clamp values and convert to bgr-uchar image
-    cv::threshold(output_mat, output_mat, 0, 0, cv::THRESH_TOZERO);
-    cv::threshold(output_mat, output_mat, 1, 1, cv::THRESH_TRUNC);
-    cv::cvtColor(output_mat, output_mat, cv::COLOR_RGB2BGR);
-    output_mat.convertTo(output_mat, CV_8UC3, 255.0);
+    {
+        std::lock_guard lock{ s_FirstRunMutex };
+        if (s_FirstRunPending.erase(std::string{ model_name }) != 0)
+        {
+            const auto duration{ std::chrono::high_resolution_clock::now() - start_point };
+            LogInfo("First inference of upscale model {} took {}ms",
+                    model_name,
+                    std::chrono::duration_cast<std::chrono::milliseconds>(duration).count());
+        }
+    }
+
+    if (output_mat.empty())
+    {
+        LogError("Upscale model {} produced no output...", model_name);
+        return image;
+    }
 
     // remove padding
     const auto final_width{ output_mat.cols - padding.x * upscale_factor };
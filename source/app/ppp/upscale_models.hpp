@@ -7,6 +7,7 @@
 
 #include <ppp/util.hpp>
 
+class Config;
 class Image;
 class PrintProxyPrepApplication;
 
@@ -17,6 +18,12 @@ std::string GetModelFilename(std::string_view model_name);
 bool ModelRequiresDownload(std::string_view model_name);
 std::optional<std::string_view> GetModelUrl(std::string_view model_name);
 
+// Takes the optimization level, thread counts and cpu options for sessions created
+// after this call, intra-op threads default to a share of the worker threads
+void ApplyUpscaleSessionOptions(const Config& config);
+
+// Optimized models are cached in ./res/models/optimized, keyed by a hash of the
+// model, the onnxruntime version and the session options that affect optimization
 void LoadModel(PrintProxyPrepApplication& application, std::string_view model_name);
 void UnloadModel(PrintProxyPrepApplication& application, std::string_view model_name);
 Image RunModel(PrintProxyPrepApplication& application,
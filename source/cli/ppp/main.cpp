@@ -11,7 +11,6 @@
 
 #include <QCoreApplication>
 #include <QSettings>
-#include <QThreadPool>
 
 #include <QtPlugin>
 Q_IMPORT_PLUGIN(QTlsBackendOpenSSL)
@@ -23,7 +22,9 @@ Q_IMPORT_PLUGIN(QTlsBackendOpenSSL)
 
 #include <ppp/util/log.hpp>
 
+#include <ppp/color_cube_lut.hpp>
 #include <ppp/config.hpp>
+#include <ppp/image_allocator.hpp>
 #include <ppp/json_util.hpp>
 
 #include <ppp/pdf/generate.hpp>
@@ -31,6 +32,7 @@ Q_IMPORT_PLUGIN(QTlsBackendOpenSSL)
 #include <ppp/auto_update.hpp>
 #include <ppp/version.hpp>
 #include <ppp/version_check.hpp>
+#include <ppp/worker_pools.hpp>
 
 using ProjectOverrides = std::unordered_map<std::string, std::string>;
 
@@ -268,7 +270,9 @@ int main(int argc, char** raw_argv)
     QCoreApplication app{ argc, raw_argv };
     Config config;
 
-    QThreadPool::globalInstance()->setMaxThreadCount(config.m_MaxWorkerThreads);
+    InstallPooledImageAllocator();
+    ApplyMaxWorkerThreads(config.m_MaxWorkerThreads);
+    ApplyMaxWorkerMemory(config.m_MaxWorkerMemory);
 
     std::span argv{ raw_argv, static_cast<size_t>(argc) };
     CommandLineOptions cli{ ParseCommandLine(argv) };
@@ -377,8 +381,8 @@ int main(int argc, char** raw_argv)
     }
 
     std::mutex color_cubes_mutex;
-    std::unordered_map<std::string, cv::Mat> color_cubes;
-    auto get_color_cube{ [&](std::string_view cube_name) -> cv::Mat*
+    std::unordered_map<std::string, ColorCubeLut> color_cubes;
+    auto get_color_cube{ [&](std::string_view cube_name) -> const ColorCubeLut*
                          {
                              if (cube_name == "None")
                              {
@@ -389,7 +393,7 @@ int main(int argc, char** raw_argv)
                              std::lock_guard lock{ color_cubes_mutex };
                              if (!color_cubes.contains(cube_name_str))
                              {
-                                 color_cubes[cube_name_str] = LoadColorCube(cube_name_str);
+                                 color_cubes.try_emplace(cube_name_str, LoadColorCube(cube_name_str));
                              }
                              return &color_cubes.at(cube_name_str);
                          } };
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <ppp/util/cancellation_token.hpp>
+
+namespace cv
+{
+class Mat;
+}
+
+// Flattened representation of a 3D color cube, laid out contiguously so that the
+// eight corners of a lookup are close together in memory and can be loaded as
+// 4-wide float vectors. Per-byte axis tables replace the float math that maps an
+// 8-bit channel value to cube coordinates.
+class ColorCubeLut
+{
+  public:
+    enum class Interpolation
+    {
+        Nearest,
+        Trilinear,
+    };
+
+    explicit ColorCubeLut(const cv::Mat& color_cube);
+
+    // Applies the cube to a 3- or 4-channel 8-bit image, rows are split across cores.
+    // Alpha, if present, is passed through unchanged. The output is (re-)allocated
+    // to match the input and must not alias it.
+    // Returns false if cancelled, in which case the output is incomplete.
+    bool Apply(const cv::Mat& input,
+               cv::Mat& output,
+               Interpolation interpolation,
+               CancellationToken cancel = {}) const;
+
+  private:
+    template<int Channels, Interpolation InterpolationT>
+    void ApplyRows(const cv::Mat& input, cv::Mat& output, int begin, int end) const;
+
+    struct AxisLookup
+    {
+        // Offsets into m_Lut, already multiplied by the axis stride
+        std::array<uint32_t, 256> m_Lo;
+        std::array<uint32_t, 256> m_Hi;
+        std::array<float, 256> m_Frac;
+    };
+    static AxisLookup MakeAxisLookup(int cube_size, uint32_t stride);
+
+    // Four floats per cube entry, the fourth being padding
+    std::vector<float> m_Lut;
+
+    AxisLookup m_R;
+    AxisLookup m_G;
+    AxisLookup m_B;
+};
@@ -31,6 +31,9 @@ struct ConfigData
 
     uint32_t m_MaxWorkerThreads{ 16 };
 
+    // Memory budget for images decoded by crop work, in MiB, zero means unlimited
+    uint32_t m_MaxWorkerMemory{ 4096 };
+
     uint32_t m_DisplayColumns{ 5 };
     uint32_t m_MaxDisplayColumns{ 5 };
 
@@ -48,6 +51,20 @@ struct ConfigData
     std::optional<int> m_PngCompression{ std::nullopt };
     std::optional<int> m_JpgQuality{ std::nullopt };
 
+    // Format of the images in the crop and uncrop folders, zstd files keep their
+    // png name but can only be opened by us
+    IntermediateImageFormat m_IntermediateImageFormat{ IntermediateImageFormat::Png };
+
+    // Options for upscale model sessions, zero intra-op threads means a share of
+    // the worker threads
+    UpscaleOptimizationLevel m_UpscaleOptimizationLevel{ UpscaleOptimizationLevel::All };
+    uint32_t m_UpscaleIntraOpThreads{ 0 };
+    uint32_t m_UpscaleInterOpThreads{ 1 };
+    bool m_UpscaleCpuMemoryArena{ true };
+
+    // Size limit of the cache of upscaled images, in MiB, zero disables the cache
+    uint32_t m_UpscaleCacheSize{ 2048 };
+
     Unit m_BaseUnit{ Unit::Inches };
 
     bool m_DeterminsticPdfOutput{ false };
@@ -189,6 +206,7 @@ class Config
     void SetCardOrderDirection(CardOrderDirection card_order_direction);
 
     void SetMaxWorkerThreads(uint32_t max_worker_threads);
+    void SetMaxWorkerMemory(uint32_t max_worker_memory);
 
     void SetDisplayColumns(uint32_t display_columns);
     void SetMaxDisplayColumns(uint32_t max_display_columns);
@@ -227,6 +245,7 @@ class Config
     void CardOrderDirectionChanged(CardOrderDirection card_order_direction);
 
     void MaxWorkerThreadsChanged(uint32_t max_worker_threads);
+    void MaxWorkerMemoryChanged(uint32_t max_worker_memory);
 
     void DisplayColumnsChanged(uint32_t display_columns);
     void MaxDisplayColumnsChanged(uint32_t max_display_columns);
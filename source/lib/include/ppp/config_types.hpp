@@ -38,6 +38,23 @@ enum class ImageCompression
     AsIs,
 };
 
+// Format of images that are only read back by us, zstd stores the raw pixels which is
+// several times faster to write and read than png but also larger on disk
+enum class IntermediateImageFormat
+{
+    Png,
+    Zstd,
+};
+
+// Mirrors onnxruntime's graph optimization levels
+enum class UpscaleOptimizationLevel
+{
+    Disabled,
+    Basic,
+    Extended,
+    All,
+};
+
 enum class PageOrientation
 {
     Portrait,
@@ -8,6 +8,10 @@
 
 #include <ppp/color.hpp>
 #include <ppp/util.hpp>
+#include <ppp/util/cancellation_token.hpp>
+
+class ColorCubeLut;
+enum class IntermediateImageFormat;
 
 using EncodedImage = std::vector<std::byte>;
 using EncodedImageView = std::span<const std::byte>;
@@ -43,6 +47,10 @@ class [[nodiscard]] Image
     bool Write(const fs::path& path, std::optional<int32_t> png_compression = std::nullopt, std::optional<int32_t> jpg_quality = std::nullopt) const;
     bool Write(const fs::path& path, std::optional<int32_t> png_compression, std::optional<int32_t> jpg_quality, Size dimensions) const;
 
+    // Writes an image that is only ever read back by us, e.g. crops, Read and ReadMetaData
+    // detect the format from the file's content regardless of its extension
+    bool WriteIntermediate(const fs::path& path, IntermediateImageFormat format, Size dimensions) const;
+
     static Image Decode(const EncodedImage& buffer);
     static Image Decode(EncodedImageView buffer);
 
@@ -79,7 +87,8 @@ class [[nodiscard]] Image
     Image FillCorners(::Size real_size, ::Length corner_radius) const;
     Image FillHoles() const;
 
-    Image ApplyColorCube(const cv::Mat& color_cube) const;
+    // Returns an invalid image if it was cancelled before finishing
+    Image ApplyColorCube(const ColorCubeLut& color_cube, CancellationToken cancel = {}) const;
 
     Image Resize(PixelSize size) const;
 
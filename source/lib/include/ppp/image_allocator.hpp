@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+struct ImageAllocatorStats
+{
+    uint64_t m_Hits{ 0 };
+    uint64_t m_Misses{ 0 };
+    uint64_t m_BytesRecycled{ 0 };
+    uint64_t m_BytesPooled{ 0 };
+
+    float HitRate() const;
+};
+
+// Makes the pooled allocator the default for all cv::Mat allocations, buffers of
+// large images are then kept around after being freed and handed out again for
+// images of the same size. Since nearly all images we process are card-sized, this
+// saves most of the allocations, and page faults, of the crop and pdf pipelines.
+// Safe to call multiple times, buffers allocated before are freed as usual.
+void InstallPooledImageAllocator();
+
+ImageAllocatorStats GetImageAllocatorStats();
+
+// Frees all buffers kept in the pool, to be called when a batch of work finished
+// so that the pool does not hold on to memory while idle
+void TrimImageAllocator();
+
+void LogImageAllocatorStats(std::string_view reason);
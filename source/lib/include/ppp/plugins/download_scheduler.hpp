@@ -0,0 +1,127 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+
+#include <QByteArray>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QString>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+// Limits that apply to all requests to a single host
+struct DownloadHostPolicy
+{
+    // Number of requests that may be running at once
+    uint32_t m_MaxInFlight{ 8 };
+
+    // Requests are started at most at this rate, with up to m_Burst requests started
+    // at once after idling, zero disables rate limiting
+    float m_RequestsPerSecond{ 0.0f };
+    uint32_t m_Burst{ 1 };
+
+    // Requests that fail with a transient error, e.g. a timeout or a 429 or 5xx status,
+    // are retried after a backoff that doubles with each attempt, unless the server
+    // tells us how long to wait
+    uint32_t m_MaxRetries{ 3 };
+    std::chrono::milliseconds m_RetryBackoff{ 500 };
+};
+
+struct DownloadSchedulerStats
+{
+    uint32_t m_Queued{ 0 };
+    uint32_t m_InFlight{ 0 };
+    uint32_t m_PeakInFlight{ 0 };
+
+    uint64_t m_Requested{ 0 };
+    uint64_t m_Finished{ 0 };
+    uint64_t m_Failed{ 0 };
+    uint64_t m_Retried{ 0 };
+
+    uint64_t m_BytesReceived{ 0 };
+    std::chrono::milliseconds m_Elapsed{ 0 };
+
+    // In bytes per second, since the first request was started
+    float Throughput() const;
+};
+
+// Runs all requests of a download, spreading them across hosts according to each
+// host's policy. Lives on and must be used from the thread of the network manager.
+class DownloadScheduler : public QObject
+{
+    Q_OBJECT
+
+  public:
+    DownloadScheduler(QNetworkAccessManager& network_manager,
+                      DownloadHostPolicy default_policy = {});
+    virtual ~DownloadScheduler() override;
+
+    // Applies to requests to the given host that are not yet started
+    void SetHostPolicy(const QString& host, DownloadHostPolicy policy);
+
+    // A request with our user agent, that accepts any content
+    static QNetworkRequest MakeRequest(const QString& uri);
+
+    // Called with the finished reply, which is deleted afterwards, if all retries
+    // failed the reply carries the last error
+    using OnDoneFun = std::function<void(QNetworkReply* reply)>;
+    void Get(QNetworkRequest request, OnDoneFun on_done);
+    void Post(QNetworkRequest request, QByteArray body, OnDoneFun on_done);
+
+    DownloadSchedulerStats GetStats() const;
+    void LogStats(std::string_view reason) const;
+
+  signals:
+    // Emitted whenever a request finished, failed or not
+    void RequestFinished(uint64_t finished, uint64_t requested);
+
+  private:
+    using Clock = std::chrono::high_resolution_clock;
+
+    struct PendingRequest
+    {
+        QNetworkRequest m_Request;
+        QByteArray m_Body;
+        bool m_Post;
+        OnDoneFun m_OnDone;
+        uint32_t m_Attempt;
+    };
+
+    struct HostState
+    {
+        DownloadHostPolicy m_Policy;
+        std::deque<PendingRequest> m_Queue;
+        uint32_t m_InFlight{ 0 };
+
+        float m_Tokens{ 0.0f };
+        Clock::time_point m_LastRefill{};
+        bool m_WakeupPending{ false };
+    };
+
+    void Enqueue(PendingRequest request);
+    HostState& GetHost(const QString& host);
+
+    // Starts as many queued requests as the host's policy allows, if requests are
+    // only held back by the rate limit a wakeup is scheduled
+    void Schedule(const QString& host);
+    void Start(const QString& host, PendingRequest request);
+    void Finished(const QString& host, PendingRequest request, QNetworkReply* reply);
+
+    static bool IsRetryable(QNetworkReply* reply);
+
+    QNetworkAccessManager& m_NetworkManager;
+    DownloadHostPolicy m_DefaultPolicy;
+
+    std::unordered_map<QString, HostState> m_Hosts;
+
+    DownloadSchedulerStats m_Stats;
+    std::optional<Clock::time_point> m_FirstStart;
+    Clock::time_point m_LastFinish{};
+};
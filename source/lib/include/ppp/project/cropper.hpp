@@ -3,6 +3,9 @@
 #include <atomic>
 #include <chrono>
 #include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include <QObject>
 #include <QTemporaryDir>
@@ -13,6 +16,8 @@
 #include <ppp/project/image_database.hpp>
 #include <ppp/project/project.hpp>
 
+class ColorCubeLut;
+class CropperSource;
 class CropperWork;
 
 class Cropper : public QObject
@@ -20,7 +25,7 @@ class Cropper : public QObject
     Q_OBJECT
 
   public:
-    Cropper(std::function<const cv::Mat*(std::string_view)> get_color_cube,
+    Cropper(std::function<const ColorCubeLut*(std::string_view)> get_color_cube,
             const Project& project,
             const Config& config);
     ~Cropper();
@@ -60,14 +65,28 @@ class Cropper : public QObject
     void CardRenamed(const fs::path& old_card_name, const fs::path& new_card_name);
     void CardModified(const fs::path& card_name);
 
+    // The image is used in place of reading the card's file, as long as the file is
+    // not modified, until the card has been cropped
+    void CardImageDecoded(const fs::path& card_name, std::shared_ptr<const Image> image);
+
     void PauseWork();
     void RestartWork();
 
+    // Cards currently shown to the user, most important first, their previews are
+    // generated before all other previews
+    void CardsVisible(const std::vector<fs::path>& card_names);
+
   private:
     void PushWork(const fs::path& card_name, bool needs_crop, bool needs_preview);
     void PushWorkImpl(const fs::path& key, const fs::path& card_name, bool needs_crop, bool needs_preview, bool backside_bleed);
     void RemoveWork(const fs::path& card_name);
 
+    // Crop and preview work of the same card share a source, so it only has to be
+    // hashed and decoded once
+    std::shared_ptr<CropperSource> GetSource(const fs::path& card_name);
+
+    int GetPreviewPriority(const fs::path& card_name) const;
+
     const Project& m_Project;
     const Config& m_Cfg;
 
@@ -81,10 +100,21 @@ class Cropper : public QObject
     };
     State m_State{ State::Waiting };
 
-    std::function<const cv::Mat*(std::string_view)> m_GetColorCube;
+    std::function<const ColorCubeLut*(std::string_view)> m_GetColorCube;
 
     std::unordered_map<fs::path, CropperWork*> m_CropWork;
     std::unordered_map<fs::path, CropperWork*> m_PreviewWork;
+    std::unordered_map<fs::path, std::weak_ptr<CropperSource>> m_Sources;
+
+    struct DecodedImage
+    {
+        std::shared_ptr<const Image> m_Image;
+        fs::file_time_type m_LastWriteTime;
+    };
+    std::unordered_map<fs::path, DecodedImage> m_DecodedImages;
+
+    // Index of each visible card in the last call to CardsVisible
+    std::unordered_map<fs::path, size_t> m_VisibleCards;
 
     uint32_t m_TotalCropWorkToDo{ 0 };
     uint32_t m_TotalCropWorkDone{ 0 };
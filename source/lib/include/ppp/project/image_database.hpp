@@ -1,7 +1,14 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <future>
 #include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <QByteArray>
 
@@ -25,18 +32,83 @@ struct ImageParameters
     bool m_WillWriteOutput{ true };
 };
 
+// Fixed-size form of ImageParameters as stored in the database, quantized the same
+// way parameters are compared
+struct ImageParametersKey
+{
+    uint64_t m_ColorCube{ 0 };
+    int32_t m_DPI{ 0 };
+    int32_t m_Width{ 0 };
+    int32_t m_CardWidth{ 0 };
+    int32_t m_CardHeight{ 0 };
+    int32_t m_FullBleedEdge{ 0 };
+    uint32_t m_Rotation{ 0 };
+    uint32_t m_BleedType{ 0 };
+    uint32_t m_BadAspectRatioHandling{ 0 };
+
+    static ImageParametersKey FromParameters(const ImageParameters& params);
+
+    bool operator==(const ImageParametersKey& rhs) const = default;
+};
+
+// Identifies a path in the database, the path itself is never stored
+struct ImagePathKey
+{
+    uint64_t m_Low{ 0 };
+    uint64_t m_High{ 0 };
+
+    static ImagePathKey FromPath(const fs::path& path);
+
+    bool operator==(const ImagePathKey& rhs) const = default;
+};
+
+template<>
+struct std::hash<ImagePathKey>
+{
+    size_t operator()(const ImagePathKey& key) const noexcept
+    {
+        return static_cast<size_t>(key.m_Low);
+    }
+};
+
 struct ImageDataBaseEntry
 {
     QByteArray m_SourceHash;
-    ImageParameters m_Params;
+    ImageParametersKey m_Params;
 };
 
+// What the file system tells us about a source without reading it, if this did
+// not change since we last hashed the source we reuse the stored hash
+struct ImageSourceStat
+{
+    uint64_t m_Size{ 0 };
+    int64_t m_LastWriteTime{ 0 };
+    uint64_t m_FileId{ 0 };
+    uint64_t m_DeviceId{ 0 };
+
+    bool operator==(const ImageSourceStat& rhs) const = default;
+};
+
+struct ImageSourceEntry
+{
+    ImageSourceStat m_Stat;
+    QByteArray m_Hash;
+};
+
+struct ImageDataBaseRecord;
+
+// The database is stored as a header followed by fixed-size records. Every change
+// is appended to the file right away and later records replace earlier ones for the
+// same path. Once enough records are stale the file is compacted in the background.
 class ImageDataBase
 {
   public:
     static ImageDataBase FromFile(const fs::path& path);
+    ~ImageDataBase();
 
     ImageDataBase& Read(const fs::path& path);
+
+    // Flushes all changes to disk and drops stale records from the file
     void Write();
 
     // Checks if the given file is part of the database at all, indicating that
@@ -47,20 +119,51 @@ class ImageDataBase
     //  - an empty hash if matches
     //  - the source hash if it mismatches
     // Note: Assumes source exists, if it doesn't an empty hash will be returned
-    QByteArray TestEntry(const fs::path& destination, const fs::path& source, ImageParameters params) const;
+    QByteArray TestEntry(const fs::path& destination, const fs::path& source, ImageParameters params);
+
+    // Same as above, but with a source hash previously obtained via HashSource,
+    // allows testing multiple destinations of the same source without rehashing
+    QByteArray TestEntry(const fs::path& destination, const QByteArray& source_hash, ImageParameters params) const;
+
+    // Computes the hash used to identify the given source file, empty if it does not exist
+    // If size, modification time and file id match a previous call the file is not read
+    QByteArray HashSource(const fs::path& source);
 
     // Puts the given mapping into the database
     void PutEntry(const fs::path& destination, QByteArray source_hash, ImageParameters params);
 
   private:
-    using DataBaseMap = std::unordered_map<fs::path, ImageDataBaseEntry>;
-
     ImageDataBase(fs::path path);
-    ImageDataBase(DataBaseMap database,
-                  fs::path path);
 
-    mutable TRACY_DECLARE_MUTEX(std::mutex, m_Mutex);
-    DataBaseMap m_DataBase;
+    // Entries are spread across shards by path, so that workers touching
+    // different files rarely wait on each other
+    struct Shard
+    {
+        TRACY_DECLARE_MUTEX(std::mutex, m_Mutex);
+        std::unordered_map<ImagePathKey, ImageDataBaseEntry> m_DataBase;
+        std::unordered_map<ImagePathKey, ImageSourceEntry> m_Sources;
+    };
+    Shard& GetShard(const ImagePathKey& key) const;
+
+    void Load();
+    void Clear();
+
+    void Append(const ImageDataBaseRecord& record);
+    void StartCompaction();
+    void Compact();
+    void WaitForCompaction();
+
+    static inline constexpr size_t c_NumShards{ 16 };
+    mutable std::array<Shard, c_NumShards> m_Shards;
+
+    std::atomic_size_t m_LiveRecords{ 0 };
+
+    TRACY_DECLARE_MUTEX(std::mutex, m_JournalMutex);
+    std::ofstream m_Journal;
+    size_t m_JournalRecords{ 0 };
+    bool m_Compacting{ false };
+    std::vector<ImageDataBaseRecord> m_CompactionBacklog;
+    std::future<void> m_Compaction;
 
     fs::path m_Path;
 };
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include <ppp/image.hpp>
+
+#include <ppp/profile/profile.hpp>
+
+// Where the encoded bytes of a preview live in the preview cache, the generation
+// identifies the cache file so that a location is never used with another file
+struct PreviewCacheLocation
+{
+    uint64_t m_Generation;
+    uint64_t m_Offset;
+    uint64_t m_Size;
+};
+
+// A preview image that may only be available in encoded form, it is decoded the
+// first time it is accessed. The encoded bytes are kept around, so a preview that
+// was loaded from the cache never has to be encoded again.
+// Copies share the same underlying image, assigning a new image does not affect copies.
+class PreviewImage
+{
+  public:
+    PreviewImage() = default;
+    PreviewImage(Image image);
+    PreviewImage(EncodedImageView encoded,
+                 std::shared_ptr<const void> encoded_owner,
+                 PreviewCacheLocation location);
+
+    PreviewImage& operator=(Image image);
+
+    const Image& Get() const;
+
+    // Encodes the image if it was never encoded
+    EncodedImageView GetEncoded() const;
+
+    std::optional<PreviewCacheLocation> GetCacheLocation() const;
+
+    // The following don't change the image itself, thus are allowed on shared previews
+    void SetCacheLocation(PreviewCacheLocation location) const;
+    void BindToCache(PreviewCacheLocation location,
+                     EncodedImageView encoded,
+                     std::shared_ptr<const void> encoded_owner) const;
+    void DetachFromCache() const;
+
+  private:
+    struct State
+    {
+        TRACY_DECLARE_MUTEX(std::mutex, m_Mutex);
+
+        Image m_Image;
+
+        // Either owned by this state or by m_EncodedOwner, e.g. a mapped file
+        EncodedImage m_Encoded;
+        EncodedImageView m_EncodedView;
+        std::shared_ptr<const void> m_EncodedOwner;
+
+        std::optional<PreviewCacheLocation> m_Location;
+    };
+    std::shared_ptr<State> m_State;
+};
@@ -2,7 +2,9 @@
 
 #include <cstdint>
 #include <optional>
+#include <span>
 #include <unordered_map>
+#include <vector>
 
 #include <QObject>
 
@@ -30,6 +32,16 @@ struct ProjectData
 
     // List of all cards
     CardContainer m_Cards{};
+
+    // Lookup tables into m_Cards, see RebuildCardIndex
+    struct CardIndex
+    {
+        std::unordered_map<fs::path, size_t> m_ByName;
+        std::unordered_map<fs::path, std::vector<size_t>> m_ByStem;
+        std::unordered_map<fs::path, std::vector<fs::path>> m_FrontsByBackside;
+    };
+    CardIndex m_CardIndex{};
+
     ImgDict m_Previews{};
     ImagePreview m_FallbackPreview{};
 
@@ -129,6 +141,28 @@ struct ProjectData
     const CardInfo* FindCard(const fs::path& card_name) const;
     CardInfo* FindCard(const fs::path& card_name);
 
+    // Finds the first card, in card order, with the given stem
+    const CardInfo* FindCardByStem(const fs::path& card_stem) const;
+    CardInfo* FindCardByStem(const fs::path& card_stem);
+
+    // Indices into m_Cards of all cards with the given stem, in card order
+    std::span<const size_t> FindCardsByStem(const fs::path& card_stem) const;
+
+    // Names of all cards that have the given card assigned as their backside
+    std::span<const fs::path> FindFrontsides(const fs::path& backside_name) const;
+
+    // Has to be called after cards were added, removed or reordered, or after
+    // backsides were assigned without going through SetCardBackside
+    void RebuildCardIndex();
+
+    // Keep the card index up to date when a single card was inserted at or is about
+    // to be erased from the given index into m_Cards, cheaper than a full rebuild
+    void IndexInsertedCard(size_t card_index);
+    void UnindexCard(size_t card_index);
+
+    // Assigns the backside of a card while keeping the card index up to date
+    void SetCardBackside(CardInfo& card, std::optional<fs::path> backside);
+
     CardSorting GenerateDefaultCardsSorting() const;
 };
 
@@ -159,6 +193,7 @@ class Project : public QObject
     fs::path GetBacksideOutputFolder() const;
 
     CardInfo& CardAdded(const fs::path& card_name);
+    void CardsAdded(std::span<const fs::path> card_names);
     void CardRemoved(const fs::path& card_name);
     void CardRenamed(const fs::path& old_card_name, const fs::path& new_card_name);
     void CardModified(const fs::path& card_name);
@@ -173,6 +208,7 @@ class Project : public QObject
 
     CardInfo& PutCard(const fs::path& card_name);
     CardInfo& PutCard(CardInfo card);
+    void PutCards(std::span<const fs::path> card_names);
     std::optional<CardInfo> EatCard(const fs::path& card_name);
 
     bool HasExternalCards() const;
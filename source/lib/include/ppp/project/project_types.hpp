@@ -8,6 +8,8 @@
 #include <ppp/image.hpp>
 #include <ppp/util.hpp>
 
+#include <ppp/project/preview_image.hpp>
+
 enum class BadAspectRatioHandling
 {
     Ignore,
@@ -36,8 +38,8 @@ using CardSorting = std::vector<fs::path>;
 
 struct ImagePreview
 {
-    Image m_UncroppedImage;
-    Image m_CroppedImage;
+    PreviewImage m_UncroppedImage;
+    PreviewImage m_CroppedImage;
     bool m_BadAspectRatio;
     bool m_BadRotation;
 };
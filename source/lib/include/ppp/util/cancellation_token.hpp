@@ -0,0 +1,15 @@
+#pragma once
+
+#include <atomic>
+
+// Observes a flag owned by whoever may request cancellation, long running operations
+// check it at convenient points and stop early. A default token is never cancelled.
+struct CancellationToken
+{
+    const std::atomic_bool* m_Cancelled{ nullptr };
+
+    bool IsCancelled() const
+    {
+        return m_Cancelled != nullptr && m_Cancelled->load(std::memory_order_relaxed);
+    }
+};
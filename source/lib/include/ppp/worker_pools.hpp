@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+class QRunnable;
+
+// All background work goes to one of these pools, so that e.g. bulk cropping can
+// never occupy the threads needed for previews the user is waiting on
+enum class WorkerPool
+{
+    Crop,
+    Preview,
+    Pdf,
+    Download,
+};
+
+struct WorkerPoolStats
+{
+    uint32_t m_MaxThreads{ 0 };
+    uint32_t m_ActiveThreads{ 0 };
+    uint32_t m_QueuedWork{ 0 };
+    uint32_t m_PeakQueuedWork{ 0 };
+    uint64_t m_FinishedWork{ 0 };
+    bool m_Paused{ false };
+
+    uint64_t m_MemoryBudget{ 0 };
+    uint64_t m_InFlightMemory{ 0 };
+    uint64_t m_PeakInFlightMemory{ 0 };
+
+    float Utilization() const;
+};
+
+// All pools together run at most the given number of threads, within that each pool
+// is limited to a share of the threads:
+//  - preview gets a quarter, but at least one thread, which no other pool may use
+//    unless there is only a single thread
+//  - crop gets the rest, but at least one thread
+//  - pdf gets all threads, since generation is something the user waits on
+//  - download gets half, since it is mostly waiting on the network
+void ApplyMaxWorkerThreads(uint32_t max_worker_threads);
+
+// Sets the memory budget of the crop pool, given in MiB
+void ApplyMaxWorkerMemory(uint32_t max_worker_memory);
+
+// Work is only admitted while the memory estimates of all running work fit into the
+// budget, unless nothing is running at all. A budget of zero disables the check.
+void SetWorkerPoolMemoryBudget(WorkerPool pool, uint64_t memory_budget);
+
+// Queued work is run in order of priority, work of equal priority runs in the order
+// it was started. Takes ownership of the runnable if it is set to auto-delete.
+// The memory estimate is the peak amount of memory the work needs while running.
+void StartWork(WorkerPool pool, QRunnable* work, int priority = 0, uint64_t memory_estimate = 0);
+void StartWork(WorkerPool pool, std::function<void()> work, int priority = 0, uint64_t memory_estimate = 0);
+
+// Moves queued work to its new priority, behind other work of the same priority
+// Returns false if the work is not queued, e.g. because it is already running
+bool ReprioritizeWork(WorkerPool pool, QRunnable* work, int priority);
+
+// A paused pool keeps all queued and newly started work parked without occupying
+// any threads, work that is already running is not affected. Resuming runs the
+// parked work in order of priority.
+void PauseWorkerPool(WorkerPool pool);
+void ResumeWorkerPool(WorkerPool pool);
+
+// Removes the work from the pool if it has not been picked up yet,
+// after which the caller is responsible for running it
+// Paused pools don't give out work, since that would circumvent pausing
+// Taken work is not counted against the memory budget, it is meant to run in
+// place of the work that took it
+bool TryTakeWork(WorkerPool pool, QRunnable* work);
+
+WorkerPoolStats GetWorkerPoolStats(WorkerPool pool);
+
+// Logs queue depth and utilization of all pools, resets peak queue depths
+void LogWorkerPoolStats(std::string_view reason);
@@ -0,0 +1,250 @@
+#include <ppp/color_cube_lut.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <opencv2/core.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PPP_COLOR_CUBE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include <ppp/profile/profile.hpp>
+
+namespace
+{
+#ifdef PPP_COLOR_CUBE_SSE2
+// Same operation order as the scalar path so both produce identical results
+inline __m128 Lerp(__m128 from, __m128 to, __m128 alpha, __m128 one_minus_alpha)
+{
+    return _mm_add_ps(_mm_mul_ps(from, one_minus_alpha), _mm_mul_ps(to, alpha));
+}
+
+inline void StoreColor(__m128 color, uchar* out)
+{
+    const __m128i color_int{ _mm_cvttps_epi32(color) };
+    const __m128i color_short{ _mm_packs_epi32(color_int, color_int) };
+    const __m128i color_byte{ _mm_packus_epi16(color_short, color_short) };
+    const uint32_t packed{ static_cast<uint32_t>(_mm_cvtsi128_si32(color_byte)) };
+    std::memcpy(out, &packed, 3);
+}
+#else
+struct Color4f
+{
+    float m_Channels[4];
+};
+
+inline Color4f Load(const float* data)
+{
+    return Color4f{ { data[0], data[1], data[2], data[3] } };
+}
+
+inline Color4f Lerp(const Color4f& from, const Color4f& to, float alpha, float one_minus_alpha)
+{
+    Color4f res;
+    for (int i = 0; i < 4; i++)
+    {
+        res.m_Channels[i] = from.m_Channels[i] * one_minus_alpha + to.m_Channels[i] * alpha;
+    }
+    return res;
+}
+
+inline void StoreColor(const Color4f& color, uchar* out)
+{
+    out[0] = static_cast<uchar>(color.m_Channels[0]);
+    out[1] = static_cast<uchar>(color.m_Channels[1]);
+    out[2] = static_cast<uchar>(color.m_Channels[2]);
+}
+#endif
+} // namespace
+
+ColorCubeLut::ColorCubeLut(const cv::Mat& color_cube)
+{
+    TRACY_AUTO_SCOPE();
+
+    const int cube_size{ color_cube.cols };
+    const size_t num_entries{ static_cast<size_t>(cube_size) * cube_size * cube_size };
+
+    m_Lut.resize(num_entries * 4, 0.0f);
+
+    const uchar* cube_data{ color_cube.ptr<uchar>() };
+    for (size_t i = 0; i < num_entries; i++)
+    {
+        m_Lut[i * 4 + 0] = static_cast<float>(cube_data[i * 3 + 0]);
+        m_Lut[i * 4 + 1] = static_cast<float>(cube_data[i * 3 + 1]);
+        m_Lut[i * 4 + 2] = static_cast<float>(cube_data[i * 3 + 2]);
+    }
+
+    // The cube is indexed as (r, g, b) with b being the innermost dimension
+    const uint32_t b_stride{ 4 };
+    const uint32_t g_stride{ b_stride * cube_size };
+    const uint32_t r_stride{ g_stride * cube_size };
+    m_R = MakeAxisLookup(cube_size, r_stride);
+    m_G = MakeAxisLookup(cube_size, g_stride);
+    m_B = MakeAxisLookup(cube_size, b_stride);
+}
+
+bool ColorCubeLut::Apply(const cv::Mat& input,
+                         cv::Mat& output,
+                         Interpolation interpolation,
+                         CancellationToken cancel) const
+{
+    TRACY_AUTO_SCOPE();
+
+    output.create(input.rows, input.cols, input.type());
+
+    const auto apply_rows{
+        [&]<int Channels, Interpolation InterpolationT>()
+        {
+            cv::parallel_for_(
+                cv::Range{ 0, input.rows },
+                [&](const cv::Range& range)
+                {
+                    // Check for cancellation every few rows, which is cheap enough not to show
+                    static constexpr int c_RowsPerCheck{ 32 };
+                    for (int begin = range.start; begin < range.end; begin += c_RowsPerCheck)
+                    {
+                        if (cancel.IsCancelled())
+                        {
+                            return;
+                        }
+
+                        const int end{ std::min(begin + c_RowsPerCheck, range.end) };
+                        ApplyRows<Channels, InterpolationT>(input, output, begin, end);
+                    }
+                });
+        }
+    };
+
+    const bool trilinear{ interpolation == Interpolation::Trilinear };
+    switch (input.channels())
+    {
+    case 3:
+        trilinear
+            ? apply_rows.template operator()<3, Interpolation::Trilinear>()
+            : apply_rows.template operator()<3, Interpolation::Nearest>();
+        break;
+    case 4:
+        trilinear
+            ? apply_rows.template operator()<4, Interpolation::Trilinear>()
+            : apply_rows.template operator()<4, Interpolation::Nearest>();
+        break;
+    default:
+        input.copyTo(output);
+        break;
+    }
+
+    return !cancel.IsCancelled();
+}
+
+template<int Channels, ColorCubeLut::Interpolation InterpolationT>
+void ColorCubeLut::ApplyRows(const cv::Mat& input, cv::Mat& output, int begin, int end) const
+{
+    const float* lut{ m_Lut.data() };
+
+    for (int y = begin; y < end; y++)
+    {
+        const uchar* in_row{ input.ptr<uchar>(y) };
+        uchar* out_row{ output.ptr<uchar>(y) };
+
+        for (int x = 0; x < input.cols; x++)
+        {
+            const uchar* in_px{ in_row + x * Channels };
+            uchar* out_px{ out_row + x * Channels };
+
+            // OpenCV stores pixels as BGR(A)
+            const uchar b{ in_px[0] };
+            const uchar g{ in_px[1] };
+            const uchar r{ in_px[2] };
+
+            if constexpr (Channels == 4)
+            {
+                out_px[3] = in_px[3];
+            }
+
+            if constexpr (InterpolationT == Interpolation::Nearest)
+            {
+                const float* color{ lut + m_R.m_Lo[r] + m_G.m_Lo[g] + m_B.m_Lo[b] };
+                out_px[0] = static_cast<uchar>(color[0]);
+                out_px[1] = static_cast<uchar>(color[1]);
+                out_px[2] = static_cast<uchar>(color[2]);
+            }
+            else
+            {
+                const uint32_t r_lo{ m_R.m_Lo[r] };
+                const uint32_t r_hi{ m_R.m_Hi[r] };
+                const uint32_t g_lo{ m_G.m_Lo[g] };
+                const uint32_t g_hi{ m_G.m_Hi[g] };
+                const uint32_t b_lo{ m_B.m_Lo[b] };
+                const uint32_t b_hi{ m_B.m_Hi[b] };
+
+                const float r_frac{ m_R.m_Frac[r] };
+                const float g_frac{ m_G.m_Frac[g] };
+                const float b_frac{ m_B.m_Frac[b] };
+
+#ifdef PPP_COLOR_CUBE_SSE2
+                const auto load{
+                    [lut](uint32_t offset)
+                    {
+                        return _mm_loadu_ps(lut + offset);
+                    }
+                };
+                const __m128 r_alpha{ _mm_set1_ps(r_frac) };
+                const __m128 r_one_minus_alpha{ _mm_set1_ps(1 - r_frac) };
+                const __m128 g_alpha{ _mm_set1_ps(g_frac) };
+                const __m128 g_one_minus_alpha{ _mm_set1_ps(1 - g_frac) };
+                const __m128 b_alpha{ _mm_set1_ps(b_frac) };
+                const __m128 b_one_minus_alpha{ _mm_set1_ps(1 - b_frac) };
+#else
+                const auto load{
+                    [lut](uint32_t offset)
+                    {
+                        return Load(lut + offset);
+                    }
+                };
+                const float r_alpha{ r_frac };
+                const float r_one_minus_alpha{ 1 - r_frac };
+                const float g_alpha{ g_frac };
+                const float g_one_minus_alpha{ 1 - g_frac };
+                const float b_alpha{ b_frac };
+                const float b_one_minus_alpha{ 1 - b_frac };
+#endif
+
+                const auto lo_b_plane{
+                    Lerp(Lerp(load(r_lo + g_lo + b_lo), load(r_hi + g_lo + b_lo), r_alpha, r_one_minus_alpha),
+                         Lerp(load(r_lo + g_hi + b_lo), load(r_hi + g_hi + b_lo), r_alpha, r_one_minus_alpha),
+                         g_alpha,
+                         g_one_minus_alpha)
+                };
+                const auto hi_b_plane{
+                    Lerp(Lerp(load(r_lo + g_lo + b_hi), load(r_hi + g_lo + b_hi), r_alpha, r_one_minus_alpha),
+                         Lerp(load(r_lo + g_hi + b_hi), load(r_hi + g_hi + b_hi), r_alpha, r_one_minus_alpha),
+                         g_alpha,
+                         g_one_minus_alpha)
+                };
+                const auto color{ Lerp(lo_b_plane, hi_b_plane, b_alpha, b_one_minus_alpha) };
+                StoreColor(color, out_px);
+            }
+        }
+    }
+}
+
+ColorCubeLut::AxisLookup ColorCubeLut::MakeAxisLookup(int cube_size, uint32_t stride)
+{
+    const int cube_size_minus_one{ cube_size - 1 };
+
+    AxisLookup lookup{};
+    for (int i = 0; i < 256; i++)
+    {
+        // Identical to the float math done per-pixel previously, so results stay the same
+        const float v{ (static_cast<float>(i) / 255) * cube_size_minus_one };
+        const auto lo{ static_cast<uint32_t>(std::floor(v)) };
+        const auto hi{ static_cast<uint32_t>(std::ceil(v)) };
+        lookup.m_Lo[i] = lo * stride;
+        lookup.m_Hi[i] = hi * stride;
+        lookup.m_Frac[i] = v - static_cast<float>(lo);
+    }
+    return lookup;
+}
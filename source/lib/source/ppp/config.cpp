@@ -253,6 +253,7 @@ void Config::Load()
             }
 
             m_MaxWorkerThreads = settings.value("Max.Worker.Threads", 6).toUInt();
+            m_MaxWorkerMemory = settings.value("Max.Worker.Memory", 4096).toUInt();
             m_DisplayColumns = settings.value("Display.Columns", 5).toInt();
             m_MaxDisplayColumns = settings.value("Display.Columns.Max", 5).toInt();
             if (settings.contains("Page.Size"))
@@ -308,6 +309,26 @@ void Config::Load()
                 }
             }
 
+            {
+                const auto intermediate_image_format{ settings.value("Intermediate.Image.Format", "Png")
+                                                          .toString()
+                                                          .toStdString() };
+                m_IntermediateImageFormat = magic_enum::enum_cast<IntermediateImageFormat>(intermediate_image_format)
+                                                .value_or(IntermediateImageFormat::Png);
+            }
+
+            {
+                const auto upscale_optimization_level{ settings.value("Upscale.Optimization.Level", "All")
+                                                           .toString()
+                                                           .toStdString() };
+                m_UpscaleOptimizationLevel = magic_enum::enum_cast<UpscaleOptimizationLevel>(upscale_optimization_level)
+                                                 .value_or(UpscaleOptimizationLevel::All);
+            }
+            m_UpscaleIntraOpThreads = settings.value("Upscale.Threads.IntraOp", 0).toUInt();
+            m_UpscaleInterOpThreads = settings.value("Upscale.Threads.InterOp", 1).toUInt();
+            m_UpscaleCpuMemoryArena = settings.value("Upscale.Cpu.Memory.Arena", true).toBool();
+            m_UpscaleCacheSize = settings.value("Upscale.Cache.Size", 2048).toUInt();
+
             {
                 auto base_unit{ settings.value("Base.Unit") };
                 if (base_unit.isValid())
@@ -499,6 +520,7 @@ void Config::Save() const
             settings.setValue("Card.Order.Direction", ToQString(card_order_direction));
 
             settings.setValue("Max.Worker.Threads", m_MaxWorkerThreads);
+            settings.setValue("Max.Worker.Memory", m_MaxWorkerMemory);
             settings.setValue("Display.Columns", m_DisplayColumns);
             settings.setValue("Display.Columns.Max", m_MaxDisplayColumns);
             settings.setValue("Color.Cube", ToQString(m_ColorCube));
@@ -519,6 +541,16 @@ void Config::Save() const
                 settings.setValue("PDF.Backend.Jpg.Quality", m_JpgQuality.value());
             }
 
+            settings.setValue("Intermediate.Image.Format",
+                              ToQString(magic_enum::enum_name(m_IntermediateImageFormat)));
+
+            settings.setValue("Upscale.Optimization.Level",
+                              ToQString(magic_enum::enum_name(m_UpscaleOptimizationLevel)));
+            settings.setValue("Upscale.Threads.IntraOp", m_UpscaleIntraOpThreads);
+            settings.setValue("Upscale.Threads.InterOp", m_UpscaleInterOpThreads);
+            settings.setValue("Upscale.Cpu.Memory.Arena", m_UpscaleCpuMemoryArena);
+            settings.setValue("Upscale.Cache.Size", m_UpscaleCacheSize);
+
             const auto base_unit_name{ UnitName(m_BaseUnit) };
             settings.setValue("Base.Unit", ToQString(base_unit_name));
 
@@ -671,6 +703,15 @@ void Config::SetMaxWorkerThreads(uint32_t max_worker_threads)
     }
 }
 
+void Config::SetMaxWorkerMemory(uint32_t max_worker_memory)
+{
+    if (m_MaxWorkerMemory != max_worker_memory)
+    {
+        m_MaxWorkerMemory = max_worker_memory;
+        MaxWorkerMemoryChanged(max_worker_memory);
+    }
+}
+
 void Config::SetDisplayColumns(uint32_t display_columns)
 {
     if (m_DisplayColumns != display_columns &&
@@ -1,7 +1,8 @@
 #include <ppp/image.hpp>
 
+#include <algorithm>
 #include <bit>
-#include <ranges>
+#include <fstream>
 
 #include <dla/scalar_math.h>
 
@@ -11,6 +12,10 @@
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/opencv.hpp>
 
+#include <zstd.h>
+
+#include <ppp/color_cube_lut.hpp>
+#include <ppp/config_types.hpp>
 #include <ppp/svg/util.hpp>
 
 #include <ppp/profile/profile.hpp>
@@ -57,17 +62,96 @@ static uint32_t CRC(const uchar* buf, int len)
 }
 } // namespace pngcrc
 
+namespace intermediate
+{
+// Raw pixels compressed with zstd, prefixed by this header
+// Only meant for files we write and read on the same machine, so no care is taken of endianness
+struct Header
+{
+    std::array<char, 4> m_Magic;
+    uint32_t m_Version;
+    uint32_t m_Width;
+    uint32_t m_Height;
+    uint32_t m_Type;
+};
+static_assert(sizeof(Header) == 20);
+
+static constexpr std::array<char, 4> c_Magic{ 'P', 'P', 'P', 'Z' };
+static constexpr uint32_t c_Version{ 2 };
+
+// Higher levels are much slower to write for barely smaller files
+static constexpr int c_CompressionLevel{ 1 };
+
+static std::optional<Header> ReadHeader(std::istream& file)
+{
+    Header header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        header.m_Magic != c_Magic ||
+        header.m_Version != c_Version ||
+        CV_MAT_DEPTH(header.m_Type) != CV_8U)
+    {
+        return std::nullopt;
+    }
+    return header;
+}
+
+static cv::Mat ReadPixels(std::istream& file, const Header& header)
+{
+    TRACY_AUTO_SCOPE();
+
+    const auto pixels_begin{ file.tellg() };
+    file.seekg(0, std::ios::end);
+    const auto compressed_size{ static_cast<size_t>(file.tellg() - pixels_begin) };
+    file.seekg(pixels_begin);
+
+    std::vector<char> compressed(compressed_size);
+    if (!file.read(compressed.data(), static_cast<std::streamsize>(compressed_size)))
+    {
+        return {};
+    }
+
+    cv::Mat pixels{
+        static_cast<int>(header.m_Height),
+        static_cast<int>(header.m_Width),
+        static_cast<int>(header.m_Type),
+    };
+    const size_t pixels_size{ pixels.total() * pixels.elemSize() };
+    const size_t decompressed_size{ ZSTD_decompress(pixels.data, pixels_size, compressed.data(), compressed.size()) };
+    if (ZSTD_isError(decompressed_size) || decompressed_size != pixels_size)
+    {
+        return {};
+    }
+    return pixels;
+}
+} // namespace intermediate
+
+// Everything downstream works on 8-bit images, so 16-bit images are scaled down
+// and images of any other depth are treated as unreadable
+static cv::Mat NormalizeDepth(cv::Mat img)
+{
+    switch (img.depth())
+    {
+    case CV_8U:
+        return img;
+    case CV_16U:
+        img.convertTo(img, CV_MAKETYPE(CV_8U, img.channels()), 1 / 256.0f);
+        return img;
+    default:
+        return {};
+    }
+}
+
 ImageMetaData ImageMetaData::Rotate(Rotation rotation) const
 {
     switch (rotation)
     {
     case Rotation::Degree90:
         [[fallthrough]];
-    case Rotation::Degree180:
+    case Rotation::Degree270:
         return ImageMetaData{
             .m_Size{ dla::rotl(m_Size) },
         };
-    case Rotation::Degree270:
+    case Rotation::Degree180:
         [[fallthrough]];
     default:
         return *this;
@@ -142,20 +226,15 @@ Image Image::Read(const fs::path& path)
 {
     TRACY_AUTO_SCOPE();
 
-    Image img{};
-    img.m_Impl = cv::imread(path.string().c_str(), cv::IMREAD_UNCHANGED);
-
-    switch (img.m_Impl.depth())
+    if (std::ifstream file{ path, std::ios::binary })
     {
-    case CV_8U:
-        break;
-    case CV_16U:
-        img.m_Impl.convertTo(img.m_Impl, CV_MAKETYPE(CV_8U, img.m_Impl.channels()), 1 / 256.0f);
-        break;
-    default:
-        return {};
+        if (const auto header{ intermediate::ReadHeader(file) })
+        {
+            return Image{ intermediate::ReadPixels(file, header.value()) };
+        }
     }
-    return img;
+
+    return Image{ NormalizeDepth(cv::imread(path.string().c_str(), cv::IMREAD_UNCHANGED)) };
 }
 
 bool Image::Write(const fs::path& path, std::optional<int32_t> png_compression, std::optional<int32_t> jpg_quality) const
@@ -220,63 +299,62 @@ bool Image::Write(const fs::path& path, std::optional<int32_t> png_compression,
         std::vector<uchar> buf;
         if (cv::imencode(".png", m_Impl, buf, png_params))
         {
-            // Squeeze in a pHYs chunk that contains dpi
+            // The signature is followed by the IHDR chunk, which always has the same size
+            // The pHYs chunk only has to come before the first IDAT, so we put it right
+            // after IHDR and write the file around it, instead of searching and shifting
+            // the encoded image
+            static constexpr size_t c_SignatureSize{ 8 };
+            static constexpr size_t c_IhdrChunkSize{ 4 + 4 + 13 + 4 };
+            static constexpr size_t c_PhysIdx{ c_SignatureSize + c_IhdrChunkSize };
+            if (buf.size() < c_PhysIdx ||
+                std::string_view{ reinterpret_cast<const char*>(&buf[c_SignatureSize + 4]), 4 } != "IHDR")
             {
-                // Find first IDAT section ...
-                size_t idat_idx{};
-                for (size_t j = 0; j < buf.size() - 4; j++)
-                {
-                    if (std::string_view{ reinterpret_cast<std::string_view::value_type*>(&buf[j]), 4 } == "IDAT")
-                    {
-                        idat_idx = j - 4;
-                        break;
-                    }
-                }
+                return false;
+            }
 
-                // Create pHYs chunk...
-                struct
-                {
-                    uint32_t m_Size;
-                    std::array<char, 4> m_Name;
-                    uint32_t m_DotsPerMeterX;
-                    uint32_t m_DotsPerMeterY;
-                    uint8_t m_Unit;
-                } const phys_chunk{
-                    std::byteswap(9u),
-                    { 'p', 'H', 'Y', 's' },
-                    std::byteswap(static_cast<uint32_t>(density.value)),
-                    std::byteswap(static_cast<uint32_t>(density.value)),
-                    1, // this just means meter
-                };
+            // Create pHYs chunk...
+            struct
+            {
+                uint32_t m_Size;
+                std::array<char, 4> m_Name;
+                uint32_t m_DotsPerMeterX;
+                uint32_t m_DotsPerMeterY;
+                uint8_t m_Unit;
+            } const phys_chunk{
+                std::byteswap(9u),
+                { 'p', 'H', 'Y', 's' },
+                std::byteswap(static_cast<uint32_t>(density.value)),
+                std::byteswap(static_cast<uint32_t>(density.value)),
+                1, // this just means meter
+            };
 
-                // size + name + data + padding
-                static constexpr uint32_t c_PhysChunkSize{ 4 + 4 + 9 };
-                // chunk + padding
-                static_assert(sizeof(phys_chunk) == c_PhysChunkSize + 3);
-                // verify padding is at the end ...
-                static_assert(offsetof(decltype(phys_chunk), m_Unit) == c_PhysChunkSize - 1);
-
-                // only the name and data
-                const auto* crc_data{ reinterpret_cast<const uchar*>(&phys_chunk) + 4 };
-                const auto crc_data_size{ c_PhysChunkSize - 4 };
-                const uint32_t crc{ std::byteswap(pngcrc::CRC(crc_data, crc_data_size)) };
-
-                // chunk + crc
-                std::array<uchar, c_PhysChunkSize + 4> phys_buf;
-                std::memcpy(phys_buf.data(), &phys_chunk, c_PhysChunkSize);
-                std::memcpy(phys_buf.data() + c_PhysChunkSize, &crc, 4);
-                buf.insert(buf.begin() + idat_idx, phys_buf.begin(), phys_buf.end());
-            }
+            // size + name + data + padding
+            static constexpr uint32_t c_PhysChunkSize{ 4 + 4 + 9 };
+            // chunk + padding
+            static_assert(sizeof(phys_chunk) == c_PhysChunkSize + 3);
+            // verify padding is at the end ...
+            static_assert(offsetof(decltype(phys_chunk), m_Unit) == c_PhysChunkSize - 1);
+
+            // only the name and data
+            const auto* crc_data{ reinterpret_cast<const uchar*>(&phys_chunk) + 4 };
+            const auto crc_data_size{ c_PhysChunkSize - 4 };
+            const uint32_t crc{ std::byteswap(pngcrc::CRC(crc_data, crc_data_size)) };
+
+            // chunk + crc
+            std::array<uchar, c_PhysChunkSize + 4> phys_buf;
+            std::memcpy(phys_buf.data(), &phys_chunk, c_PhysChunkSize);
+            std::memcpy(phys_buf.data() + c_PhysChunkSize, &crc, 4);
 
             if (FILE * file{ fopen(path.string().c_str(), "wb") })
             {
-                fwrite(buf.data(), 1, buf.size(), file);
+                const bool written{
+                    fwrite(buf.data(), 1, c_PhysIdx, file) == c_PhysIdx &&
+                    fwrite(phys_buf.data(), 1, phys_buf.size(), file) == phys_buf.size() &&
+                    fwrite(buf.data() + c_PhysIdx, 1, buf.size() - c_PhysIdx, file) == buf.size() - c_PhysIdx
+                };
                 fclose(file);
+                return written;
             }
-
-            cv::imdecode(buf, cv::IMREAD_UNCHANGED);
-
-            return true;
         }
 
         return false;
@@ -331,6 +409,53 @@ bool Image::Write(const fs::path& path, std::optional<int32_t> png_compression,
     }
 }
 
+bool Image::WriteIntermediate(const fs::path& path, IntermediateImageFormat format, ::Size dimensions) const
+{
+    TRACY_AUTO_SCOPE();
+
+    // Jpg crops are kept as jpg, the pdf backends embed those without re-encoding
+    const bool is_jpg{ path.extension() == ".jpg" || path.extension() == ".jpeg" };
+    if (format == IntermediateImageFormat::Png || is_jpg)
+    {
+        return Write(path, 3, 100, dimensions);
+    }
+
+    const cv::Mat pixels{ m_Impl.isContinuous() ? m_Impl : m_Impl.clone() };
+    const size_t pixels_size{ pixels.total() * pixels.elemSize() };
+
+    const intermediate::Header header{
+        .m_Magic{ intermediate::c_Magic },
+        .m_Version{ intermediate::c_Version },
+        .m_Width{ static_cast<uint32_t>(pixels.cols) },
+        .m_Height{ static_cast<uint32_t>(pixels.rows) },
+        .m_Type{ static_cast<uint32_t>(pixels.type()) },
+    };
+
+    std::vector<char> buf(sizeof(header) + ZSTD_compressBound(pixels_size));
+    std::memcpy(buf.data(), &header, sizeof(header));
+    const size_t compressed_size{
+        ZSTD_compress(buf.data() + sizeof(header),
+                      buf.size() - sizeof(header),
+                      pixels.data,
+                      pixels_size,
+                      intermediate::c_CompressionLevel)
+    };
+    if (ZSTD_isError(compressed_size))
+    {
+        return false;
+    }
+
+    if (FILE * file{ fopen(path.string().c_str(), "wb") })
+    {
+        const size_t file_size{ sizeof(header) + compressed_size };
+        const bool written{ fwrite(buf.data(), 1, file_size, file) == file_size };
+        fclose(file);
+        return written;
+    }
+
+    return false;
+}
+
 Image Image::Decode(const EncodedImage& buffer)
 {
     return Decode(EncodedImageView{ buffer });
@@ -340,15 +465,26 @@ Image Image::Decode(EncodedImageView buffer)
 {
     TRACY_AUTO_SCOPE();
 
-    Image img{};
     cv::InputArray cv_buffer{ reinterpret_cast<const uchar*>(buffer.data()),
                               static_cast<int>(buffer.size()) };
-    img.m_Impl = cv::imdecode(cv_buffer, cv::IMREAD_UNCHANGED);
-    return img;
+    return Image{ NormalizeDepth(cv::imdecode(cv_buffer, cv::IMREAD_UNCHANGED)) };
 }
 
 ImageMetaData Image::ReadMetaData(const fs::path& path)
 {
+    if (std::ifstream file{ path, std::ios::binary })
+    {
+        if (const auto header{ intermediate::ReadHeader(file) })
+        {
+            return ImageMetaData{
+                .m_Size{
+                    static_cast<float>(header->m_Width) * 1_pix,
+                    static_cast<float>(header->m_Height) * 1_pix,
+                },
+            };
+        }
+    }
+
     const auto info{ imageinfo::parse<imageinfo::FilePathReader>(path.string()) };
     return ImageMetaData{
         .m_Size{
@@ -667,51 +803,60 @@ Image Image::RoundCorners(::Size real_size, ::Length corner_radius) const
         return *this;
     }
 
-    cv::Mat mask{ m_Impl.rows, m_Impl.cols, CV_8UC1, cv::Scalar{ 0 } };
+    cv::Mat out_impl;
+    switch (m_Impl.channels())
     {
-        const cv::Point top_left_wide{ 0, corner_radius_pixels };
-        const cv::Point bottom_right_wide{ m_Impl.cols, m_Impl.rows - corner_radius_pixels };
-        const cv::Point top_left_tall{ corner_radius_pixels, 0 };
-        const cv::Point bottom_right_tall{ m_Impl.cols - corner_radius_pixels, m_Impl.rows };
-        const auto draw_rect{
-            [&](const cv::Point& top_left, const cv::Point& bottom_right)
-            {
-                cv::rectangle(mask, top_left, bottom_right, cv::Scalar(255), cv::FILLED);
-            },
-        };
-        draw_rect(top_left_wide, bottom_right_wide);
-        draw_rect(top_left_tall, bottom_right_tall);
-
-        const cv::Point top_left{ corner_radius_pixels, corner_radius_pixels };
-        const cv::Point bottom_left{ m_Impl.cols - 1 - corner_radius_pixels, corner_radius_pixels };
-        const cv::Point bottom_right{ m_Impl.cols - 1 - corner_radius_pixels, m_Impl.rows - 1 - corner_radius_pixels };
-        const cv::Point top_right{ corner_radius_pixels, m_Impl.rows - 1 - corner_radius_pixels };
-        const auto draw_arc{
-            [&](const cv::Point& pos)
-            {
-                cv::circle(mask, pos, corner_radius_pixels, cv::Scalar(255), cv::FILLED, cv::LINE_AA);
-            },
-        };
-        draw_arc(top_left);
-        draw_arc(bottom_left);
-        draw_arc(bottom_right);
-        draw_arc(top_right);
+    case 4:
+        out_impl = m_Impl.clone();
+        break;
+    case 3:
+        cv::cvtColor(m_Impl, out_impl, cv::COLOR_BGR2BGRA);
+        break;
+    default:
+        cv::cvtColor(m_Impl, out_impl, cv::COLOR_GRAY2BGRA);
+        break;
     }
 
-    std::vector<cv::Mat> out_channels;
-    cv::split(m_Impl, out_channels);
-    if (out_channels.size() != 4)
-    {
-        out_channels.push_back(std::move(mask));
-    }
-    else
-    {
-        cv::multiply(mask, out_channels[3], out_channels[3]);
-    }
+    // Everything outside of the corners stays untouched, so we only build the mask
+    // for one corner at a time and apply it to that corner in place
+    const int corner_size{ std::min({ corner_radius_pixels, out_impl.cols / 2, out_impl.rows / 2 }) };
+    const cv::Point top_left{ corner_radius_pixels, corner_radius_pixels };
+    const cv::Point bottom_left{ out_impl.cols - 1 - corner_radius_pixels, corner_radius_pixels };
+    const cv::Point bottom_right{ out_impl.cols - 1 - corner_radius_pixels, out_impl.rows - 1 - corner_radius_pixels };
+    const cv::Point top_right{ corner_radius_pixels, out_impl.rows - 1 - corner_radius_pixels };
+
+    cv::Mat mask{ corner_size, corner_size, CV_8UC1 };
+    cv::Mat alpha{ corner_size, corner_size, CV_8UC1 };
+    const auto round_corner{
+        [&](const cv::Point& corner_origin, const cv::Point& arc_center)
+        {
+            // Same shapes as a mask of the whole image would have, shifted into the corner
+            const cv::Point offset{ -corner_origin.x, -corner_origin.y };
+            mask.setTo(cv::Scalar{ 0 });
+            cv::rectangle(mask,
+                          cv::Point{ 0, corner_radius_pixels } + offset,
+                          cv::Point{ out_impl.cols, out_impl.rows - corner_radius_pixels } + offset,
+                          cv::Scalar{ 255 },
+                          cv::FILLED);
+            cv::rectangle(mask,
+                          cv::Point{ corner_radius_pixels, 0 } + offset,
+                          cv::Point{ out_impl.cols - corner_radius_pixels, out_impl.rows } + offset,
+                          cv::Scalar{ 255 },
+                          cv::FILLED);
+            cv::circle(mask, arc_center + offset, corner_radius_pixels, cv::Scalar{ 255 }, cv::FILLED, cv::LINE_AA);
+
+            cv::Mat corner{ out_impl(cv::Rect{ corner_origin, cv::Size{ corner_size, corner_size } }) };
+            cv::extractChannel(corner, alpha, 3);
+            cv::multiply(alpha, mask, alpha, 1.0 / 255);
+            cv::insertChannel(alpha, corner, 3);
+        },
+    };
+    round_corner(cv::Point{ 0, 0 }, top_left);
+    round_corner(cv::Point{ out_impl.cols - corner_size, 0 }, bottom_left);
+    round_corner(cv::Point{ out_impl.cols - corner_size, out_impl.rows - corner_size }, bottom_right);
+    round_corner(cv::Point{ 0, out_impl.rows - corner_size }, top_right);
 
-    cv::Mat out_impl;
-    cv::merge(out_channels, out_impl);
-    return Image{ out_impl };
+    return Image{ std::move(out_impl) };
 }
 
 Image Image::ClipSvg(const Svg& svg) const
@@ -829,178 +974,61 @@ Image Image::FillHoles() const
         return Image{ m_Impl };
     }
 
-    const auto channels{
-        [this]()
-        {
-            std::vector<cv::Mat> split;
-            cv::split(m_Impl, split);
-            return split;
-        }()
-    };
-
-    const auto& a{ channels[3] };
-
-    cv::Mat mask;
-    cv::threshold(a, mask, 254, 255, cv::THRESH_BINARY_INV);
-
-    const auto& b{ channels[0] };
-    const auto& g{ channels[1] };
-    const auto& r{ channels[2] };
-    cv::Mat bgr;
-    std::vector<cv::Mat> bgr_channels{ b, g, r };
-    cv::merge(bgr_channels, bgr);
-
-    static constexpr auto c_FillHolesImpl{
-        [](cv::Mat& bgr, const cv::Mat& mask)
+    // Threshold alpha straight from the interleaved image, any pixel that is not fully
+    // opaque is a hole, if there are none the image can be returned as is
+    cv::Mat mask{ m_Impl.rows, m_Impl.cols, CV_8UC1 };
+    bool has_holes{ false };
+    for (int y = 0; y < m_Impl.rows; y++)
+    {
+        const cv::Vec4b* row{ m_Impl.ptr<cv::Vec4b>(y) };
+        uchar* mask_row{ mask.ptr<uchar>(y) };
+        for (int x = 0; x < m_Impl.cols; x++)
         {
-            std::vector<std::vector<cv::Point>> contours;
-            cv::findContours(mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
-
-            for (const auto& contour : contours)
-            {
-                const cv::Rect roi{ cv::boundingRect(contour) };
-
-                // Add a 2-pixel padding for context to inpaint
-                static constexpr int c_Padding{ 2 };
-                const auto x{ std::max(0, roi.x - c_Padding) };
-                const auto y{ std::max(0, roi.y - c_Padding) };
-                const auto w{ std::min(bgr.cols - x, roi.width + (c_Padding * 2)) };
-                const auto h{ std::min(bgr.rows - y, roi.height + (c_Padding * 2)) };
-                const cv::Rect roi_padded{ x, y, w, h };
-
-                cv::Mat bgr_local{ bgr(roi_padded) };
-                cv::Mat mask_local{ mask(roi_padded) };
-
-                static constexpr auto c_InpaintRadius{ 1.0 };
-
-                cv::Mat inpainted_local;
-                cv::inpaint(bgr_local, mask_local, inpainted_local, c_InpaintRadius, cv::INPAINT_TELEA);
-                inpainted_local.copyTo(bgr_local);
-            }
+            const bool is_hole{ row[x][3] != 255 };
+            mask_row[x] = is_hole ? 255 : 0;
+            has_holes |= is_hole;
         }
-    };
-    c_FillHolesImpl(bgr, mask);
-
-    const auto a_opaque{ cv::Mat::ones(a.size(), a.type()) * 255 };
-
-    std::vector<cv::Mat> channels_filled;
-    cv::split(bgr, channels_filled);
-    channels_filled.push_back(a_opaque);
-
-    cv::Mat img_filled;
-    cv::merge(channels_filled, img_filled);
-
-    return Image{ img_filled };
-}
-
-template<int Channels>
-struct CubeFilter
-{
-    const cv::Mat& m_ColorCube;
-    const cv::Mat& m_InputImg;
-    cv::Mat& m_OutputImg;
-
-    using element_t = std::conditional_t<Channels == 3, cv::Vec3b, cv::Vec4b>;
+    }
 
-    void operator()(int idx)
+    if (!has_holes)
     {
-        const int x{ idx % m_InputImg.rows };
-        const int y{ idx / m_InputImg.rows };
-        const auto& col{ m_InputImg.at<element_t>(x, y) };
-
-        auto& out_element{ m_OutputImg.at<element_t>(x, y) };
-        out_element = col;
-
-        const int cube_size_minus_one{ m_ColorCube.cols - 1 };
-        const float r{ (static_cast<float>(col[2]) / 255) * cube_size_minus_one };
-        const float g{ (static_cast<float>(col[1]) / 255) * cube_size_minus_one };
-        const float b{ (static_cast<float>(col[0]) / 255) * cube_size_minus_one };
-
-#ifdef NDEBUG
-        // In Release we interpolate between the eight cube-elements
-
-        const int r_lo{ static_cast<int>(std::floor(r)) };
-        const int r_hi{ static_cast<int>(std::ceil(r)) };
-        const float r_frac{ r - static_cast<float>(r_lo) };
-
-        const int g_lo{ static_cast<int>(std::floor(g)) };
-        const int g_hi{ static_cast<int>(std::ceil(g)) };
-        const float g_frac{ g - static_cast<float>(g_lo) };
-
-        const int b_lo{ static_cast<int>(std::floor(b)) };
-        const int b_hi{ static_cast<int>(std::ceil(b)) };
-        const float b_frac{ b - static_cast<float>(b_lo) };
-
-        static constexpr auto c_LinearInterpolate{
-            [](std::array<ColorRGB32f, 2> values, float alpha)
-            {
-                return values[0] * (1 - alpha) + values[1] * alpha;
-            },
-        };
-
-        static constexpr auto c_BilinearInterpolate{
-            [](std::array<ColorRGB32f, 4> values, std::array<float, 2> alphas)
-            {
-                const std::array interim_values{
-                    c_LinearInterpolate(std::array{ values[0], values[1] }, alphas[0]),
-                    c_LinearInterpolate(std::array{ values[2], values[3] }, alphas[0]),
-                };
-                return c_LinearInterpolate(interim_values, alphas[1]);
-            },
-        };
-
-        static constexpr auto c_TrilinearInterpolate{
-            [](std::array<ColorRGB32f, 8> values, std::array<float, 3> alphas)
-            {
-                const std::array interim_values{
-                    c_BilinearInterpolate(std::array{ values[0], values[1], values[2], values[3] }, std::array{ alphas[0], alphas[1] }),
-                    c_BilinearInterpolate(std::array{ values[4], values[5], values[6], values[7] }, std::array{ alphas[0], alphas[1] }),
-                };
-                return c_LinearInterpolate(interim_values, alphas[2]);
-            },
-        };
+        return Image{ m_Impl };
+    }
 
-        auto color_at{
-            [&](int r, int g, int b)
-            {
-                const auto v{ m_ColorCube.at<cv::Vec3b>(r, g, b) };
-                return ColorRGB32f{
-                    static_cast<float>(v[0]),
-                    static_cast<float>(v[1]),
-                    static_cast<float>(v[2]),
-                };
-            },
-        };
+    std::vector<std::vector<cv::Point>> contours;
+    cv::findContours(mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
 
-        std::array corners{
-            color_at(r_lo, g_lo, b_lo),
-            color_at(r_hi, g_lo, b_lo),
+    // Every hole lies within the bounding box of its contour, so only those regions
+    // are converted for inpainting and written back, now fully opaque
+    cv::Mat img_filled{ m_Impl.clone() };
+    cv::Mat bgr_local;
+    cv::Mat inpainted_local;
+    for (const auto& contour : contours)
+    {
+        const cv::Rect roi{ cv::boundingRect(contour) };
 
-            color_at(r_lo, g_hi, b_lo),
-            color_at(r_hi, g_hi, b_lo),
+        // Add a 2-pixel padding for context to inpaint
+        static constexpr int c_Padding{ 2 };
+        const auto x{ std::max(0, roi.x - c_Padding) };
+        const auto y{ std::max(0, roi.y - c_Padding) };
+        const auto w{ std::min(img_filled.cols - x, roi.width + (c_Padding * 2)) };
+        const auto h{ std::min(img_filled.rows - y, roi.height + (c_Padding * 2)) };
+        const cv::Rect roi_padded{ x, y, w, h };
 
-            color_at(r_lo, g_lo, b_hi),
-            color_at(r_hi, g_lo, b_hi),
+        cv::Mat img_local{ img_filled(roi_padded) };
+        cv::Mat mask_local{ mask(roi_padded) };
 
-            color_at(r_lo, g_hi, b_hi),
-            color_at(r_hi, g_hi, b_hi),
-        };
+        static constexpr auto c_InpaintRadius{ 1.0 };
 
-        const ColorRGB32f interpolated{ c_TrilinearInterpolate(corners, { r_frac, g_frac, b_frac }) };
-        out_element[0] = static_cast<uchar>(interpolated.r);
-        out_element[1] = static_cast<uchar>(interpolated.g);
-        out_element[2] = static_cast<uchar>(interpolated.b);
-#else
-        // In Debug we just get the nearest element
-        const auto res{ m_ColorCube.at<cv::Vec3b>((int)r, (int)g, (int)b) };
-        out_element[0] = static_cast<uchar>(res[0]);
-        out_element[1] = static_cast<uchar>(res[1]);
-        out_element[2] = static_cast<uchar>(res[2]);
-#endif
+        cv::cvtColor(img_local, bgr_local, cv::COLOR_BGRA2BGR);
+        cv::inpaint(bgr_local, mask_local, inpainted_local, c_InpaintRadius, cv::INPAINT_TELEA);
+        cv::cvtColor(inpainted_local, img_local, cv::COLOR_BGR2BGRA);
     }
-};
 
-Image Image::ApplyColorCube(const cv::Mat& color_cube) const
+    return Image{ std::move(img_filled) };
+}
+
+Image Image::ApplyColorCube(const ColorCubeLut& color_cube, CancellationToken cancel) const
 {
     TRACY_AUTO_SCOPE();
 
@@ -1009,18 +1037,18 @@ Image Image::ApplyColorCube(const cv::Mat& color_cube) const
         return *this;
     }
 
-    Image filtered{ *this };
-    auto flat_range{ std::views::iota(0, m_Impl.rows * m_Impl.cols) };
-    switch (m_Impl.channels())
+#ifdef NDEBUG
+    // In Release we interpolate between the eight cube-elements
+    static constexpr auto c_Interpolation{ ColorCubeLut::Interpolation::Trilinear };
+#else
+    // In Debug we just get the nearest element
+    static constexpr auto c_Interpolation{ ColorCubeLut::Interpolation::Nearest };
+#endif
+
+    Image filtered{};
+    if (!color_cube.Apply(m_Impl, filtered.m_Impl, c_Interpolation, cancel))
     {
-    case 3:
-        std::for_each(flat_range.begin(), flat_range.end(), CubeFilter<3>{ color_cube, m_Impl, filtered.m_Impl });
-        break;
-    case 4:
-        std::for_each(flat_range.begin(), flat_range.end(), CubeFilter<4>{ color_cube, m_Impl, filtered.m_Impl });
-        break;
-    default:
-        break;
+        return Image{};
     }
     return filtered;
 }
@@ -0,0 +1,205 @@
+#include <ppp/image_allocator.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include <ppp/util/log.hpp>
+
+#include <ppp/profile/profile.hpp>
+
+float ImageAllocatorStats::HitRate() const
+{
+    const uint64_t total{ m_Hits + m_Misses };
+    return total == 0
+               ? 0.0f
+               : static_cast<float>(m_Hits) / static_cast<float>(total);
+}
+
+// Same as OpenCV's default allocator, except that buffers above a certain size are
+// pooled by their exact size instead of freed
+class PooledMatAllocator : public cv::MatAllocator
+{
+  public:
+    virtual cv::UMatData* allocate(int dims,
+                                   const int* sizes,
+                                   int type,
+                                   void* data,
+                                   size_t* step,
+                                   cv::AccessFlag /*flags*/,
+                                   cv::UMatUsageFlags /*usage_flags*/) const override
+    {
+        size_t total{ CV_ELEM_SIZE(type) };
+        for (int i = dims - 1; i >= 0; i--)
+        {
+            if (step != nullptr)
+            {
+                if (data != nullptr && step[i] != CV_AUTOSTEP)
+                {
+                    CV_Assert(total <= step[i]);
+                    total = step[i];
+                }
+                else
+                {
+                    step[i] = total;
+                }
+            }
+            total *= sizes[i];
+        }
+
+        auto* u{ new cv::UMatData{ this } };
+        u->size = total;
+        if (data != nullptr)
+        {
+            u->data = u->origdata = static_cast<uchar*>(data);
+            u->flags |= cv::UMatData::USER_ALLOCATED;
+        }
+        else
+        {
+            u->data = u->origdata = static_cast<uchar*>(Acquire(total));
+        }
+        return u;
+    }
+
+    virtual bool allocate(cv::UMatData* u,
+                          cv::AccessFlag /*flags*/,
+                          cv::UMatUsageFlags /*usage_flags*/) const override
+    {
+        return u != nullptr;
+    }
+
+    virtual void deallocate(cv::UMatData* u) const override
+    {
+        if (u == nullptr)
+        {
+            return;
+        }
+
+        CV_Assert(u->urefcount == 0);
+        CV_Assert(u->refcount == 0);
+        if (!(u->flags & cv::UMatData::USER_ALLOCATED))
+        {
+            Release(u->origdata, u->size);
+            u->origdata = nullptr;
+        }
+        delete u;
+    }
+
+    ImageAllocatorStats Stats() const
+    {
+        return ImageAllocatorStats{
+            .m_Hits{ m_Hits.load(std::memory_order_relaxed) },
+            .m_Misses{ m_Misses.load(std::memory_order_relaxed) },
+            .m_BytesRecycled{ m_BytesRecycled.load(std::memory_order_relaxed) },
+            .m_BytesPooled{ m_BytesPooled.load(std::memory_order_relaxed) },
+        };
+    }
+
+    void Trim() const
+    {
+        TRACY_SCOPED_LOCK(m_Mutex);
+        for (auto& [_, buffers] : m_Buffers)
+        {
+            for (void* buffer : buffers)
+            {
+                cv::fastFree(buffer);
+            }
+        }
+        m_Buffers.clear();
+        m_BytesPooled.store(0, std::memory_order_relaxed);
+    }
+
+  private:
+    void* Acquire(size_t size) const
+    {
+        if (size >= c_MinPooledSize)
+        {
+            TRACY_SCOPED_LOCK(m_Mutex);
+            auto it{ m_Buffers.find(size) };
+            if (it != m_Buffers.end() && !it->second.empty())
+            {
+                void* buffer{ it->second.back() };
+                it->second.pop_back();
+                m_BytesPooled.fetch_sub(size, std::memory_order_relaxed);
+                m_Hits.fetch_add(1, std::memory_order_relaxed);
+                m_BytesRecycled.fetch_add(size, std::memory_order_relaxed);
+                return buffer;
+            }
+            m_Misses.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        return cv::fastMalloc(size);
+    }
+
+    void Release(void* buffer, size_t size) const
+    {
+        if (size >= c_MinPooledSize)
+        {
+            TRACY_SCOPED_LOCK(m_Mutex);
+            auto& buffers{ m_Buffers[size] };
+            if (buffers.size() < c_MaxBuffersPerSize &&
+                m_BytesPooled.load(std::memory_order_relaxed) + size <= c_MaxPooledBytes)
+            {
+                buffers.push_back(buffer);
+                m_BytesPooled.fetch_add(size, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        cv::fastFree(buffer);
+    }
+
+    // Small buffers are cheap to allocate and come in too many sizes to be worth pooling
+    static inline constexpr size_t c_MinPooledSize{ 256 * 1024 };
+    static inline constexpr size_t c_MaxBuffersPerSize{ 32 };
+    // Enough for a handful of card-sized images at high resolution, the pool is
+    // trimmed whenever cropping or pdf generation finishes so this is only held while busy
+    static inline constexpr uint64_t c_MaxPooledBytes{ 256 * 1024 * 1024 };
+
+    TRACY_DECLARE_MUTEX(mutable std::mutex, m_Mutex);
+    mutable std::unordered_map<size_t, std::vector<void*>> m_Buffers;
+
+    mutable std::atomic_uint64_t m_Hits{ 0 };
+    mutable std::atomic_uint64_t m_Misses{ 0 };
+    mutable std::atomic_uint64_t m_BytesRecycled{ 0 };
+    mutable std::atomic_uint64_t m_BytesPooled{ 0 };
+};
+
+static PooledMatAllocator& GetAllocator()
+{
+    // Never destroyed, images freed during static destruction still return their buffers
+    static PooledMatAllocator* s_Allocator{ new PooledMatAllocator };
+    return *s_Allocator;
+}
+
+void InstallPooledImageAllocator()
+{
+    cv::Mat::setDefaultAllocator(&GetAllocator());
+}
+
+ImageAllocatorStats GetImageAllocatorStats()
+{
+    return GetAllocator().Stats();
+}
+
+void TrimImageAllocator()
+{
+    GetAllocator().Trim();
+}
+
+void LogImageAllocatorStats(std::string_view reason)
+{
+    static constexpr uint64_t c_MiB{ 1024 * 1024 };
+
+    const ImageAllocatorStats stats{ GetImageAllocatorStats() };
+    LogInfo("{} - Image allocator: {} hits, {} misses ({:.0f}% hit rate), {} MiB recycled, {} MiB pooled",
+            reason,
+            stats.m_Hits,
+            stats.m_Misses,
+            stats.HitRate() * 100.0f,
+            stats.m_BytesRecycled / c_MiB,
+            stats.m_BytesPooled / c_MiB);
+}
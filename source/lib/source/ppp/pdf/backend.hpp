@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <functional>
 #include <memory>
 #include <ranges>
 #include <span>
@@ -24,6 +25,41 @@ std::unique_ptr<PdfDocument> CreatePdfDocument(PdfBackend backend,
 bool IsPageWriteThreadSafe(PdfBackend backend);
 bool IsImageCacheThreadSafe(PdfBackend backend);
 
+// Mixes value into hash, for hashing keys that consist of multiple fields
+inline void HashCombine(size_t& hash, size_t value)
+{
+    hash ^= value + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+}
+
+// Identifies an image in a pdf, the same image drawn at different sizes or
+// rotations has to be cached separately
+struct PdfImageKey
+{
+    fs::path m_Path;
+    Size m_Size;
+    Image::Rotation m_Rotation;
+
+    bool operator==(const PdfImageKey& rhs) const
+    {
+        return m_Rotation == rhs.m_Rotation &&
+               m_Size == rhs.m_Size &&
+               m_Path == rhs.m_Path;
+    }
+};
+
+template<>
+struct std::hash<PdfImageKey>
+{
+    size_t operator()(const PdfImageKey& key) const noexcept
+    {
+        size_t hash{ std::hash<fs::path>{}(key.m_Path) };
+        HashCombine(hash, std::hash<float>{}(key.m_Size.x / 1_mm));
+        HashCombine(hash, std::hash<float>{}(key.m_Size.y / 1_mm));
+        HashCombine(hash, static_cast<size_t>(key.m_Rotation));
+        return hash;
+    }
+};
+
 class PdfPage
 {
   public:
@@ -146,4 +182,7 @@ class PdfDocument
         PixelDensity m_MaxDensity;
     };
     virtual void PreCacheImage(ImageCacheData data) = 0;
+
+    // Called once all images are cached, after this the cache is read without locking
+    virtual void FinishImageCache() = 0;
 };
@@ -1,17 +1,20 @@
 #include <ppp/pdf/generate.hpp>
 
+#include <latch>
+#include <mutex>
 #include <ranges>
+#include <unordered_map>
 
 #include <QFile>
-#include <QRunnable>
-#include <QThreadPool>
 
 #include <fmt/chrono.h>
 
 #include <dla/scalar_math.h>
 #include <dla/vector_math.h>
 
+#include <ppp/image_allocator.hpp>
 #include <ppp/util/log.hpp>
+#include <ppp/worker_pools.hpp>
 
 #include <ppp/project/image_ops.hpp>
 #include <ppp/project/project.hpp>
@@ -21,42 +24,27 @@
 
 #include <ppp/profile/profile.hpp>
 
-class PdfWorker : public QRunnable
-{
-  public:
-    PdfWorker(
-        std::atomic_uint32_t& work_done,
-        std::function<void()> work)
-        : m_WorkDone{ work_done }
-        , m_Work{ std::move(work) }
-    {
-    }
-
-    virtual void run() override
-    {
-        m_Work();
-        m_WorkDone.fetch_add(1, std::memory_order::release);
-    }
+// Pages are queued ahead of image caching, so that finished pages don't wait behind images
+inline constexpr int c_PageWorkPriority{ 1 };
 
-  private:
-    std::atomic_uint32_t& m_WorkDone;
-    std::function<void()> m_Work;
-};
-
-using ImageRef = std::reference_wrapper<const fs::path>;
-struct ImageCacheData
+struct UniqueImages
 {
-    ImageRef m_Image;
-    Size m_Size;
-    Image::Rotation m_Rotation;
+    // Keys refer to card names here, not to the files that end up in the pdf
+    std::vector<PdfImageKey> m_Images;
+
+    // Indices into m_Images of the images drawn on each page
+    std::vector<std::vector<size_t>> m_PageImages;
 };
 
-std::vector<ImageCacheData> CollectUniqueImages(const std::vector<Page>& pages,
-                                                const std::vector<PageImageTransform>& transforms)
+UniqueImages CollectUniqueImages(const std::vector<Page>& pages,
+                                 const std::vector<PageImageTransform>& transforms)
 {
     TRACY_AUTO_SCOPE();
 
-    std::vector<ImageCacheData> unique_images;
+    // Keep the vector for a deterministic order of images
+    UniqueImages unique_images;
+    unique_images.m_PageImages.resize(pages.size());
+    std::unordered_map<PdfImageKey, size_t> image_indices;
 
 #if __cpp_lib_ranges_enumerate
     for (auto [p, page] : pages | std::views::enumerate)
@@ -66,6 +54,7 @@ std::vector<ImageCacheData> CollectUniqueImages(const std::vector<Page>& pages,
     {
         const Page& page{ pages[p] };
 #endif
+        auto& page_images{ unique_images.m_PageImages[p] };
         const auto num_images{ page.m_Images.size() };
         for (size_t i = 0; i < num_images; ++i)
         {
@@ -74,21 +63,19 @@ std::vector<ImageCacheData> CollectUniqueImages(const std::vector<Page>& pages,
 
             if (card.m_Image.has_value())
             {
-                const auto proj{
-                    [&](const ImageCacheData& img)
-                    {
-                        return card.m_Image.value() == img.m_Image &&
-                               transform.m_Size == img.m_Size &&
-                               transform.m_Rotation == img.m_Rotation;
-                    }
+                PdfImageKey key{
+                    card.m_Image.value(),
+                    transform.m_Size,
+                    transform.m_Rotation,
                 };
-                if (!std::ranges::contains(unique_images, true, proj))
+                const auto [it, inserted]{ image_indices.try_emplace(key, unique_images.m_Images.size()) };
+                if (inserted)
                 {
-                    unique_images.push_back(ImageCacheData{
-                        card.m_Image.value(),
-                        transform.m_Size,
-                        transform.m_Rotation,
-                    });
+                    unique_images.m_Images.push_back(std::move(key));
+                }
+                if (!std::ranges::contains(page_images, it->second))
+                {
+                    page_images.push_back(it->second);
                 }
             }
         }
@@ -97,26 +84,41 @@ std::vector<ImageCacheData> CollectUniqueImages(const std::vector<Page>& pages,
     return unique_images;
 }
 
-uint32_t QueueImageCacheWork(PdfDocument* frontside_pdf,
-                             const std::vector<ImageCacheData>& frontside_images,
-                             PdfDocument* backside_pdf,
-                             const std::vector<ImageCacheData>& backside_images,
-                             std::function<const fs::path(const fs::path&)> get_frontside_file,
-                             std::function<const fs::path(const fs::path&)> get_backside_file,
-                             PixelDensity max_density,
-                             bool threaded_image_pre_cache,
-                             std::atomic_uint32_t& work_signal)
+// Frontside images are numbered first, followed by backside images, image_cached is
+// called with that index once the image is cached
+void QueueImageCacheWork(PdfDocument* frontside_pdf,
+                         const std::vector<PdfImageKey>& frontside_images,
+                         PdfDocument* backside_pdf,
+                         const std::vector<PdfImageKey>& backside_images,
+                         std::function<const fs::path(const fs::path&)> get_frontside_file,
+                         std::function<const fs::path(const fs::path&)> get_backside_file,
+                         PixelDensity max_density,
+                         bool threaded_image_pre_cache,
+                         std::function<void(size_t)> image_cached)
 {
     TRACY_AUTO_SCOPE();
 
+    if (frontside_pdf == backside_pdf)
+    {
+        frontside_pdf->PreallocateImageCache(frontside_images.size() + backside_images.size());
+    }
+    else
+    {
+        frontside_pdf->PreallocateImageCache(frontside_images.size());
+        if (backside_pdf != nullptr)
+        {
+            backside_pdf->PreallocateImageCache(backside_images.size());
+        }
+    }
+
     std::vector<std::function<void()>> image_cache_work;
-    for (const auto [img, size, rot] : frontside_images)
+    for (const auto& [img, size, rot] : frontside_images)
     {
         const auto img_path{ get_frontside_file(img) };
         image_cache_work.push_back(
             [=]()
             {
-                LogInfo("Caching frontside image {}...", img.get().string());
+                LogInfo("Caching frontside image {}...", img.string());
                 PdfDocument::ImageCacheData image_data{
                     .m_Path{ img_path },
                     .m_Size{ size },
@@ -126,13 +128,13 @@ uint32_t QueueImageCacheWork(PdfDocument* frontside_pdf,
                 frontside_pdf->PreCacheImage(image_data);
             });
     };
-    for (const auto [img, size, rot] : backside_images)
+    for (const auto& [img, size, rot] : backside_images)
     {
         const auto img_path{ get_backside_file(img) };
         image_cache_work.push_back(
             [=]()
             {
-                LogInfo("Caching backside image {}...", img.get().string());
+                LogInfo("Caching backside image {}...", img.string());
                 PdfDocument::ImageCacheData image_data{
                     .m_Path{ img_path },
                     .m_Size{ size },
@@ -143,37 +145,42 @@ uint32_t QueueImageCacheWork(PdfDocument* frontside_pdf,
             });
     };
 
-    if (!threaded_image_pre_cache)
+    for (size_t i = 0; i < image_cache_work.size(); ++i)
     {
-        for (const auto& work : image_cache_work)
+        auto work{
+            [image_cached, work = std::move(image_cache_work[i]), i]()
+            {
+                work();
+                image_cached(i);
+            }
+        };
+
+        if (!threaded_image_pre_cache)
         {
             work();
-            work_signal++;
         }
-    }
-    else
-    {
-        for (const auto& work : image_cache_work)
+        else
         {
-            auto* worker{ new PdfWorker{ work_signal, work } };
-            QThreadPool::globalInstance()->start(worker);
+            StartWork(WorkerPool::Pdf, std::move(work));
         }
     }
-
-    return static_cast<uint32_t>(image_cache_work.size());
 }
 
 PdfResults GeneratePdf(const Project& project, const Config& config)
 {
     TRACY_AUTO_SCOPE();
 
+    const auto start_point{ std::chrono::high_resolution_clock::now() };
     AtScopeExit log_generate_time{
-        [start_point = std::chrono::high_resolution_clock::now()]()
+        [start_point]()
         {
             const auto end_point{ std::chrono::high_resolution_clock::now() };
             const auto duration{ end_point - start_point };
             LogInfo("PDF Generation finished in {}s...",
                     std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() / 1000.0f);
+            LogWorkerPoolStats("PDF Generation finished");
+            LogImageAllocatorStats("PDF Generation finished");
+            TrimImageAllocator();
         }
     };
 
@@ -456,32 +463,127 @@ PdfResults GeneratePdf(const Project& project, const Config& config)
 
     const auto frontside_images{ CollectUniqueImages(pages, transforms) };
     const auto backside_images{ CollectUniqueImages(backside_pages, backside_transforms) };
+    const auto num_frontside_images{ frontside_images.m_Images.size() };
+    const auto num_images{ num_frontside_images + backside_images.m_Images.size() };
 
-    std::atomic_uint32_t cache_work_done{ 0 };
-    const bool threaded_image_pre_cache{
+    // Pages are drawn as soon as all images they draw are cached, instead of waiting
+    // for all images. Each page additionally waits for itself to be created.
+    struct PageWork
+    {
+        std::function<void()> m_Work;
+        std::atomic_size_t m_Pending;
+    };
+    const size_t work_per_page{ project.m_Data.m_BacksideEnabled ? 2u : 1u };
+    std::vector<PageWork> page_work(work_per_page * num_pages);
+    std::vector<std::vector<size_t>> pages_by_image(num_images);
+    for (size_t p = 0; p < num_pages; p++)
+    {
+        const auto add_dependencies{
+            [&](size_t work_index, const std::vector<size_t>& page_images, size_t image_offset)
+            {
+                page_work[work_index].m_Pending.store(page_images.size() + 1, std::memory_order_relaxed);
+                for (const size_t image : page_images)
+                {
+                    pages_by_image[image + image_offset].push_back(work_index);
+                }
+            }
+        };
+
+        add_dependencies(p * work_per_page, frontside_images.m_PageImages[p], 0);
+        if (project.m_Data.m_BacksideEnabled)
+        {
+            add_dependencies(p * work_per_page + 1, backside_images.m_PageImages[p], num_frontside_images);
+        }
+    }
+
+    std::once_flag first_page_done;
+    std::latch pages_done{ static_cast<std::ptrdiff_t>(page_work.size()) };
+    const auto run_page_work{
+        [&](size_t work_index)
+        {
+            page_work[work_index].m_Work();
+
+            std::call_once(first_page_done,
+                           [&]()
+                           {
+                               const auto duration{ std::chrono::high_resolution_clock::now() - start_point };
+                               LogInfo("First page finished after {}s...",
+                                       std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() / 1000.0f);
+                           });
+            pages_done.count_down();
+        }
+    };
+
+    const bool threaded_page_write{
         !config.m_DeterminsticPdfOutput &&
-        IsImageCacheThreadSafe(config.m_Backend)
+        IsPageWriteThreadSafe(config.m_Backend) &&
+        page_work.size() >= 4
     };
-    const auto amount_of_work{
-        QueueImageCacheWork(frontside_pdf.get(),
-                            frontside_images,
-                            backside_pdf,
-                            backside_images,
-                            get_frontside_file,
-                            get_backside_file,
-                            config.m_MaxDPI,
-                            threaded_image_pre_cache,
-                            cache_work_done)
-    };
-    auto wait_for_cache_work{
+    const auto dependency_done{
+        [&](size_t work_index)
+        {
+            auto& work{ page_work[work_index] };
+            if (work.m_Pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            {
+                return;
+            }
+
+            if (threaded_page_write)
+            {
+                StartWork(WorkerPool::Pdf,
+                          [&run_page_work, work_index]()
+                          { run_page_work(work_index); },
+                          c_PageWorkPriority);
+            }
+            else
+            {
+                work.m_Pending.notify_all();
+            }
+        }
+    };
+
+    std::latch images_done{ static_cast<std::ptrdiff_t>(num_images) };
+    std::atomic_size_t images_pending{ num_images };
+    const auto finish_image_cache{
         [&]()
         {
-            while (cache_work_done.load(std::memory_order_acquire) < amount_of_work)
+            frontside_pdf->FinishImageCache();
+            if (backside_pdf != frontside_pdf.get())
             {
-                QThread::yieldCurrentThread();
+                backside_pdf->FinishImageCache();
             }
         }
     };
+    if (num_images == 0)
+    {
+        finish_image_cache();
+    }
+
+    const bool threaded_image_pre_cache{
+        !config.m_DeterminsticPdfOutput &&
+        IsImageCacheThreadSafe(config.m_Backend)
+    };
+    QueueImageCacheWork(frontside_pdf.get(),
+                        frontside_images.m_Images,
+                        backside_pdf,
+                        backside_images.m_Images,
+                        get_frontside_file,
+                        get_backside_file,
+                        config.m_MaxDPI,
+                        threaded_image_pre_cache,
+                        [&](size_t image_index)
+                        {
+                            for (const size_t work_index : pages_by_image[image_index])
+                            {
+                                dependency_done(work_index);
+                            }
+
+                            if (images_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                            {
+                                finish_image_cache();
+                            }
+                            images_done.count_down();
+                        });
 
     if (backsides_on_same_pdf)
     {
@@ -761,8 +863,7 @@ PdfResults GeneratePdf(const Project& project, const Config& config)
         }
     };
 
-    std::vector<std::function<void()>> generate_work;
-
+    // Pages have to be created in order, but can be drawn in any order
 #if __cpp_lib_ranges_enumerate
     for (auto [p, page] : pages | std::views::enumerate)
     {
@@ -773,43 +874,40 @@ PdfResults GeneratePdf(const Project& project, const Config& config)
 #endif
 
         PdfPage* front_page{ frontside_pdf->NextPage(false) };
-        generate_work.push_back([draw_front_page, front_page, &page, p]()
-                                { draw_front_page(front_page, page, p); });
+        page_work[p * work_per_page].m_Work = [draw_front_page, front_page, &page, p]()
+        { draw_front_page(front_page, page, p); };
 
         if (project.m_Data.m_BacksideEnabled)
         {
             PdfPage* back_page{ backside_pdf->NextPage(true) };
             const auto& backside_page{ backside_pages[p] };
-            generate_work.push_back([draw_back_page, back_page, &backside_page, p]()
-                                    { draw_back_page(back_page, backside_page, p); });
+            page_work[p * work_per_page + 1].m_Work = [draw_back_page, back_page, &backside_page, p]()
+            { draw_back_page(back_page, backside_page, p); };
         }
     }
 
-    wait_for_cache_work();
-
-    const bool threaded_page_write{ IsPageWriteThreadSafe(config.m_Backend) };
-    if (!threaded_page_write || config.m_DeterminsticPdfOutput || generate_work.size() < 4)
+    for (size_t i = 0; i < page_work.size(); ++i)
     {
-        for (const auto& work : generate_work)
-        {
-            work();
-        }
+        dependency_done(i);
     }
-    else
-    {
-        std::atomic_uint32_t work_done{ 0 };
-        for (const auto& work : generate_work)
-        {
-            auto* worker{ new PdfWorker{ work_done, work } };
-            QThreadPool::globalInstance()->start(worker);
-        }
 
-        while (work_done.load(std::memory_order_acquire) < generate_work.size())
+    if (!threaded_page_write)
+    {
+        // Draw in order on this thread, waiting only for the images of the next page
+        for (size_t i = 0; i < page_work.size(); ++i)
         {
-            QThread::yieldCurrentThread();
+            auto& pending{ page_work[i].m_Pending };
+            for (auto current{ pending.load(std::memory_order_acquire) }; current != 0; current = pending.load(std::memory_order_acquire))
+            {
+                pending.wait(current, std::memory_order_acquire);
+            }
+            run_page_work(i);
         }
     }
 
+    pages_done.wait();
+    images_done.wait();
+
     auto frontside_pdf_path{ frontside_pdf->Write(frontside_pdf_name, config.m_VersionOutput) };
 
     const auto actual_backside_pdf_name{ frontside_pdf_path.stem().string() + "_backside" };
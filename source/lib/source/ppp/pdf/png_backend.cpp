@@ -16,6 +16,15 @@ inline Length FromPixels(int p, const Config& config)
     return p * 1_pix / config.m_MaxDPI;
 }
 
+// Multiplies the alpha of the image with the mask, in place
+static void ApplyMask(cv::Mat& image, const cv::Mat& mask)
+{
+    cv::Mat alpha;
+    cv::extractChannel(image, alpha, 3);
+    cv::multiply(alpha, mask, alpha, 1.0 / 255);
+    cv::insertChannel(alpha, image, 3);
+}
+
 void PngPage::SetPageName(std::string_view page_name)
 {
     m_PageName = fs::path{ page_name }.replace_extension().string();
@@ -97,11 +106,13 @@ void PngPage::DrawImage(ImageData data)
     const auto& x{ data.m_Pos.x };
     const auto& y{ data.m_Pos.y };
 
+    const PdfImageKey image_key{ image_path, data.m_Size, rotation };
+    const Image* image{ m_ImageCache->GetImage(image_key) };
+
     int32_t real_x;
     int32_t real_y;
     int32_t real_w;
     int32_t real_h;
-    const Image* image;
 
     if (m_PerfectFit)
     {
@@ -112,8 +123,6 @@ void PngPage::DrawImage(ImageData data)
         real_h = static_cast<int32_t>(m_CardSize.y / 1_pix);
         real_x = card_idx_x * static_cast<int32_t>(m_CardSize.x / 1_pix);
         real_y = m_PageHeight - card_idx_y * static_cast<int32_t>(m_CardSize.y / 1_pix) + real_h;
-
-        image = m_ImageCache->GetImage(image_path, real_w, real_h, rotation);
     }
     else
     {
@@ -124,8 +133,6 @@ void PngPage::DrawImage(ImageData data)
         real_y = m_PageHeight - ToPixels(y + h);
         real_w = ToPixels(w);
         real_h = ToPixels(h);
-
-        image = m_ImageCache->GetImage(image_path, real_w, real_h, rotation);
     }
 
     if (image != nullptr)
@@ -160,26 +167,46 @@ void PngPage::DrawImage(ImageData data)
             target_mat = TargetImage()(target_rect);
         }
 
-        if (data.m_CustomShape.has_value())
+        const auto mask_key{
+            [&]() -> std::optional<PngMaskKey>
+            {
+                if (data.m_CustomShape.has_value())
+                {
+                    return PngMaskKey{
+                        .m_Svg{ data.m_CustomShape->m_Svg },
+                        .m_Width{ source_mat.cols },
+                        .m_Height{ source_mat.rows },
+                        .m_Rotation{ data.m_Rotation },
+                        .m_MirrorVertical{ data.m_CustomShape->m_MirrorVertical },
+                        .m_MirrorHorizontal{ data.m_CustomShape->m_MirrorHorizontal },
+                    };
+                }
+                else if (data.m_CornerSize > 0_mm)
+                {
+                    return PngMaskKey{
+                        .m_CornerSize{ data.m_CornerSize },
+                        .m_Width{ source_mat.cols },
+                        .m_Height{ source_mat.rows },
+                    };
+                }
+                return std::nullopt;
+            }()
+        };
+
+        if (!mask_key.has_value())
         {
-            source_mat = Image{ source_mat }
-                             .Mirror(data.m_CustomShape->m_MirrorVertical,
-                                     data.m_CustomShape->m_MirrorHorizontal)
-                             .RotateInverse(data.m_Rotation)
-                             .ClipSvg(*data.m_CustomShape->m_Svg)
-                             .Rotate(data.m_Rotation)
-                             .Mirror(data.m_CustomShape->m_MirrorVertical,
-                                     data.m_CustomShape->m_MirrorHorizontal)
-                             .GetUnderlying();
+            source_mat.copyTo(target_mat);
         }
-        else if (data.m_CornerSize > 0_mm)
+        else if (!data.m_ClipRect.has_value())
         {
-            source_mat = Image{ source_mat }
-                             .RoundCorners(m_Project->CardSize(), data.m_CornerSize)
-                             .GetUnderlying();
+            m_ImageCache->GetMaskedImage(image_key, mask_key.value()).copyTo(target_mat);
+        }
+        else
+        {
+            // Clipped images are rare enough to not be worth caching
+            source_mat.copyTo(target_mat);
+            ApplyMask(target_mat, m_ImageCache->GetMask(mask_key.value()));
         }
-
-        source_mat.copyTo(target_mat);
     }
 }
 
@@ -279,36 +306,91 @@ PngImageCache::PngImageCache(const Project& project)
 {
 }
 
-const Image* PngImageCache::GetImage(const fs::path& image_path, int32_t w, int32_t h, Image::Rotation rotation) const
+const Image* PngImageCache::GetImage(const PdfImageKey& key) const
 {
+    const auto find_image{
+        [&]() -> const Image*
+        {
+            const auto it{ m_Cache.find(key) };
+            if (it != m_Cache.end())
+            {
+                return &it->second;
+            }
+            return nullptr;
+        }
+    };
+
+    // Once caching is done the cache is never written to again
+    if (m_Finished.load(std::memory_order_acquire))
+    {
+        return find_image();
+    }
+
     std::shared_lock lock{ m_Mutex };
-    // clang-format off
-    const auto it{
-        std::ranges::find_if(m_Cache,
-                                [&](const ImageCacheEntry& entry)
-                                { return entry.m_ImageRotation == rotation &&
-                                        entry.m_Width == w &&
-                                        entry.m_Height == h &&
-                                        entry.m_ImagePath == image_path; })
+    return find_image();
+}
+
+cv::Mat PngImageCache::GetMask(const PngMaskKey& key) const
+{
+    {
+        std::shared_lock lock{ m_MaskMutex };
+        const auto it{ m_Masks.find(key) };
+        if (it != m_Masks.end())
+        {
+            return it->second;
+        }
+    }
+
+    // Shaping a fully opaque image leaves exactly the mask in its alpha channel
+    const Image opaque_image{ cv::Mat{ key.m_Height, key.m_Width, CV_8UC4, cv::Scalar::all(255) } };
+    const Image shaped_image{
+        key.m_Svg != nullptr
+            ? opaque_image
+                  .Mirror(key.m_MirrorVertical, key.m_MirrorHorizontal)
+                  .RotateInverse(key.m_Rotation)
+                  .ClipSvg(*key.m_Svg)
+                  .Rotate(key.m_Rotation)
+                  .Mirror(key.m_MirrorVertical, key.m_MirrorHorizontal)
+            : opaque_image.RoundCorners(m_Project.CardSize(), key.m_CornerSize)
     };
-    // clang-format on
-    if (it != m_Cache.end())
+
+    cv::Mat mask;
+    cv::extractChannel(shaped_image.GetUnderlying(), mask, 3);
+
+    std::unique_lock lock{ m_MaskMutex };
+    return m_Masks.try_emplace(key, std::move(mask)).first->second;
+}
+
+cv::Mat PngImageCache::GetMaskedImage(const PdfImageKey& image_key, const PngMaskKey& mask_key) const
+{
+    PngMaskedImageKey key{ image_key, mask_key };
     {
-        return &it->m_Image;
+        std::shared_lock lock{ m_MaskMutex };
+        const auto it{ m_MaskedImages.find(key) };
+        if (it != m_MaskedImages.end())
+        {
+            return it->second;
+        }
     }
-    return nullptr;
+
+    cv::Mat masked_image{ GetImage(image_key)->GetUnderlying().clone() };
+    ApplyMask(masked_image, GetMask(mask_key));
+
+    std::unique_lock lock{ m_MaskMutex };
+    return m_MaskedImages.try_emplace(std::move(key), std::move(masked_image)).first->second;
 }
 
 void PngImageCache::PreallocateImages(size_t num_images)
 {
+    std::unique_lock lock{ m_Mutex };
     m_Cache.reserve(num_images);
 }
 
-void PngImageCache::CacheImage(fs::path image_path, int32_t w, int32_t h, Image::Rotation rotation)
+void PngImageCache::CacheImage(PdfImageKey key, int32_t w, int32_t h)
 {
     const Image loaded_image{
-        Image::Read(image_path)
-            .Rotate(rotation)
+        Image::Read(key.m_Path)
+            .Rotate(key.m_Rotation)
             .Resize({ w * 1_pix, h * 1_pix })
     };
 
@@ -318,13 +400,13 @@ void PngImageCache::CacheImage(fs::path image_path, int32_t w, int32_t h, Image:
     const auto encoded_image{ loaded_image.EncodePng() };
 
     std::unique_lock lock{ m_Mutex };
-    m_Cache.push_back({
-        std::move(image_path),
-        w,
-        h,
-        rotation,
-        Image{ std::move(four_channel_image) },
-    });
+    m_Cache.try_emplace(std::move(key), std::move(four_channel_image));
+}
+
+void PngImageCache::FinishCaching()
+{
+    std::unique_lock lock{ m_Mutex };
+    m_Finished.store(true, std::memory_order_release);
 }
 
 PngDocument::PngDocument(const Project& project, const Config& config)
@@ -453,18 +535,22 @@ void PngDocument::PreallocateImageCache(size_t num_images)
 void PngDocument::PreCacheImage(ImageCacheData data)
 {
     const auto perfect_fit{ m_Project.m_Data.m_PageSize == Config::c_FitSize };
-    const auto& image_path{ data.m_Path };
-    const auto& rotation{ data.m_Rotation };
+    PdfImageKey key{ data.m_Path, data.m_Size, data.m_Rotation };
     if (perfect_fit)
     {
         const auto real_w{ static_cast<int32_t>(m_PrecomputedCardSize.x / 1_pix) };
         const auto real_h{ static_cast<int32_t>(m_PrecomputedCardSize.y / 1_pix) };
-        m_ImageCache->CacheImage(image_path, real_w, real_h, rotation);
+        m_ImageCache->CacheImage(std::move(key), real_w, real_h);
     }
     else
     {
         const auto real_w{ ToPixels(data.m_Size.x, m_Cfg) };
         const auto real_h{ ToPixels(data.m_Size.y, m_Cfg) };
-        m_ImageCache->CacheImage(image_path, real_w, real_h, rotation);
+        m_ImageCache->CacheImage(std::move(key), real_w, real_h);
     }
 }
+
+void PngDocument::FinishImageCache()
+{
+    m_ImageCache->FinishCaching();
+}
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <atomic>
 #include <shared_mutex>
+#include <unordered_map>
 
 #include <opencv2/opencv.hpp>
 
@@ -11,6 +13,55 @@
 class PngDocument;
 class PngImageCache;
 
+// Identifies the mask of a card shape, either a custom shape or rounded corners,
+// at the pixel size it is drawn with
+struct PngMaskKey
+{
+    const Svg* m_Svg{ nullptr };
+    Length m_CornerSize{};
+    int32_t m_Width{};
+    int32_t m_Height{};
+    Image::Rotation m_Rotation{ Image::Rotation::None };
+    bool m_MirrorVertical{ false };
+    bool m_MirrorHorizontal{ false };
+
+    bool operator==(const PngMaskKey& rhs) const = default;
+};
+
+struct PngMaskedImageKey
+{
+    PdfImageKey m_Image;
+    PngMaskKey m_Mask;
+
+    bool operator==(const PngMaskedImageKey& rhs) const = default;
+};
+
+template<>
+struct std::hash<PngMaskKey>
+{
+    size_t operator()(const PngMaskKey& key) const noexcept
+    {
+        size_t hash{ std::hash<const Svg*>{}(key.m_Svg) };
+        HashCombine(hash, std::hash<float>{}(key.m_CornerSize / 1_mm));
+        HashCombine(hash, std::hash<int32_t>{}(key.m_Width));
+        HashCombine(hash, std::hash<int32_t>{}(key.m_Height));
+        HashCombine(hash, static_cast<size_t>(key.m_Rotation));
+        HashCombine(hash, static_cast<size_t>(key.m_MirrorVertical) << 1 | static_cast<size_t>(key.m_MirrorHorizontal));
+        return hash;
+    }
+};
+
+template<>
+struct std::hash<PngMaskedImageKey>
+{
+    size_t operator()(const PngMaskedImageKey& key) const noexcept
+    {
+        size_t hash{ std::hash<PdfImageKey>{}(key.m_Image) };
+        HashCombine(hash, std::hash<PngMaskKey>{}(key.m_Mask));
+        return hash;
+    }
+};
+
 class PngPage final : public PdfPage
 {
     friend class PngDocument;
@@ -64,25 +115,28 @@ class PngImageCache
   public:
     PngImageCache(const Project& project);
 
-    const Image* GetImage(const fs::path& image_path, int32_t w, int32_t h, Image::Rotation rotation) const;
+    const Image* GetImage(const PdfImageKey& key) const;
+
+    // Masks and masked images are created on first use and shared by all pages,
+    // so drawing the same card again is a plain copy
+    cv::Mat GetMask(const PngMaskKey& key) const;
+    cv::Mat GetMaskedImage(const PdfImageKey& image_key, const PngMaskKey& mask_key) const;
 
     void PreallocateImages(size_t num_images);
-    void CacheImage(fs::path image_path, int32_t w, int32_t h, Image::Rotation rotation);
+    void CacheImage(PdfImageKey key, int32_t w, int32_t h);
+    void FinishCaching();
 
   private:
     mutable std::shared_mutex m_Mutex;
 
     const Project& m_Project;
 
-    struct ImageCacheEntry
-    {
-        fs::path m_ImagePath;
-        int32_t m_Width;
-        int32_t m_Height;
-        Image::Rotation m_ImageRotation;
-        Image m_Image;
-    };
-    std::vector<ImageCacheEntry> m_Cache;
+    std::atomic_bool m_Finished{ false };
+    std::unordered_map<PdfImageKey, Image> m_Cache;
+
+    mutable std::shared_mutex m_MaskMutex;
+    mutable std::unordered_map<PngMaskKey, cv::Mat> m_Masks;
+    mutable std::unordered_map<PngMaskedImageKey, cv::Mat> m_MaskedImages;
 };
 
 class PngDocument final : public PdfDocument
@@ -98,6 +152,7 @@ class PngDocument final : public PdfDocument
 
     virtual void PreallocateImageCache(size_t num_images) override;
     virtual void PreCacheImage(ImageCacheData data) override;
+    virtual void FinishImageCache() override;
 
     static constexpr bool ThreadSafePageWrite()
     {
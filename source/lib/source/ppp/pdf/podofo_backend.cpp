@@ -1,5 +1,6 @@
 #include <ppp/pdf/podofo_backend.hpp>
 
+#include <fstream>
 #include <functional>
 #include <numbers>
 
@@ -7,6 +8,8 @@
 #include <dla/transform.h>
 #include <dla/vector_math.h>
 
+#include <fmt/format.h>
+
 #include <podofo/podofo.h>
 
 #include <ppp/pdf/util.hpp>
@@ -35,6 +38,65 @@ static Length FromPoDoFoPoints(double p)
     return p * 1_pts;
 }
 
+// Checks that the buffer holds a jpeg that pdf readers can display as-is, that is
+// an 8-bit gray or rgb jpeg in baseline, extended or progressive Huffman coding
+static bool IsEmbeddableJpeg(EncodedImageView buffer)
+{
+    const auto byte_at{
+        [&](size_t i)
+        {
+            return static_cast<uint8_t>(buffer[i]);
+        }
+    };
+
+    if (buffer.size() < 4 || byte_at(0) != 0xFF || byte_at(1) != 0xD8)
+    {
+        return false;
+    }
+
+    size_t pos{ 2 };
+    while (pos + 4 <= buffer.size())
+    {
+        if (byte_at(pos) != 0xFF)
+        {
+            return false;
+        }
+
+        const auto marker{ byte_at(pos + 1) };
+        if (marker == 0xFF)
+        {
+            // Fill byte
+            ++pos;
+            continue;
+        }
+
+        if (marker == 0xDA)
+        {
+            // Start of scan before any frame header
+            return false;
+        }
+
+        const size_t segment_length{ static_cast<size_t>(byte_at(pos + 2) << 8 | byte_at(pos + 3)) };
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+        {
+            // Start of frame, precision is followed by height, width and the number of components
+            if (pos + 10 > buffer.size())
+            {
+                return false;
+            }
+
+            const bool huffman_coded{ marker == 0xC0 || marker == 0xC1 || marker == 0xC2 };
+            const auto precision{ byte_at(pos + 4) };
+            const auto components{ byte_at(pos + 9) };
+            return huffman_coded && precision == 8 && (components == 1 || components == 3);
+        }
+
+        pos += 2 + segment_length;
+    }
+
+    return false;
+}
+
 static auto Save(PoDoFo::PdfPainter& painter)
 {
     TRACY_AUTO_SCOPE();
@@ -238,7 +300,7 @@ void PoDoFoPage::DrawImage(ImageData data)
     const auto real_w{ ToPoDoFoPoints(w) };
     const auto real_h{ ToPoDoFoPoints(h) };
 
-    auto* image{ m_ImageCache->GetImage(image_path, rotation) };
+    auto* image{ m_ImageCache->GetImage({ image_path, data.m_Size, rotation }) };
     const auto w_scale{ real_w / image->GetWidth() };
     const auto h_scale{ real_h / image->GetHeight() };
 
@@ -516,7 +578,7 @@ void PoDoFoPage::Finish()
 {
     TRACY_AUTO_SCOPE();
 
-    m_Painter->FinishDrawing();
+    m_Document->FinishPage(*m_Painter);
 }
 
 PoDoFoImageCache::PoDoFoImageCache(PoDoFoDocument& document,
@@ -528,18 +590,28 @@ PoDoFoImageCache::PoDoFoImageCache(PoDoFoDocument& document,
 {
 }
 
-PoDoFo::PdfImage* PoDoFoImageCache::GetImage(const fs::path& image_path, Image::Rotation rotation) const
+PoDoFo::PdfImage* PoDoFoImageCache::GetImage(const PdfImageKey& key) const
 {
-    TRACY_SCOPED_SHARED_LOCK(m_Mutex);
-    const auto it{
-        std::ranges::find_if(m_Cache, [&](const ImageCacheEntry& entry)
-                             { return entry.m_ImageRotation == rotation && entry.m_ImagePath == image_path; })
+    const auto find_image{
+        [&]() -> PoDoFo::PdfImage*
+        {
+            const auto it{ m_Cache.find(key) };
+            if (it != m_Cache.end())
+            {
+                return it->second.get();
+            }
+            return nullptr;
+        }
     };
-    if (it != m_Cache.end())
+
+    // Once caching is done the cache is never written to again
+    if (m_Finished.load(std::memory_order_acquire))
     {
-        return it->m_PoDoFoImage.get();
+        return find_image();
     }
-    return nullptr;
+
+    TRACY_SCOPED_SHARED_LOCK(m_Mutex);
+    return find_image();
 }
 
 void PoDoFoImageCache::PreallocateImages(size_t num_images)
@@ -550,12 +622,14 @@ void PoDoFoImageCache::PreallocateImages(size_t num_images)
     m_Cache.reserve(num_images);
 }
 
-void PoDoFoImageCache::CacheImage(fs::path image_path,
-                                  Image::Rotation rotation,
+void PoDoFoImageCache::CacheImage(PdfImageKey key,
                                   PixelDensity max_density)
 {
     TRACY_AUTO_SCOPE();
 
+    const auto& image_path{ key.m_Path };
+    const auto rotation{ key.m_Rotation };
+
     const auto use_jpg{
         m_Cfg.m_PdfImageCompression == ImageCompression::Lossy ||
         (m_Cfg.m_PdfImageCompression == ImageCompression::AsIs &&
@@ -576,31 +650,63 @@ void PoDoFoImageCache::CacheImage(fs::path image_path,
     };
 
     const auto card_size{ m_Project.CardSize() };
-    const Image loaded_image{
-        Image::Read(image_path)
-            .Rotate(rotation)
-            .CapDensity(card_size, max_density)
+
+    // Jpegs that need neither rotating nor downscaling are embedded as they are, this
+    // avoids decoding and re-encoding them as well as the quality loss that comes with it
+    // Note: An explicitly requested jpg quality is only honored by re-encoding
+    auto passthrough_image{
+        [&]() -> std::optional<EncodedImage>
+        {
+            if (!use_jpg ||
+                m_Cfg.m_JpgQuality.has_value() ||
+                rotation != Image::Rotation::None ||
+                !std::ranges::contains(g_LossyImageExtensions, image_path.extension()))
+            {
+                return std::nullopt;
+            }
+
+            if (Image::ReadMetaData(image_path).Density(card_size) > max_density)
+            {
+                return std::nullopt;
+            }
+
+            std::ifstream file{ image_path, std::ios::binary | std::ios::ate };
+            if (!file)
+            {
+                return std::nullopt;
+            }
+
+            EncodedImage buffer(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            if (!file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size())) ||
+                !IsEmbeddableJpeg(buffer))
+            {
+                return std::nullopt;
+            }
+
+            return buffer;
+        }()
     };
 
-    const auto encoded_image{ encoder(loaded_image) };
+    const auto encoded_image{
+        passthrough_image.has_value()
+            ? std::move(passthrough_image).value()
+            : encoder(Image::Read(image_path)
+                          .Rotate(rotation)
+                          .CapDensity(card_size, max_density))
+    };
 
-    std::unique_ptr podofo_image{ [this]()
-                                  {
-                                      TRACY_SCOPED_LOCK(m_Mutex);
-                                      return m_Document.MakeImage();
-                                  }() };
-    podofo_image.get()->LoadFromBuffer(
-        PoDoFo::bufferview{
-            reinterpret_cast<const char*>(encoded_image.data()),
-            encoded_image.size(),
-        });
+    std::unique_ptr podofo_image{ m_Document.MakeImage() };
+    m_Document.LoadImage(*podofo_image, encoded_image);
 
     TRACY_SCOPED_LOCK(m_Mutex);
-    m_Cache.push_back({
-        std::move(image_path),
-        rotation,
-        std::move(podofo_image),
-    });
+    m_Cache.try_emplace(std::move(key), std::move(podofo_image));
+}
+
+void PoDoFoImageCache::FinishCaching()
+{
+    TRACY_SCOPED_LOCK(m_Mutex);
+    m_Finished.store(true, std::memory_order_release);
 }
 
 PoDoFoDocument::PoDoFoDocument(const Project& project,
@@ -698,6 +804,48 @@ PoDoFoDocument::PoDoFoDocument(const Project& project,
             }
         }
     }
+
+    if (m_BaseDocument != nullptr)
+    {
+        // Pages copied from the base pdf are modified after they are created, which
+        // a streamed document does not support
+        m_Document = std::make_unique<PoDoFo::PdfMemDocument>();
+    }
+    else
+    {
+        m_StreamedPath = fmt::format("{}.{:x}.tmp",
+                                     m_Project.m_Data.m_FileName.string(),
+                                     reinterpret_cast<uintptr_t>(this));
+        const auto save_options{
+            m_Cfg.m_DeterminsticPdfOutput
+                ? PoDoFo::PdfSaveOptions::NoMetadataUpdate
+                : PoDoFo::PdfSaveOptions::None
+        };
+        auto streamed_document{
+            std::make_unique<PoDoFo::PdfStreamedDocument>(m_StreamedPath.string(),
+                                                          PoDoFo::PdfVersionDefault,
+                                                          nullptr,
+                                                          save_options)
+        };
+        m_StreamedDocument = streamed_document.get();
+        m_Document = std::move(streamed_document);
+    }
+}
+
+PoDoFoDocument::~PoDoFoDocument()
+{
+    if (m_StreamedDocument != nullptr)
+    {
+        // The document was never written, drop the incomplete file
+        m_ImageCache.reset();
+        m_Pages.clear();
+        m_Painters.clear();
+        m_StreamedDocument = nullptr;
+        m_Document.reset();
+
+        std::error_code error;
+        fs::remove(m_StreamedPath, error);
+    }
 }
 
 void PoDoFoDocument::SetColorSpace(std::string_view name,
@@ -718,27 +866,29 @@ void PoDoFoDocument::ReservePages(size_t pages)
 PoDoFoPage* PoDoFoDocument::NextPage(bool is_backside)
 {
     TRACY_AUTO_SCOPE();
+    TRACY_SCOPED_LOCK(m_DocumentMutex);
+
     const int new_page_idx{ static_cast<int>(m_Pages.size()) };
     PoDoFo::PdfPage* page{ nullptr };
     if (m_BaseDocument != nullptr)
     {
         if (!is_backside)
         {
-            m_Document.GetPages().InsertDocumentPageAt(new_page_idx, *m_BaseDocument, 0);
+            m_Document->GetPages().InsertDocumentPageAt(new_page_idx, *m_BaseDocument, 0);
         }
         else
         {
-            m_Document.GetPages().InsertDocumentPageAt(new_page_idx, *m_BaseDocument, 1);
+            m_Document->GetPages().InsertDocumentPageAt(new_page_idx, *m_BaseDocument, 1);
         }
 
         page = &m_Document
-                    .GetPages()
+                    ->GetPages()
                     .GetPageAt(new_page_idx);
     }
     else
     {
         const auto page_size{ m_Project.ComputePageSize() };
-        page = &m_Document.GetPages().CreatePageAt(
+        page = &m_Document->GetPages().CreatePageAt(
             new_page_idx,
             PoDoFo::Rect(
                 0.0,
@@ -769,7 +919,9 @@ fs::path PoDoFoDocument::Write(fs::path path, bool version_output)
                 reinterpret_cast<const char*>(color_space.m_IccProfile.data()),
                 color_space.m_IccProfile.size()
             };
-            auto& icc_stream{ m_Document.GetObjects().CreateDictionaryObject() };
+            TRACY_SCOPED_LOCK(m_DocumentMutex);
+
+            auto& icc_stream{ m_Document->GetObjects().CreateDictionaryObject() };
             icc_stream.GetOrCreateStream().SetData(icc_buffer);
             icc_stream.GetDictionary().AddKey("N"_n,
                                               PoDoFo::PdfVariant{ static_cast<int64_t>(3) });
@@ -791,7 +943,7 @@ fs::path PoDoFoDocument::Write(fs::path path, bool version_output)
             PoDoFo::PdfArray output_intents{};
             output_intents.Add(std::move(output_intent));
 
-            auto& catalog{ m_Document.GetCatalog() };
+            auto& catalog{ m_Document->GetCatalog() };
             catalog.GetDictionary().AddKey("OutputIntents"_n,
                                            std::move(output_intents));
         }
@@ -812,16 +964,44 @@ fs::path PoDoFoDocument::Write(fs::path path, bool version_output)
 
         if (m_Cfg.m_DeterminsticPdfOutput)
         {
-            auto& trailer{ m_Document.GetTrailer() };
+            auto& trailer{ m_Document->GetTrailer() };
             const auto& ref = trailer.GetDictionary().GetKey("Info")->GetReference();
-            auto* obj = m_Document.GetObjects().GetObject(ref);
+            auto* obj = m_Document->GetObjects().GetObject(ref);
             obj->GetDictionary().RemoveKey("CreationDate");
+        }
 
-            m_Document.Save(pdf_path.string(), PoDoFo::PdfSaveOptions::NoMetadataUpdate);
+        if (m_StreamedDocument != nullptr)
+        {
+            m_StreamedDocument->Close();
+
+            // Destroy everything referring to the document, so that the file is closed
+            m_Pages.clear();
+            m_Painters.clear();
+            m_StreamedDocument = nullptr;
+            m_Document.reset();
+
+            // The destructor no longer cleans up after this point, so a failed rename
+            // has to drop the finished file itself
+            std::error_code error;
+            fs::rename(m_StreamedPath, pdf_path, error);
+            if (error)
+            {
+                const std::string message{ error.message() };
+                fs::remove(m_StreamedPath, error);
+                throw std::logic_error{ fmt::format("Failed moving pdf to {}: {}", pdf_path_string, message) };
+            }
         }
         else
         {
-            m_Document.Save(pdf_path.string());
+            auto& mem_document{ static_cast<PoDoFo::PdfMemDocument&>(*m_Document) };
+            if (m_Cfg.m_DeterminsticPdfOutput)
+            {
+                mem_document.Save(pdf_path.string(), PoDoFo::PdfSaveOptions::NoMetadataUpdate);
+            }
+            else
+            {
+                mem_document.Save(pdf_path.string());
+            }
         }
 
         return pdf_path;
@@ -840,19 +1020,69 @@ void PoDoFoDocument::PreallocateImageCache(size_t num_images)
 
 void PoDoFoDocument::PreCacheImage(ImageCacheData data)
 {
-    m_ImageCache->CacheImage(data.m_Path, data.m_Rotation, data.m_MaxDensity);
+    m_ImageCache->CacheImage({ data.m_Path, data.m_Size, data.m_Rotation }, data.m_MaxDensity);
+}
+
+void PoDoFoDocument::FinishImageCache()
+{
+    m_ImageCache->FinishCaching();
 }
 
 PoDoFo::PdfFont& PoDoFoDocument::GetFont()
 {
     TRACY_AUTO_SCOPE();
+    TRACY_SCOPED_LOCK(m_DocumentMutex);
     return m_Document
-        .GetFonts()
+        ->GetFonts()
         .GetStandard14Font(PoDoFo::PdfStandard14FontType::Helvetica);
 }
 
 std::unique_ptr<PoDoFo::PdfImage> PoDoFoDocument::MakeImage()
 {
     TRACY_AUTO_SCOPE();
-    return m_Document.CreateImage();
+    TRACY_SCOPED_LOCK(m_DocumentMutex);
+    return m_Document->CreateImage();
+}
+
+void PoDoFoDocument::LoadImage(PoDoFo::PdfImage& image, EncodedImageView encoded_image)
+{
+    TRACY_AUTO_SCOPE();
+
+    const auto load_image{
+        [&]()
+        {
+            image.LoadFromBuffer(
+                PoDoFo::bufferview{
+                    reinterpret_cast<const char*>(encoded_image.data()),
+                    encoded_image.size(),
+                });
+        }
+    };
+
+    if (m_StreamedDocument != nullptr)
+    {
+        // Image data goes straight to the file, thus only one image can be written at a time
+        TRACY_SCOPED_LOCK(m_DocumentMutex);
+        load_image();
+    }
+    else
+    {
+        load_image();
+    }
+}
+
+void PoDoFoDocument::FinishPage(PoDoFo::PdfPainter& painter)
+{
+    TRACY_AUTO_SCOPE();
+
+    if (m_StreamedDocument != nullptr)
+    {
+        // Writes the page contents, same as with images only one stream can be written at a time
+        TRACY_SCOPED_LOCK(m_DocumentMutex);
+        painter.FinishDrawing();
+    }
+    else
+    {
+        painter.FinishDrawing();
+    }
 }
@@ -1,11 +1,15 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <shared_mutex>
+#include <unordered_map>
 
 #include <podofo/main/PdfImage.h>
 #include <podofo/main/PdfMemDocument.h>
 #include <podofo/main/PdfPainter.h>
+#include <podofo/main/PdfStreamedDocument.h>
 
 #include <ppp/pdf/backend.hpp>
 
@@ -54,13 +58,12 @@ class PoDoFoImageCache
                      const Project& project,
                      const Config& config);
 
-    PoDoFo::PdfImage* GetImage(const fs::path& image_path,
-                               Image::Rotation rotation) const;
+    PoDoFo::PdfImage* GetImage(const PdfImageKey& key) const;
 
     void PreallocateImages(size_t num_images);
-    void CacheImage(fs::path image_path,
-                    Image::Rotation rotation,
+    void CacheImage(PdfImageKey key,
                     PixelDensity max_density);
+    void FinishCaching();
 
   private:
     mutable TRACY_DECLARE_MUTEX(std::shared_mutex, m_Mutex);
@@ -69,13 +72,8 @@ class PoDoFoImageCache
     const Project& m_Project;
     const Config& m_Cfg;
 
-    struct ImageCacheEntry
-    {
-        fs::path m_ImagePath;
-        Image::Rotation m_ImageRotation;
-        std::unique_ptr<PoDoFo::PdfImage> m_PoDoFoImage;
-    };
-    std::vector<ImageCacheEntry> m_Cache;
+    std::atomic_bool m_Finished{ false };
+    std::unordered_map<PdfImageKey, std::unique_ptr<PoDoFo::PdfImage>> m_Cache;
 };
 
 class PoDoFoDocument final : public PdfDocument
@@ -83,7 +81,7 @@ class PoDoFoDocument final : public PdfDocument
   public:
     PoDoFoDocument(const Project& project,
                    const Config& config);
-    virtual ~PoDoFoDocument() override = default;
+    virtual ~PoDoFoDocument() override;
 
     virtual void SetColorSpace(std::string_view name,
                                std::span<const std::byte> icc_profile) override;
@@ -95,9 +93,12 @@ class PoDoFoDocument final : public PdfDocument
 
     virtual void PreallocateImageCache(size_t num_images) override;
     virtual void PreCacheImage(ImageCacheData data) override;
+    virtual void FinishImageCache() override;
 
     PoDoFo::PdfFont& GetFont();
     std::unique_ptr<PoDoFo::PdfImage> MakeImage();
+    void LoadImage(PoDoFo::PdfImage& image, EncodedImageView encoded_image);
+    void FinishPage(PoDoFo::PdfPainter& painter);
 
     static constexpr bool ThreadSafePageWrite()
     {
@@ -114,7 +115,15 @@ class PoDoFoDocument final : public PdfDocument
 
     std::unique_ptr<PoDoFo::PdfMemDocument> m_BaseDocument;
 
-    PoDoFo::PdfMemDocument m_Document;
+    // Guards creating objects in the document, when streaming also writing streams
+    TRACY_DECLARE_MUTEX(std::mutex, m_DocumentMutex);
+
+    // Unless pages are copied from a base pdf the document is streamed, objects are written
+    // to a temporary file as soon as they are complete and the file is moved in place on Write,
+    // this keeps memory from growing with the amount of images in the document
+    std::unique_ptr<PoDoFo::PdfDocument> m_Document;
+    PoDoFo::PdfStreamedDocument* m_StreamedDocument{ nullptr };
+    fs::path m_StreamedPath;
     std::vector<PoDoFoPage> m_Pages;
     std::vector<std::unique_ptr<PoDoFo::PdfPainter>> m_Painters;
 
@@ -0,0 +1,297 @@
+#include <ppp/plugins/download_scheduler.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include <QMetaEnum>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QTimer>
+
+#include <ppp/qt_util.hpp>
+#include <ppp/version.hpp>
+
+#include <ppp/util/log.hpp>
+
+float DownloadSchedulerStats::Throughput() const
+{
+    return m_Elapsed.count() == 0
+               ? 0.0f
+               : static_cast<float>(m_BytesReceived) * 1000.0f / static_cast<float>(m_Elapsed.count());
+}
+
+DownloadScheduler::DownloadScheduler(QNetworkAccessManager& network_manager,
+                                     DownloadHostPolicy default_policy)
+    : m_NetworkManager{ network_manager }
+    , m_DefaultPolicy{ default_policy }
+{
+}
+
+DownloadScheduler::~DownloadScheduler() = default;
+
+void DownloadScheduler::SetHostPolicy(const QString& host, DownloadHostPolicy policy)
+{
+    HostState& state{ GetHost(host) };
+    state.m_Policy = policy;
+    state.m_Tokens = std::min(state.m_Tokens, static_cast<float>(policy.m_Burst));
+    Schedule(host);
+}
+
+QNetworkRequest DownloadScheduler::MakeRequest(const QString& uri)
+{
+    QNetworkRequest request{ uri };
+    request.setHeader(QNetworkRequest::KnownHeaders::UserAgentHeader,
+                      ToQString(fmt::format("Proxy-PDF-Maker/{}", ProxyPdfVersion())));
+    request.setRawHeader("Accept",
+                         "*/*");
+    return request;
+}
+
+void DownloadScheduler::Get(QNetworkRequest request, OnDoneFun on_done)
+{
+    Enqueue(PendingRequest{
+        .m_Request{ std::move(request) },
+        .m_Body{},
+        .m_Post = false,
+        .m_OnDone{ std::move(on_done) },
+        .m_Attempt = 0,
+    });
+}
+
+void DownloadScheduler::Post(QNetworkRequest request, QByteArray body, OnDoneFun on_done)
+{
+    Enqueue(PendingRequest{
+        .m_Request{ std::move(request) },
+        .m_Body{ std::move(body) },
+        .m_Post = true,
+        .m_OnDone{ std::move(on_done) },
+        .m_Attempt = 0,
+    });
+}
+
+DownloadSchedulerStats DownloadScheduler::GetStats() const
+{
+    DownloadSchedulerStats stats{ m_Stats };
+    stats.m_Queued = 0;
+    stats.m_InFlight = 0;
+    for (const auto& [_, state] : m_Hosts)
+    {
+        stats.m_Queued += static_cast<uint32_t>(state.m_Queue.size());
+        stats.m_InFlight += state.m_InFlight;
+    }
+
+    if (m_FirstStart.has_value())
+    {
+        const auto end_point{ stats.m_InFlight > 0 ? Clock::now() : m_LastFinish };
+        stats.m_Elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end_point - m_FirstStart.value());
+    }
+    return stats;
+}
+
+void DownloadScheduler::LogStats(std::string_view reason) const
+{
+    static constexpr float c_KiB{ 1024.0f };
+
+    const DownloadSchedulerStats stats{ GetStats() };
+    LogInfo("{} - Downloads: {}/{} finished, {} failed, {} retried, peak of {} in flight, {:.0f} KiB/s over {}s",
+            reason,
+            stats.m_Finished,
+            stats.m_Requested,
+            stats.m_Failed,
+            stats.m_Retried,
+            stats.m_PeakInFlight,
+            stats.Throughput() / c_KiB,
+            stats.m_Elapsed.count() / 1000.0f);
+}
+
+void DownloadScheduler::Enqueue(PendingRequest request)
+{
+    const QString host{ request.m_Request.url().host() };
+    GetHost(host).m_Queue.push_back(std::move(request));
+    ++m_Stats.m_Requested;
+    Schedule(host);
+}
+
+DownloadScheduler::HostState& DownloadScheduler::GetHost(const QString& host)
+{
+    auto it{ m_Hosts.find(host) };
+    if (it == m_Hosts.end())
+    {
+        it = m_Hosts.emplace(host,
+                             HostState{
+                                 .m_Policy{ m_DefaultPolicy },
+                                 .m_Queue{},
+                                 .m_InFlight = 0,
+                                 .m_Tokens = static_cast<float>(m_DefaultPolicy.m_Burst),
+                                 .m_LastRefill{ Clock::now() },
+                                 .m_WakeupPending = false,
+                             })
+                 .first;
+    }
+    return it->second;
+}
+
+void DownloadScheduler::Schedule(const QString& host)
+{
+    HostState& state{ GetHost(host) };
+    const DownloadHostPolicy& policy{ state.m_Policy };
+    const bool rate_limited{ policy.m_RequestsPerSecond > 0.0f };
+
+    if (rate_limited)
+    {
+        const auto now{ Clock::now() };
+        const std::chrono::duration<float> since_refill{ now - state.m_LastRefill };
+        state.m_Tokens = std::min(state.m_Tokens + since_refill.count() * policy.m_RequestsPerSecond,
+                                  static_cast<float>(std::max(policy.m_Burst, 1u)));
+        state.m_LastRefill = now;
+    }
+
+    while (!state.m_Queue.empty() && state.m_InFlight < std::max(policy.m_MaxInFlight, 1u))
+    {
+        if (rate_limited)
+        {
+            if (state.m_Tokens < 1.0f)
+            {
+                if (!state.m_WakeupPending)
+                {
+                    const float missing_tokens{ 1.0f - state.m_Tokens };
+                    const auto wait_ms{
+                        static_cast<int>(std::ceil(missing_tokens * 1000.0f / policy.m_RequestsPerSecond)),
+                    };
+
+                    state.m_WakeupPending = true;
+                    QTimer::singleShot(wait_ms,
+                                       this,
+                                       [this, host]()
+                                       {
+                                           GetHost(host).m_WakeupPending = false;
+                                           Schedule(host);
+                                       });
+                }
+                return;
+            }
+            state.m_Tokens -= 1.0f;
+        }
+
+        PendingRequest request{ std::move(state.m_Queue.front()) };
+        state.m_Queue.pop_front();
+        Start(host, std::move(request));
+    }
+}
+
+void DownloadScheduler::Start(const QString& host, PendingRequest request)
+{
+    HostState& state{ GetHost(host) };
+    ++state.m_InFlight;
+
+    uint32_t in_flight{ 0 };
+    for (const auto& [_, other_state] : m_Hosts)
+    {
+        in_flight += other_state.m_InFlight;
+    }
+    m_Stats.m_PeakInFlight = std::max(m_Stats.m_PeakInFlight, in_flight);
+
+    if (!m_FirstStart.has_value())
+    {
+        m_FirstStart = Clock::now();
+    }
+
+    QNetworkReply* reply{
+        request.m_Post ? m_NetworkManager.post(request.m_Request, request.m_Body)
+                       : m_NetworkManager.get(request.m_Request)
+    };
+    QObject::connect(reply,
+                     &QNetworkReply::finished,
+                     this,
+                     [this, host, reply, request = std::move(request)]() mutable
+                     {
+                         Finished(host, std::move(request), reply);
+                     });
+}
+
+void DownloadScheduler::Finished(const QString& host, PendingRequest request, QNetworkReply* reply)
+{
+    HostState& state{ GetHost(host) };
+    --state.m_InFlight;
+    m_LastFinish = Clock::now();
+
+    if (reply->error() != QNetworkReply::NoError)
+    {
+        const auto status{ reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() };
+        const auto* error_name{ QMetaEnum::fromType<QNetworkReply::NetworkError>().valueToKey(reply->error()) };
+
+        if (IsRetryable(reply) && request.m_Attempt < state.m_Policy.m_MaxRetries)
+        {
+            // Respect the server asking us to back off, otherwise back off exponentially
+            const auto retry_after{ reply->rawHeader("Retry-After").toInt() };
+            const std::chrono::milliseconds backoff{
+                retry_after > 0
+                    ? std::chrono::milliseconds{ std::chrono::seconds{ retry_after } }
+                    : state.m_Policy.m_RetryBackoff * (1 << request.m_Attempt)
+            };
+
+            LogInfo("Error during request {} {}: {}, retrying in {}ms...",
+                    reply->request().url().toEncoded().toStdString(),
+                    status,
+                    error_name,
+                    backoff.count());
+
+            ++request.m_Attempt;
+            ++m_Stats.m_Retried;
+            reply->deleteLater();
+
+            QTimer::singleShot(backoff,
+                               this,
+                               [this, host, request = std::move(request)]() mutable
+                               {
+                                   // Retries go first, they have been waiting the longest
+                                   GetHost(host).m_Queue.push_front(std::move(request));
+                                   Schedule(host);
+                               });
+
+            Schedule(host);
+            return;
+        }
+
+        LogError("Error during request {} {}: {}",
+                 reply->request().url().toEncoded().toStdString(),
+                 status,
+                 error_name);
+        ++m_Stats.m_Failed;
+    }
+    else
+    {
+        m_Stats.m_BytesReceived += static_cast<uint64_t>(reply->bytesAvailable());
+    }
+
+    ++m_Stats.m_Finished;
+    request.m_OnDone(reply);
+    reply->deleteLater();
+
+    RequestFinished(m_Stats.m_Finished, m_Stats.m_Requested);
+
+    Schedule(host);
+}
+
+bool DownloadScheduler::IsRetryable(QNetworkReply* reply)
+{
+    const auto status{ reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() };
+    if (status == 429 || status >= 500)
+    {
+        return true;
+    }
+
+    switch (reply->error())
+    {
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::ProxyTimeoutError:
+    case QNetworkReply::UnknownNetworkError:
+        return true;
+    default:
+        return false;
+    }
+}
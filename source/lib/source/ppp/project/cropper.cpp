@@ -4,12 +4,14 @@
 
 #include <QDebug>
 #include <QEventLoop>
-#include <QThreadPool>
+#include <QThread>
 #include <QTimer>
 
 #include <fmt/chrono.h>
 
+#include <ppp/image_allocator.hpp>
 #include <ppp/qt_util.hpp>
+#include <ppp/worker_pools.hpp>
 
 #include <ppp/util/log.hpp>
 
@@ -17,7 +19,7 @@
 
 #include <ppp/project/cropper_work.hpp>
 
-Cropper::Cropper(std::function<const cv::Mat*(std::string_view)> get_color_cube,
+Cropper::Cropper(std::function<const ColorCubeLut*(std::string_view)> get_color_cube,
                  const Project& project,
                  const Config& config)
     : m_Project{ project }
@@ -41,6 +43,9 @@ Cropper::Cropper(std::function<const cv::Mat*(std::string_view)> get_color_cube,
                          LogInfo("Cropper finished...\nTotal Work Items: {}\nTotal Time Taken: {}",
                                  m_TotalCropWorkDone,
                                  crop_work_seconds);
+                         LogWorkerPoolStats("Cropper finished");
+                         LogImageAllocatorStats("Cropper finished");
+                         TrimImageAllocator();
 
                          CropWorkDone(crop_work_seconds,
                                       m_TotalCropWorkDone - m_TotalCropWorkSkipped - m_TotalCropWorkCancelled,
@@ -65,6 +70,9 @@ Cropper::~Cropper()
         work->Cancel();
     }
 
+    // Parked work has to run to notice it was cancelled
+    RestartWork();
+
     if (m_AliveCropperWork.load(std::memory_order_acquire) > 0)
     {
         // Give the work six seconds to finish and be destroyed
@@ -135,6 +143,7 @@ void Cropper::CardAdded(const fs::path& card_name, bool needs_crop, bool needs_p
             // we can push new work that is up to date
             m_CropWork.at(card_name)->Cancel();
             m_CropWork.erase(card_name);
+            m_Sources.erase(card_name);
         }
     }
 
@@ -146,6 +155,7 @@ void Cropper::CardRemoved(const fs::path& card_name)
     TRACY_AUTO_SCOPE();
 
     RemoveWork(card_name);
+    m_DecodedImages.erase(card_name);
 
     if (m_State == State::Paused)
     {
@@ -193,18 +203,28 @@ void Cropper::CardModified(const fs::path& card_name)
     PushWork(card_name, true, true);
 }
 
+void Cropper::CardImageDecoded(const fs::path& card_name, std::shared_ptr<const Image> image)
+{
+    std::error_code error;
+    const auto last_write_time{ fs::last_write_time(m_Project.GetCardImagePath(card_name), error) };
+    if (error)
+    {
+        return;
+    }
+
+    m_DecodedImages[card_name] = DecodedImage{
+        .m_Image{ std::move(image) },
+        .m_LastWriteTime{ last_write_time },
+    };
+}
+
 void Cropper::PauseWork()
 {
     m_State = State::Paused;
 
-    for (auto& [_, work] : m_CropWork)
-    {
-        work->Pause();
-    }
-    for (auto& [_, work] : m_PreviewWork)
-    {
-        work->Pause();
-    }
+    // Work that has not started stays parked in the pools, without holding any threads
+    PauseWorkerPool(WorkerPool::Crop);
+    PauseWorkerPool(WorkerPool::Preview);
 
     while (m_RunningCropperWork.load(std::memory_order_acquire))
     {
@@ -214,16 +234,46 @@ void Cropper::PauseWork()
 
 void Cropper::RestartWork()
 {
-    for (auto& [_, work] : m_CropWork)
+    if (m_State != State::Paused)
     {
-        work->Unpause();
+        return;
     }
-    for (auto& [_, work] : m_PreviewWork)
+
+    m_State = State::Running;
+
+    ResumeWorkerPool(WorkerPool::Crop);
+    ResumeWorkerPool(WorkerPool::Preview);
+}
+
+void Cropper::CardsVisible(const std::vector<fs::path>& card_names)
+{
+    TRACY_AUTO_SCOPE();
+
+    std::unordered_map<fs::path, size_t> previously_visible{ std::move(m_VisibleCards) };
+
+    m_VisibleCards.clear();
+    for (const auto& [i, card_name] : card_names | std::views::enumerate)
     {
-        work->Unpause();
+        m_VisibleCards.try_emplace(card_name, static_cast<size_t>(i));
     }
 
-    m_State = State::Running;
+    const auto update_priority{
+        [this](const fs::path& card_name)
+        {
+            if (auto it{ m_PreviewWork.find(card_name) }; it != m_PreviewWork.end())
+            {
+                it->second->SetPriority(GetPreviewPriority(card_name));
+            }
+        }
+    };
+    for (const auto& [card_name, _] : previously_visible)
+    {
+        update_priority(card_name);
+    }
+    for (const auto& [card_name, _] : m_VisibleCards)
+    {
+        update_priority(card_name);
+    }
 }
 
 void Cropper::PushWork(const fs::path& card_name, bool needs_crop, bool needs_preview)
@@ -250,7 +300,7 @@ void Cropper::PushWorkImpl(const fs::path& key,
                     m_AliveCropperWork,
                     m_RunningCropperWork,
                     card_name,
-                    m_Project.GetCardImagePath(card_name),
+                    GetSource(card_name),
                     backside_bleed,
                     m_GetColorCube,
                     m_ImageDB,
@@ -283,6 +333,10 @@ void Cropper::PushWorkImpl(const fs::path& key,
                                  {
                                      m_CropWork.erase(card_name);
                                  }
+                                 if (conclusion != CropperWork::Conclusion::Cancelled)
+                                 {
+                                     m_DecodedImages.erase(card_name);
+                                 }
 
                                  m_TotalCropWorkDone++;
                                  if (conclusion == CropperWork::Conclusion::Skipped)
@@ -326,7 +380,8 @@ void Cropper::PushWorkImpl(const fs::path& key,
 
             m_CropFinishedTimer.stop();
 
-            if (m_State == State::Running)
+            // Work pushed while paused is parked in the pool until we restart
+            if (m_State != State::Waiting)
             {
                 crop_work->Start();
             }
@@ -341,7 +396,7 @@ void Cropper::PushWorkImpl(const fs::path& key,
                 new CropperPreviewWork{
                     m_AliveCropperWork,
                     card_name,
-                    m_Project.GetCardImagePath(card_name),
+                    GetSource(card_name),
                     !m_Project.m_Data.m_Previews.contains(card_name),
                     m_GetColorCube,
                     m_ImageDB,
@@ -383,8 +438,9 @@ void Cropper::PushWorkImpl(const fs::path& key,
                              });
 
             m_PreviewWork[card_name] = preview_work;
+            preview_work->SetPriority(GetPreviewPriority(card_name));
 
-            if (m_State == State::Running)
+            if (m_State != State::Waiting)
             {
                 preview_work->Start();
             }
@@ -405,4 +461,49 @@ void Cropper::RemoveWork(const fs::path& card_name)
 
     m_CropWork.erase(card_name);
     m_PreviewWork.erase(card_name);
+    m_Sources.erase(card_name);
+}
+
+std::shared_ptr<CropperSource> Cropper::GetSource(const fs::path& card_name)
+{
+    std::weak_ptr<CropperSource>& weak_source{ m_Sources[card_name] };
+    if (auto source{ weak_source.lock() })
+    {
+        return source;
+    }
+
+    auto source{
+        std::make_shared<CropperSource>(m_Project.GetCardImagePath(card_name),
+                                        m_Project.GetCardRotation(card_name))
+    };
+
+    if (auto it{ m_DecodedImages.find(card_name) }; it != m_DecodedImages.end())
+    {
+        // Only valid as long as the file is exactly what was handed to us
+        std::error_code error;
+        const auto last_write_time{ fs::last_write_time(source->GetPath(), error) };
+        if (!error && last_write_time == it->second.m_LastWriteTime)
+        {
+            source->SetImage(it->second.m_Image);
+        }
+        else
+        {
+            m_DecodedImages.erase(it);
+        }
+    }
+
+    weak_source = source;
+    return source;
+}
+
+int Cropper::GetPreviewPriority(const fs::path& card_name) const
+{
+    // Regular previews come after all visible ones, which are ordered as given
+    static constexpr int c_PreviewPriority{ 1 };
+    const auto it{ m_VisibleCards.find(card_name) };
+    if (it == m_VisibleCards.end())
+    {
+        return c_PreviewPriority;
+    }
+    return c_PreviewPriority + static_cast<int>(m_VisibleCards.size() - it->second);
 }
@@ -1,9 +1,5 @@
 #include <ppp/project/cropper_work.hpp>
 
-#include <QEventLoop>
-#include <QThreadPool>
-#include <QTimer>
-
 #include <ppp/profile/profile.hpp>
 
 #include <ppp/project/image_database.hpp>
@@ -33,6 +29,7 @@ static ConfigData CopyRelevant(const Config& config)
         .m_BasePreviewWidth{ config.m_BasePreviewWidth },
         .m_MaxDPI{ config.m_MaxDPI },
         .m_ColorCube{ config.m_ColorCube },
+        .m_IntermediateImageFormat = config.m_IntermediateImageFormat,
         .m_RenderZeroBleedRoundedEdges = config.m_RenderZeroBleedRoundedEdges,
         .m_CardSizes{ config.m_CardSizes },
     };
@@ -127,22 +124,269 @@ static Image FixImageAspectRatio(Image source_image,
     std::unreachable();
 }
 
-CropperWork::CropperWork(std::atomic_uint32_t& alive_cropper_work)
+CropperSource::CropperSource(fs::path image_path, Image::Rotation rotation)
+    : m_ImagePath{ std::move(image_path) }
+    , m_Rotation{ rotation }
+{
+}
+
+const fs::path& CropperSource::GetPath() const
+{
+    return m_ImagePath;
+}
+
+Image::Rotation CropperSource::GetRotation() const
+{
+    return m_Rotation;
+}
+
+QByteArray CropperSource::GetHash(ImageDataBase& image_db)
+{
+    TRACY_AUTO_SCOPE();
+
+    // Same as with decoding, only one caller reads the whole file to hash it and
+    // everyone else waits for that result without holding the lock
+    std::promise<QByteArray> computed_hash{};
+    std::shared_future<QByteArray> hashing{};
+    uint64_t generation{ 0 };
+    {
+        TRACY_SCOPED_LOCK(m_Mutex);
+        if (m_Hash.has_value())
+        {
+            return m_Hash.value();
+        }
+
+        if (m_Hashing.valid())
+        {
+            hashing = m_Hashing;
+        }
+        else
+        {
+            m_Hashing = computed_hash.get_future().share();
+            generation = m_Generation;
+        }
+    }
+
+    if (hashing.valid())
+    {
+        return hashing.get();
+    }
+
+    const auto finish_hashing{
+        [&](std::optional<QByteArray> hash)
+        {
+            TRACY_SCOPED_LOCK(m_Mutex);
+            if (generation == m_Generation)
+            {
+                m_Hashing = {};
+                m_Hash = std::move(hash);
+            }
+        }
+    };
+
+    try
+    {
+        QByteArray hash{ image_db.HashSource(m_ImagePath) };
+        finish_hashing(hash);
+        computed_hash.set_value(hash);
+        return hash;
+    }
+    catch (...)
+    {
+        finish_hashing(std::nullopt);
+        computed_hash.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+ImageMetaData CropperSource::GetMetaData()
+{
+    TRACY_AUTO_SCOPE();
+
+    TRACY_SCOPED_LOCK(m_Mutex);
+    if (m_Image != nullptr)
+    {
+        return ImageMetaData{ m_Image->Size() };
+    }
+
+    if (!m_MetaData.has_value())
+    {
+        m_MetaData = Image::ReadMetaData(m_ImagePath).Rotate(m_Rotation);
+    }
+    return m_MetaData.value();
+}
+
+std::shared_ptr<const Image> CropperSource::GetImage()
+{
+    TRACY_AUTO_SCOPE();
+
+    // Only one caller decodes, everyone else asking in the meantime waits for its
+    // result instead of decoding the same image, without holding the lock
+    std::promise<std::shared_ptr<const Image>> decoded_image{};
+    std::shared_future<std::shared_ptr<const Image>> decoding{};
+    uint64_t generation{ 0 };
+    {
+        TRACY_SCOPED_LOCK(m_Mutex);
+        if (m_Image != nullptr)
+        {
+            return m_Image;
+        }
+
+        if (m_Decoding.valid())
+        {
+            decoding = m_Decoding;
+        }
+        else
+        {
+            m_Decoding = decoded_image.get_future().share();
+            generation = m_Generation;
+        }
+    }
+
+    if (decoding.valid())
+    {
+        return decoding.get();
+    }
+
+    const auto finish_decoding{
+        [&](std::shared_ptr<const Image> image)
+        {
+            TRACY_SCOPED_LOCK(m_Mutex);
+
+            // Don't hold on to failed reads, the caller will retry later, nor on
+            // reads of a source that was invalidated or replaced while decoding
+            if (generation == m_Generation)
+            {
+                m_Decoding = {};
+                if (image != nullptr && image->Valid())
+                {
+                    m_Image = std::move(image);
+                }
+            }
+        }
+    };
+
+    try
+    {
+        auto image{ std::make_shared<const Image>(Image::Read(m_ImagePath).Rotate(m_Rotation)) };
+        finish_decoding(image);
+        decoded_image.set_value(image);
+        return image;
+    }
+    catch (...)
+    {
+        finish_decoding(nullptr);
+        decoded_image.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+void CropperSource::SetImage(std::shared_ptr<const Image> image)
+{
+    TRACY_SCOPED_LOCK(m_Mutex);
+    ++m_Generation;
+    m_Decoding = {};
+    m_Hashing = {};
+    m_MetaData.reset();
+    m_Image = m_Rotation == Image::Rotation::None
+                  ? std::move(image)
+                  : std::make_shared<const Image>(image->Rotate(m_Rotation));
+}
+
+void CropperSource::Invalidate()
+{
+    TRACY_SCOPED_LOCK(m_Mutex);
+    ++m_Generation;
+    m_Decoding = {};
+    m_Hashing = {};
+    m_Hash.reset();
+    m_MetaData.reset();
+    m_Image.reset();
+}
+
+void CropperSource::AddWork(CropperWork* work)
+{
+    TRACY_SCOPED_LOCK(m_WorkMutex);
+    m_Work.push_back(work);
+}
+
+void CropperSource::RemoveWork(CropperWork* work)
+{
+    TRACY_SCOPED_LOCK(m_WorkMutex);
+    std::erase(m_Work, work);
+}
+
+void CropperSource::PrioritizeWaitingWork(const CropperWork* finished_work)
+{
+    TRACY_AUTO_SCOPE();
+
+    const bool has_image{
+        [this]()
+        {
+            TRACY_SCOPED_LOCK(m_Mutex);
+            return m_Image != nullptr;
+        }()
+    };
+
+    // Only worth pulling work forward if it can reuse the decoded image, it stays
+    // in their own pools but goes to the front of the queue
+    bool has_waiting_work{ false };
+    {
+        TRACY_SCOPED_LOCK(m_WorkMutex);
+        for (CropperWork* work : m_Work)
+        {
+            if (work != finished_work && work->IsWaiting())
+            {
+                has_waiting_work = true;
+                if (has_image)
+                {
+                    work->Expedite();
+                }
+            }
+        }
+    }
+
+    // The last work to run releases the decoded image, any work still running holds
+    // its own reference and anything that starts later will have to decode again
+    if (!has_waiting_work)
+    {
+        TRACY_SCOPED_LOCK(m_Mutex);
+        m_Image.reset();
+    }
+}
+
+CropperWork::CropperWork(std::atomic_uint32_t& alive_cropper_work,
+                         std::shared_ptr<CropperSource> source)
     : m_AliveCropperWork{ alive_cropper_work }
+    , m_Source{ std::move(source) }
 {
     m_AliveCropperWork.fetch_add(1, std::memory_order_release);
+    m_Source->AddWork(this);
 
     setAutoDelete(false);
 }
 
 CropperWork::~CropperWork()
 {
+    m_Source->RemoveWork(this);
     m_AliveCropperWork.fetch_sub(1, std::memory_order_release);
 }
 
 void CropperWork::Start()
 {
-    QThreadPool::globalInstance()->start(this, m_Priorty);
+    // Estimating may have to read the source, so the first time around the work is
+    // queued without an estimate and only estimates once it runs on a pool thread
+    StartWork(m_Pool, this, m_Priorty, m_MemoryEstimate.value_or(0));
+}
+
+bool CropperWork::IsWaiting() const
+{
+    return m_State.load() == State::Waiting;
+}
+
+void CropperWork::Expedite()
+{
+    ReprioritizeWork(m_Pool, this, c_ExpeditedPriority);
 }
 
 void CropperWork::Restart()
@@ -171,54 +415,77 @@ int CropperWork::Priority() const
     return m_Priorty;
 }
 
-void CropperWork::Pause()
+void CropperWork::SetPriority(int priority)
 {
-    State expected{ State::Waiting };
-    m_State.compare_exchange_strong(expected, State::Paused);
-}
-void CropperWork::Unpause()
-{
-    State expected{ State::Paused };
-    if (m_State.compare_exchange_strong(expected, State::Waiting))
+    if (m_Priorty != priority)
     {
-        OnUnpaused(QPrivateSignal{});
+        m_Priorty = priority;
+        ReprioritizeWork(m_Pool, this, priority);
     }
 }
 
 bool CropperWork::EnterRun()
 {
+    if (!m_MemoryEstimate.has_value())
+    {
+        m_MemoryEstimate = EstimateMemory();
+        if (m_MemoryEstimate.value() > 0 && m_State.load() == State::Waiting)
+        {
+            // Queue again so that the pool admits the work with its estimate
+            Start();
+            return false;
+        }
+    }
+
     if (m_State.load() == State::Cancelled)
     {
         Finished(Conclusion::Cancelled);
         return false;
     }
 
-    if (m_State.load() == State::Paused)
+    m_State = State::Running;
+    return true;
+}
+
+bool CropperWork::CheckCancelled()
+{
+    if (m_CancelRequested.load(std::memory_order_relaxed))
     {
-        QEventLoop loop;
-        QObject::connect(this, &CropperWork::OnUnpaused, &loop, &QEventLoop::quit);
-        loop.exec();
+        Finished(Conclusion::Cancelled);
+        return true;
     }
+    return false;
+}
 
-    m_State = State::Running;
-    return true;
+CancellationToken CropperWork::GetCancellationToken() const
+{
+    return CancellationToken{ &m_CancelRequested };
+}
+
+uint64_t CropperWork::EstimateMemory()
+{
+    return 0;
+}
+
+void CropperWork::PrioritizeSiblingWork(std::shared_ptr<CropperSource> source, const CropperWork* finished_work)
+{
+    source->PrioritizeWaitingWork(finished_work);
 }
 
 CropperCropWork::CropperCropWork(
     std::atomic_uint32_t& alive_cropper_work,
     std::atomic_uint32_t& running_crop_work,
     fs::path card_name,
-    fs::path image_path,
+    std::shared_ptr<CropperSource> source,
     bool backside_bleed,
-    std::function<const cv::Mat*(std::string_view)> get_color_cube,
+    std::function<const ColorCubeLut*(std::string_view)> get_color_cube,
     ImageDataBase& image_db,
     const Project& project,
     const Config& config)
-    : CropperWork{ alive_cropper_work }
+    : CropperWork{ alive_cropper_work, std::move(source) }
     , m_RunningCropperWork{ running_crop_work }
     , m_CardName{ std::move(card_name) }
-    , m_ImagePath{ std::move(image_path) }
-    , m_Rotation{ project.GetCardRotation(m_CardName) }
+    , m_Rotation{ m_Source->GetRotation() }
     , m_BleedType{ project.GetCardBleedType(m_CardName) }
     , m_BadAspectRatioHandling{ project.GetCardBadAspectRatioHandling(m_CardName) }
     , m_GetColorCube{ get_color_cube }
@@ -228,6 +495,20 @@ CropperCropWork::CropperCropWork(
 {
 }
 
+uint64_t CropperCropWork::EstimateMemory()
+{
+    // The decoded source plus about as many full size copies while uncropping,
+    // cropping and color correcting, each with up to four 8-bit channels
+    static constexpr uint64_t c_FullSizeImages{ 4 };
+    static constexpr uint64_t c_BytesPerPixel{ 4 };
+
+    const ImageMetaData meta_data{ m_Source->GetMetaData() };
+    const auto pixels{
+        static_cast<uint64_t>(meta_data.Width().value) * static_cast<uint64_t>(meta_data.Height().value)
+    };
+    return pixels * c_BytesPerPixel * c_FullSizeImages;
+}
+
 void CropperCropWork::run()
 {
     if (!EnterRun())
@@ -235,6 +516,15 @@ void CropperCropWork::run()
         return;
     }
 
+    AtScopeExit prioritize_sibling_work{
+        // Capture the source by value, since this work object may be destroyed
+        // as soon as it is finished
+        [source = m_Source, self = this]()
+        {
+            PrioritizeSiblingWork(source, self);
+        }
+    };
+
     m_RunningCropperWork.fetch_add(1, std::memory_order_release);
     AtScopeExit decrement_work_counter{
         // Capture the atomic as a pointer, since we may call this after the
@@ -263,7 +553,6 @@ void CropperCropWork::run()
 
         const fs::path output_dir{ m_Data.GetOutputFolder(m_Cfg) };
 
-        const fs::path input_file{ m_ImagePath };
         const fs::path crop_dir{ m_Data.m_CropDir };
         const fs::path uncrop_dir{ m_Data.m_UncropDir };
 
@@ -277,7 +566,7 @@ void CropperCropWork::run()
 
         const std::string color_cube_name{ m_Cfg.m_ColorCube };
         const bool do_color_correction{ color_cube_name != "None" };
-        const cv::Mat* color_cube{ do_color_correction ? m_GetColorCube(color_cube_name) : nullptr };
+        const ColorCubeLut* color_cube{ do_color_correction ? m_GetColorCube(color_cube_name) : nullptr };
 
         ImageParameters image_params{
             .m_DPI{ max_density },
@@ -289,10 +578,16 @@ void CropperCropWork::run()
             .m_BadAspectRatioHandling = m_BadAspectRatioHandling,
         };
 
+        const QByteArray source_hash{ m_Source->GetHash(m_ImageDB) };
         QByteArray input_file_hash{
-            m_ImageDB.TestEntry(output_file, input_file, image_params)
+            m_ImageDB.TestEntry(output_file, source_hash, image_params)
         };
 
+        if (CheckCancelled())
+        {
+            return;
+        }
+
         // empty hash indicates that the source has not changed
         if (input_file_hash.isEmpty())
         {
@@ -300,39 +595,19 @@ void CropperCropWork::run()
             return;
         }
 
-        class LazyReadImage : public Image
-        {
-          public:
-            LazyReadImage(const fs::path& path,
-                          Rotation rotation)
-                : m_Path{ path }
-                , m_Rotation{ rotation }
-            {
-            }
-
-            LazyReadImage& operator=(Image&& rhs)
+        // The decoded source is shared with other work on the same card, so we
+        // only reference its pixels here, all operations below create new images
+        Image source_image{};
+        const auto read_source_image{
+            [&]()
             {
-                *static_cast<Image*>(this) = std::move(rhs);
-                return *this;
-            }
-
-            void DoRead()
-            {
-                if (!Valid())
+                if (!source_image.Valid())
                 {
-                    *this = Image::Read(m_Path)
-                                .Rotate(m_Rotation);
+                    source_image = Image{ m_Source->GetImage()->GetUnderlying() };
                 }
             }
-
-          private:
-            const fs::path& m_Path;
-            Rotation m_Rotation;
         };
-
-
-        LazyReadImage source_image{ input_file, m_Rotation };
-        const auto source_image_meta{ Image::ReadMetaData(input_file).Rotate(m_Rotation) };
+        const auto source_image_meta{ m_Source->GetMetaData() };
 
         const auto image_aspect_ratio{ source_image_meta.AspectRatio() };
         const auto with_bleed_diff{
@@ -363,7 +638,7 @@ void CropperCropWork::run()
             const auto uncropped_file_path{ uncrop_dir / m_CardName };
 
             QByteArray uncrop_input_file_hash{
-                m_ImageDB.TestEntry(uncropped_file_path, input_file, image_params)
+                m_ImageDB.TestEntry(uncropped_file_path, source_hash, image_params)
             };
 
             // empty hash indicates that the source has not changed
@@ -381,8 +656,13 @@ void CropperCropWork::run()
             else
             {
                 // do the uncrop, write the file, and copy to source_image
-                source_image.DoRead();
-                source_image = FixImageAspectRatio(source_image,
+                read_source_image();
+                if (CheckCancelled())
+                {
+                    return;
+                }
+
+                source_image = FixImageAspectRatio(std::move(source_image),
                                                    m_BadAspectRatioHandling,
                                                    card_aspect_ratio);
                 Image uncropped_image{ UncropImage(source_image,
@@ -391,7 +671,12 @@ void CropperCropWork::run()
                                                    full_bleed_edge,
                                                    fancy_uncrop ? UncropMode::Mirror
                                                                 : UncropMode::Black) };
-                uncropped_image.Write(uncropped_file_path, 3, 100, card_size_with_full_bleed);
+                if (CheckCancelled())
+                {
+                    return;
+                }
+
+                uncropped_image.WriteIntermediate(uncropped_file_path, m_Cfg.m_IntermediateImageFormat, card_size_with_full_bleed);
                 m_ImageDB.PutEntry(uncropped_file_path, std::move(uncrop_input_file_hash), image_params);
 
                 if (m_Cfg.m_NoCropMode)
@@ -410,14 +695,19 @@ void CropperCropWork::run()
                 return;
             }
 
-            source_image.DoRead();
-            source_image = FixImageAspectRatio(source_image,
+            read_source_image();
+            source_image = FixImageAspectRatio(std::move(source_image),
                                                m_BadAspectRatioHandling,
                                                card_with_full_bleed_aspect_ratio);
         }
 
         assert(source_image.Valid());
 
+        if (CheckCancelled())
+        {
+            return;
+        }
+
         const Image cropped_image{
             CropImage(source_image,
                       m_CardName,
@@ -428,23 +718,33 @@ void CropperCropWork::run()
         };
         if (do_color_correction)
         {
-            const Image vibrant_image{ cropped_image.ApplyColorCube(*color_cube) };
-            vibrant_image.Write(output_file, 3, 100, card_size_with_bleed);
+            const Image vibrant_image{ cropped_image.ApplyColorCube(*color_cube, GetCancellationToken()) };
+            if (CheckCancelled())
+            {
+                return;
+            }
+            vibrant_image.WriteIntermediate(output_file, m_Cfg.m_IntermediateImageFormat, card_size_with_bleed);
         }
         else
         {
-            cropped_image.Write(output_file, 3, 100, card_size_with_bleed);
+            if (CheckCancelled())
+            {
+                return;
+            }
+            cropped_image.WriteIntermediate(output_file, m_Cfg.m_IntermediateImageFormat, card_size_with_bleed);
         }
 
         if (m_Cfg.m_RenderZeroBleedRoundedEdges)
         {
             const auto corner_radius{ m_Data.CardCornerRadius(m_Cfg) };
 
+            // The bleed crop is the card plus its bleed edge, so cropping that bleed
+            // edge off again is much cheaper than cropping the full source once more
             const Image no_bleed_image{
-                CropImage(source_image,
+                CropImage(cropped_image,
                           m_CardName,
                           card_size,
-                          full_bleed_edge,
+                          bleed_edge,
                           0_mm,
                           max_density)
             };
@@ -457,6 +757,10 @@ void CropperCropWork::run()
                     .replace_filename(crop_file.stem().string() +
                                       "_rounded.png")
             };
+            if (CheckCancelled())
+            {
+                return;
+            }
             rounded_corners_image.Write(rounded_output_file, 3, 100, card_size);
         }
 
@@ -469,11 +773,18 @@ void CropperCropWork::run()
     {
         TRACY_AUTO_SCOPE();
 
+        // Failures of obsolete work are of no interest, retrying even less so
+        if (CheckCancelled())
+        {
+            return;
+        }
+
         if (m_Retries.load(std::memory_order_relaxed) < c_MaxRetries)
         {
             // If user updated the file we may be reading it's still being written to,
             // Hopefully that's the only reason to end up here...
             m_Retries.fetch_add(1, std::memory_order_relaxed);
+            m_Source->Invalidate();
             Restart();
         }
         else
@@ -486,16 +797,15 @@ void CropperCropWork::run()
 CropperPreviewWork::CropperPreviewWork(
     std::atomic_uint32_t& alive_cropper_work,
     fs::path card_name,
-    fs::path image_path,
+    std::shared_ptr<CropperSource> source,
     bool force,
-    std::function<const cv::Mat*(std::string_view)> get_color_cube,
+    std::function<const ColorCubeLut*(std::string_view)> get_color_cube,
     ImageDataBase& image_db,
     const Project& project,
     const Config& config)
-    : CropperWork{ alive_cropper_work }
+    : CropperWork{ alive_cropper_work, std::move(source) }
     , m_CardName{ std::move(card_name) }
-    , m_ImagePath{ std::move(image_path) }
-    , m_Rotation{ project.GetCardRotation(m_CardName) }
+    , m_Rotation{ m_Source->GetRotation() }
     , m_BleedType{ project.GetCardBleedType(m_CardName) }
     , m_BadAspectRatioHandling{ project.GetCardBadAspectRatioHandling(m_CardName) }
     , m_Force{ force }
@@ -504,6 +814,7 @@ CropperPreviewWork::CropperPreviewWork(
     , m_Data{ CopyRelevant(project.m_Data, config, false) }
     , m_Cfg{ CopyRelevant(config) }
 {
+    m_Pool = WorkerPool::Preview;
     m_Priorty = 1;
 }
 
@@ -514,6 +825,13 @@ void CropperPreviewWork::run()
         return;
     }
 
+    AtScopeExit prioritize_sibling_work{
+        [source = m_Source, self = this]()
+        {
+            PrioritizeSiblingWork(source, self);
+        }
+    };
+
     try
     {
         TRACY_AUTO_SCOPE();
@@ -528,7 +846,7 @@ void CropperPreviewWork::run()
 
         const bool fancy_uncrop{ m_Cfg.m_EnableFancyUncrop };
 
-        const fs::path input_file{ m_ImagePath };
+        const fs::path& input_file{ m_Source->GetPath() };
 
         const auto card_aspect_ratio{ card_size.x / card_size.y };
         const auto card_with_full_bleed_aspect_ratio{
@@ -537,7 +855,7 @@ void CropperPreviewWork::run()
 
         const std::string color_cube_name{ m_Cfg.m_ColorCube };
         const bool do_color_correction{ color_cube_name != "None" };
-        const cv::Mat* color_cube{ do_color_correction ? m_GetColorCube(color_cube_name) : nullptr };
+        const ColorCubeLut* color_cube{ do_color_correction ? m_GetColorCube(color_cube_name) : nullptr };
 
         const fs::path output_file{ fs::path{ input_file }.replace_extension(".prev") };
 
@@ -558,7 +876,7 @@ void CropperPreviewWork::run()
             if (fs::exists(input_file))
             {
                 QByteArray input_file_hash{
-                    m_ImageDB.TestEntry(output_file, input_file, image_params)
+                    m_ImageDB.TestEntry(output_file, m_Source->GetHash(m_ImageDB), image_params)
                 };
 
                 // empty hash indicates that the source has not changed
@@ -568,21 +886,32 @@ void CropperPreviewWork::run()
                     return;
                 }
 
-                const Image source_image{
+                // Held for the duration of this work, wrapping it in an Image
+                // only references its pixels
+                const std::shared_ptr<const Image> source_image{ m_Source->GetImage() };
+                if (CheckCancelled())
+                {
+                    return;
+                }
+                const auto shared_source_image{
                     [&]()
+                    {
+                        return Image{ source_image->GetUnderlying() };
+                    }
+                };
+
+                // Color correct only after downscaling, there is no need to pay
+                // for the full resolution image, a cancelled color correction
+                // returns an invalid image so it has to be checked right after
+                const auto color_correct{
+                    [&](Image image)
                     {
                         if (do_color_correction)
                         {
-                            return Image::Read(input_file)
-                                .Rotate(m_Rotation)
-                                .ApplyColorCube(*color_cube);
+                            return image.ApplyColorCube(*color_cube, GetCancellationToken());
                         }
-                        else
-                        {
-                            return Image::Read(input_file)
-                                .Rotate(m_Rotation);
-                        }
-                    }()
+                        return image;
+                    }
                 };
 
                 static constexpr auto c_BadAspectRatioTolerance{
@@ -592,7 +921,7 @@ void CropperPreviewWork::run()
                     0.01f
                 };
 
-                const auto image_aspect_ratio{ source_image.AspectRatio() };
+                const auto image_aspect_ratio{ source_image->AspectRatio() };
                 const auto with_bleed_diff{
                     std::abs(image_aspect_ratio - card_with_full_bleed_aspect_ratio)
                 };
@@ -620,15 +949,20 @@ void CropperPreviewWork::run()
                     std::abs(image_aspect_ratio - 1.0f / card_with_full_bleed_aspect_ratio) < c_BadRotationTolerance
                 };
 
-                auto image_preview{ new ImagePreview };
+                auto image_preview{ std::make_unique<ImagePreview>() };
                 if (image_has_bleed)
                 {
-                    const Image image{
-                        FixImageAspectRatio(source_image,
+                    const Image resized_image{
+                        FixImageAspectRatio(shared_source_image(),
                                             m_BadAspectRatioHandling,
                                             card_with_full_bleed_aspect_ratio)
                             .Resize(uncropped_size)
                     };
+                    const Image image{ color_correct(resized_image) };
+                    if (CheckCancelled())
+                    {
+                        return;
+                    }
 
                     const bool bad_aspect_ratio{
                         with_bleed_diff > c_BadAspectRatioTolerance
@@ -655,12 +989,17 @@ void CropperPreviewWork::run()
                         }()
                     };
 
-                    const Image image{
-                        FixImageAspectRatio(source_image,
+                    const Image resized_image{
+                        FixImageAspectRatio(shared_source_image(),
                                             m_BadAspectRatioHandling,
                                             card_aspect_ratio)
                             .Resize(cropped_size)
                     };
+                    const Image image{ color_correct(resized_image) };
+                    if (CheckCancelled())
+                    {
+                        return;
+                    }
 
                     const bool bad_aspect_ratio{
                         without_bleed_diff > c_BadAspectRatioTolerance
@@ -680,9 +1019,14 @@ void CropperPreviewWork::run()
                     image_preview->m_BadRotation = bad_rotation;
                 }
 
+                if (CheckCancelled())
+                {
+                    return;
+                }
+
                 m_ImageDB.PutEntry(output_file, std::move(input_file_hash), image_params);
 
-                PreviewUpdated(m_CardName, image_preview, m_Rotation);
+                PreviewUpdated(m_CardName, image_preview.release(), m_Rotation);
             }
         }
 
@@ -692,11 +1036,18 @@ void CropperPreviewWork::run()
     {
         TRACY_AUTO_SCOPE();
 
+        // Failures of obsolete work are of no interest, retrying even less so
+        if (CheckCancelled())
+        {
+            return;
+        }
+
         if (m_Retries.load(std::memory_order_relaxed) < c_MaxRetries)
         {
             // If user updated the file we may be reading it's still being written to,
             // Hopefully that's the only reason to end up here...
             m_Retries.fetch_add(1, std::memory_order_relaxed);
+            m_Source->Invalidate();
             Restart();
         }
         else
@@ -2,29 +2,101 @@
 
 #include <atomic>
 #include <functional>
-
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <QByteArray>
 #include <QObject>
 #include <QRunnable>
 
 #include <ppp/config.hpp>
+#include <ppp/worker_pools.hpp>
 #include <ppp/project/project.hpp>
 
+#include <ppp/util/cancellation_token.hpp>
+
+#include <ppp/profile/profile.hpp>
+
+class ColorCubeLut;
 class ImageDataBase;
+class CropperWork;
+
+// The source image of a single card, shared by all work for that card so that
+// the file is read, hashed and decoded only once. Work that finishes while the
+// decoded image is still around moves its waiting siblings to the front of their
+// pools, the decoded image is released again once the last of them ran.
+class CropperSource
+{
+  public:
+    CropperSource(fs::path image_path, Image::Rotation rotation);
+
+    const fs::path& GetPath() const;
+    Image::Rotation GetRotation() const;
+
+    QByteArray GetHash(ImageDataBase& image_db);
+    ImageMetaData GetMetaData();
+    std::shared_ptr<const Image> GetImage();
+
+    // Provides the decoded image up front, given unrotated like the image file
+    void SetImage(std::shared_ptr<const Image> image);
+
+    // Drops everything that was computed, e.g. because the source was read while
+    // still being written to
+    void Invalidate();
+
+    void AddWork(CropperWork* work);
+    void RemoveWork(CropperWork* work);
+
+    void PrioritizeWaitingWork(const CropperWork* finished_work);
+
+  private:
+    const fs::path m_ImagePath;
+    const Image::Rotation m_Rotation;
+
+    TRACY_DECLARE_MUTEX(std::mutex, m_Mutex);
+    std::optional<QByteArray> m_Hash;
+    std::optional<ImageMetaData> m_MetaData;
+    std::shared_ptr<const Image> m_Image;
+
+    // Set while the image is being hashed or decoded, the generation is bumped whenever
+    // the source is invalidated or replaced so that work still running won't publish
+    std::shared_future<QByteArray> m_Hashing;
+    std::shared_future<std::shared_ptr<const Image>> m_Decoding;
+    uint64_t m_Generation{ 0 };
+
+    TRACY_DECLARE_MUTEX(std::mutex, m_WorkMutex);
+    std::vector<CropperWork*> m_Work;
+};
 
 class CropperWork : public QObject, public QRunnable
 {
     Q_OBJECT
 
   public:
-    CropperWork(std::atomic_uint32_t& alive_cropper_work);
+    CropperWork(std::atomic_uint32_t& alive_cropper_work,
+                std::shared_ptr<CropperSource> source);
     ~CropperWork();
 
     void Start();
     void Restart();
     void Cancel();
 
+    // True if the work was started but has not been picked up by its pool yet
+    bool IsWaiting() const;
+
+    // Moves the work to the front of its pool's queue, e.g. because it can reuse
+    // an image that is only kept around until it ran
+    void Expedite();
+
     int Priority() const;
 
+    // Applies to the next time this work is started, or right away if it is queued
+    void SetPriority(int priority);
+
     enum Conclusion
     {
         Success,
@@ -34,22 +106,35 @@ class CropperWork : public QObject, public QRunnable
         RestartRequested,
     };
 
-  public slots:
-    void Pause();
-    void Unpause();
-
   signals:
     void Finished(Conclusion conclusion) const;
 
-    void OnUnpaused(QPrivateSignal) const;
-
   protected:
     bool EnterRun();
 
+    // Checkpoint between stages of run(), concludes the work as cancelled and
+    // returns true if cancellation was requested while running
+    bool CheckCancelled();
+
+    // For long running operations to stop early once cancelled
+    CancellationToken GetCancellationToken() const;
+
+    // Peak memory needed by run(), considered by the pool before starting the work,
+    // called once from EnterRun() on a pool thread since it may touch the source
+    virtual uint64_t EstimateMemory();
+
+    // To be called once run() concluded, may move sibling work forward in its pool
+    static void PrioritizeSiblingWork(std::shared_ptr<CropperSource> source, const CropperWork* finished_work);
+
     std::atomic_uint32_t& m_AliveCropperWork;
 
+    std::shared_ptr<CropperSource> m_Source;
+
+    WorkerPool m_Pool{ WorkerPool::Crop };
     int m_Priorty{ 0 };
 
+    inline static constexpr int c_ExpeditedPriority{ std::numeric_limits<int>::max() };
+
     inline static constexpr uint32_t c_MaxRetries{ 5 };
     std::atomic_uint32_t m_Retries{ 0 };
 
@@ -58,11 +143,12 @@ class CropperWork : public QObject, public QRunnable
     {
         Waiting,
         Running,
-        Paused,
         Cancelled,
     };
     std::atomic<State> m_State{ State::Waiting };
     std::atomic_bool m_CancelRequested{ false };
+
+    std::optional<uint64_t> m_MemoryEstimate;
 };
 
 class CropperCropWork : public CropperWork
@@ -74,25 +160,27 @@ class CropperCropWork : public CropperWork
         std::atomic_uint32_t& alive_cropper_work,
         std::atomic_uint32_t& running_crop_work,
         fs::path card_name,
-        fs::path image_path,
+        std::shared_ptr<CropperSource> source,
         bool backside_bleed,
-        std::function<const cv::Mat*(std::string_view)> get_color_cube,
+        std::function<const ColorCubeLut*(std::string_view)> get_color_cube,
         ImageDataBase& image_db,
         const Project& project,
         const Config& config);
 
     virtual void run() override;
 
+  protected:
+    virtual uint64_t EstimateMemory() override;
+
   private:
     std::atomic_uint32_t& m_RunningCropperWork;
 
     fs::path m_CardName;
-    fs::path m_ImagePath;
     Image::Rotation m_Rotation;
     BleedType m_BleedType;
     BadAspectRatioHandling m_BadAspectRatioHandling;
 
-    std::function<const cv::Mat*(std::string_view)> m_GetColorCube;
+    std::function<const ColorCubeLut*(std::string_view)> m_GetColorCube;
 
     ImageDataBase& m_ImageDB;
 
@@ -108,9 +196,9 @@ class CropperPreviewWork : public CropperWork
     CropperPreviewWork(
         std::atomic_uint32_t& alive_cropper_work,
         fs::path card_name,
-        fs::path image_path,
+        std::shared_ptr<CropperSource> source,
         bool force,
-        std::function<const cv::Mat*(std::string_view)> get_color_cube,
+        std::function<const ColorCubeLut*(std::string_view)> get_color_cube,
         ImageDataBase& image_db,
         const Project& project,
         const Config& config);
@@ -124,13 +212,12 @@ class CropperPreviewWork : public CropperWork
 
   private:
     fs::path m_CardName;
-    fs::path m_ImagePath;
     Image::Rotation m_Rotation;
     BleedType m_BleedType;
     BadAspectRatioHandling m_BadAspectRatioHandling;
     bool m_Force;
 
-    std::function<const cv::Mat*(std::string_view)> m_GetColorCube;
+    std::function<const ColorCubeLut*(std::string_view)> m_GetColorCube;
 
     ImageDataBase& m_ImageDB;
 
@@ -1,148 +1,246 @@
 #include <ppp/project/image_database.hpp>
 
-#include <QCryptographicHash>
-#include <QDebug>
-#include <QFile>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <type_traits>
+#include <vector>
 
-#include <nlohmann/json.hpp>
+#include <QFile>
 
-#include <magic_enum/magic_enum.hpp>
+#include <xxhash.h>
 
 #include <ppp/qt_util.hpp>
 #include <ppp/util/log.hpp>
 #include <ppp/version.hpp>
 
-bool operator!=(const ImageParameters& lhs, const ImageParameters& rhs)
+#ifdef _WIN32
+#include "Windows.h"
+#else
+#include <sys/stat.h>
+#endif
+
+struct ImageDataBaseHeader
+{
+    uint64_t m_Version;
+    uint64_t m_RecordSize;
+};
+
+struct ImageDataBaseRecord
+{
+    enum class Type : uint32_t
+    {
+        Entry,
+        Source,
+    };
+
+    Type m_Type;
+    uint32_t m_HashSize;
+    ImagePathKey m_Path;
+    std::array<char, 16> m_Hash;
+
+    // Only valid for Type::Entry
+    ImageParametersKey m_Params;
+
+    // Only valid for Type::Source
+    ImageSourceStat m_Stat;
+
+    static ImageDataBaseRecord FromEntry(const ImagePathKey& path, const ImageDataBaseEntry& entry);
+    static ImageDataBaseRecord FromSource(const ImagePathKey& path, const ImageSourceEntry& entry);
+
+    QByteArray Hash() const;
+};
+static_assert(std::is_trivially_copyable_v<ImageDataBaseRecord>);
+static_assert(sizeof(ImageDataBaseRecord) == 112, "Changing the record layout requires a new ImageDbFormatVersion");
+
+static constexpr ImageDataBaseHeader c_ImageDataBaseHeader{
+    .m_Version = ImageDbFormatVersion(),
+    .m_RecordSize = sizeof(ImageDataBaseRecord),
+};
+
+ImageParametersKey ImageParametersKey::FromParameters(const ImageParameters& params)
 {
-    return static_cast<int32_t>(std::floor(lhs.m_DPI.value)) != static_cast<int32_t>(std::floor(rhs.m_DPI.value)) ||
-           static_cast<int32_t>(std::floor(lhs.m_Width.value)) != static_cast<int32_t>(std::floor(rhs.m_Width.value)) ||
-           static_cast<int32_t>(std::floor(lhs.m_CardSize.x / 0.001_mm)) != static_cast<int32_t>(std::floor(rhs.m_CardSize.x / 0.001_mm)) ||
-           static_cast<int32_t>(std::floor(lhs.m_CardSize.y / 0.001_mm)) != static_cast<int32_t>(std::floor(rhs.m_CardSize.y / 0.001_mm)) ||
-           static_cast<int32_t>(std::floor(lhs.m_FullBleedEdge / 0.001_mm)) != static_cast<int32_t>(std::floor(rhs.m_FullBleedEdge / 0.001_mm)) ||
-           lhs.m_ColorCube != rhs.m_ColorCube ||
-           lhs.m_Rotation != rhs.m_Rotation ||
-           lhs.m_BleedType != rhs.m_BleedType ||
-           lhs.m_BadAspectRatioHandling != rhs.m_BadAspectRatioHandling;
+    const std::string& color_cube{ params.m_ColorCube };
+    return ImageParametersKey{
+        .m_ColorCube = XXH3_64bits(color_cube.data(), color_cube.size()),
+        .m_DPI = static_cast<int32_t>(std::floor(params.m_DPI.value)),
+        .m_Width = static_cast<int32_t>(std::floor(params.m_Width.value)),
+        .m_CardWidth = static_cast<int32_t>(std::floor(params.m_CardSize.x / 0.001_mm)),
+        .m_CardHeight = static_cast<int32_t>(std::floor(params.m_CardSize.y / 0.001_mm)),
+        .m_FullBleedEdge = static_cast<int32_t>(std::floor(params.m_FullBleedEdge / 0.001_mm)),
+        .m_Rotation = static_cast<uint32_t>(params.m_Rotation),
+        .m_BleedType = static_cast<uint32_t>(params.m_BleedType),
+        .m_BadAspectRatioHandling = static_cast<uint32_t>(params.m_BadAspectRatioHandling),
+    };
 }
 
-// NOLINTNEXTLINE
-void from_json(const nlohmann::json& json, ImageDataBaseEntry& entry)
+ImagePathKey ImagePathKey::FromPath(const fs::path& path)
 {
-    TRACY_AUTO_SCOPE();
+    const std::u8string path_string{ path.generic_u8string() };
+    const XXH128_hash_t hash{ XXH3_128bits(path_string.data(), path_string.size()) };
+    return ImagePathKey{
+        .m_Low = hash.low64,
+        .m_High = hash.high64,
+    };
+}
+
+ImageDataBaseRecord ImageDataBaseRecord::FromEntry(const ImagePathKey& path, const ImageDataBaseEntry& entry)
+{
+    ImageDataBaseRecord record{
+        .m_Type = Type::Entry,
+        .m_HashSize = static_cast<uint32_t>(std::min<size_t>(entry.m_SourceHash.size(), sizeof(m_Hash))),
+        .m_Path = path,
+        .m_Hash{},
+        .m_Params = entry.m_Params,
+        .m_Stat{},
+    };
+    std::memcpy(record.m_Hash.data(), entry.m_SourceHash.data(), record.m_HashSize);
+    return record;
+}
+
+ImageDataBaseRecord ImageDataBaseRecord::FromSource(const ImagePathKey& path, const ImageSourceEntry& entry)
+{
+    ImageDataBaseRecord record{
+        .m_Type = Type::Source,
+        .m_HashSize = static_cast<uint32_t>(std::min<size_t>(entry.m_Hash.size(), sizeof(m_Hash))),
+        .m_Path = path,
+        .m_Hash{},
+        .m_Params{},
+        .m_Stat = entry.m_Stat,
+    };
+    std::memcpy(record.m_Hash.data(), entry.m_Hash.data(), record.m_HashSize);
+    return record;
+}
 
-    // Should look something like this, but the lib never sets the object as binary on load
-    // const std::vector<uint8_t>& hash{ json["hash"].get_binary() };
-    const auto& hash{ json["hash"]["bytes"].get<std::vector<uint8_t>>() };
-    entry.m_SourceHash = QByteArray{
-        reinterpret_cast<const char*>(hash.data()),
-        static_cast<qsizetype>(hash.size()),
+QByteArray ImageDataBaseRecord::Hash() const
+{
+    return QByteArray{
+        m_Hash.data(),
+        static_cast<qsizetype>(std::min<size_t>(m_HashSize, sizeof(m_Hash))),
     };
+}
 
-    entry.m_Params.m_DPI.value = json["dpi"].get<int32_t>();
-    entry.m_Params.m_Width = json["width"].get<int32_t>() * 1_pix;
-    entry.m_Params.m_CardSize.x = json["card_size"]["width"].get<int32_t>() * 0.001_mm;
-    entry.m_Params.m_CardSize.y = json["card_size"]["height"].get<int32_t>() * 0.001_mm;
-    entry.m_Params.m_FullBleedEdge = json["card_input_bleed"].get<int32_t>() * 0.001_mm;
-    if (json.contains("color_cube"))
+static std::optional<ImageSourceStat> StatSource(const fs::path& source)
+{
+    TRACY_AUTO_SCOPE();
+
+    std::error_code error{};
+    const auto size{ fs::file_size(source, error) };
+    if (error)
     {
-        entry.m_Params.m_ColorCube = json["color_cube"];
+        return std::nullopt;
     }
-    if (json.contains("rotation"))
+
+    const auto last_write_time{ fs::last_write_time(source, error) };
+    if (error)
     {
-        entry.m_Params.m_Rotation = magic_enum::enum_cast<Image::Rotation>(json["rotation"].get_ref<const std::string&>())
-                                        .value_or(Image::Rotation::None);
+        return std::nullopt;
     }
-    if (json.contains("bleed_type"))
+
+    ImageSourceStat source_stat{
+        .m_Size = size,
+        .m_LastWriteTime = static_cast<int64_t>(last_write_time.time_since_epoch().count()),
+    };
+
+    // The file id catches files that were replaced by another file with the same size
+    // and time stamp, e.g. when restoring a backup
+#ifdef _WIN32
+    const HANDLE file{
+        CreateFileW(source.c_str(),
+                    0,
+                    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                    nullptr,
+                    OPEN_EXISTING,
+                    FILE_FLAG_BACKUP_SEMANTICS,
+                    nullptr)
+    };
+    if (file != INVALID_HANDLE_VALUE)
     {
-        entry.m_Params.m_BleedType = magic_enum::enum_cast<BleedType>(json["bleed_type"].get_ref<const std::string&>())
-                                         .value_or(BleedType::Default);
+        BY_HANDLE_FILE_INFORMATION file_info{};
+        if (GetFileInformationByHandle(file, &file_info))
+        {
+            source_stat.m_FileId = (static_cast<uint64_t>(file_info.nFileIndexHigh) << 32) | file_info.nFileIndexLow;
+            source_stat.m_DeviceId = file_info.dwVolumeSerialNumber;
+        }
+        CloseHandle(file);
     }
-    if (json.contains("ratio_handling"))
+#else
+    struct stat file_info{};
+    if (stat(source.c_str(), &file_info) == 0)
     {
-        entry.m_Params.m_BadAspectRatioHandling = magic_enum::enum_cast<BadAspectRatioHandling>(json["ratio_handling"].get_ref<const std::string&>())
-                                                      .value_or(BadAspectRatioHandling::Default);
+        source_stat.m_FileId = static_cast<uint64_t>(file_info.st_ino);
+        source_stat.m_DeviceId = static_cast<uint64_t>(file_info.st_dev);
     }
+#endif
+
+    return source_stat;
 }
 
-// NOLINTNEXTLINE
-void to_json(nlohmann::json& json, const ImageDataBaseEntry& entry)
+static QByteArray StreamHashSource(const fs::path& source)
 {
     TRACY_AUTO_SCOPE();
 
-    json["hash"] = nlohmann::json::binary_t{
-        std::vector<uint8_t>{
-            entry.m_SourceHash.begin(),
-            entry.m_SourceHash.end(),
-        },
-    };
-    json["dpi"] = static_cast<int32_t>(entry.m_Params.m_DPI.value),
-    json["width"] = static_cast<int32_t>(entry.m_Params.m_Width.value),
-    json["card_size"] = nlohmann::json{
-        {
-            "width",
-            static_cast<int32_t>(entry.m_Params.m_CardSize.x / 0.001_mm),
-        },
+    QFile source_file{ ToQString(source) };
+    if (!source_file.open(QFile::ReadOnly))
+    {
+        return {};
+    }
+
+    XXH3_state_t* state{ XXH3_createState() };
+    AtScopeExit free_state{
+        [state]()
         {
-            "height",
-            static_cast<int32_t>(entry.m_Params.m_CardSize.y / 0.001_mm),
-        },
+            XXH3_freeState(state);
+        }
     };
-    json["card_input_bleed"] = static_cast<int32_t>(entry.m_Params.m_FullBleedEdge / 0.001_mm);
-    json["color_cube"] = entry.m_Params.m_ColorCube;
-    json["rotation"] = magic_enum::enum_name(entry.m_Params.m_Rotation);
-    json["bleed_type"] = magic_enum::enum_name(entry.m_Params.m_BleedType);
-    json["ratio_handling"] = magic_enum::enum_name(entry.m_Params.m_BadAspectRatioHandling);
-}
-
-ImageDataBase ImageDataBase::FromFile(const fs::path& path)
-{
-    TRACY_AUTO_SCOPE();
+    XXH3_128bits_reset(state);
 
-    if (fs::exists(path))
+    static constexpr qint64 c_ChunkSize{ 1024 * 1024 };
+    std::vector<char> chunk(c_ChunkSize);
+    while (true)
     {
-        try
+        const qint64 read{ source_file.read(chunk.data(), c_ChunkSize) };
+        if (read < 0)
         {
-            const nlohmann::json json{ nlohmann::json::parse(std::ifstream{ path }) };
-            if (!json.contains("version") || !json["version"].is_string() || json["version"].get_ref<const std::string&>() != ImageDbFormatVersion())
-            {
-                throw std::logic_error{ "Image databse version not compatible with App version..." };
-            }
-
-            return ImageDataBase{ json["db"].get<DataBaseMap>(), path };
+            return {};
         }
-        catch (const std::exception& e)
+        if (read == 0)
         {
-            fmt::print("Failed loading image database, continuing with an empty image database: {}", e.what());
+            break;
         }
+        XXH3_128bits_update(state, chunk.data(), static_cast<size_t>(read));
     }
+
+    XXH128_canonical_t hash{};
+    XXH128_canonicalFromHash(&hash, XXH3_128bits_digest(state));
+    return QByteArray{
+        reinterpret_cast<const char*>(hash.digest),
+        static_cast<qsizetype>(sizeof(hash.digest)),
+    };
+}
+
+ImageDataBase ImageDataBase::FromFile(const fs::path& path)
+{
+    TRACY_AUTO_SCOPE();
     return ImageDataBase{ path };
 }
 
+ImageDataBase::~ImageDataBase()
+{
+    WaitForCompaction();
+}
+
 ImageDataBase& ImageDataBase::Read(const fs::path& path)
 {
     TRACY_AUTO_SCOPE();
 
-    try
-    {
-        const nlohmann::json json{ nlohmann::json::parse(std::ifstream{ path }) };
-        if (!json.contains("version") || !json["version"].is_string() || json["version"].get_ref<const std::string&>() != ImageDbFormatVersion())
-        {
-            throw std::logic_error{ "Image databse version not compatible with App version..." };
-        }
+    WaitForCompaction();
+    Clear();
 
-        TRACY_SCOPED_LOCK(m_Mutex);
-        m_DataBase = json["db"].get<DataBaseMap>();
-        m_Path = path;
-    }
-    catch (const std::exception& e)
-    {
-        fmt::print("{}", e.what());
-
-        // Failed loading image database, continuing with an empty image databse...
-        TRACY_SCOPED_LOCK(m_Mutex);
-        m_DataBase.clear();
-        m_Path.clear();
-    }
+    m_Path = path;
+    Load();
 
     return *this;
 }
@@ -153,15 +251,25 @@ void ImageDataBase::Write()
 
     LogInfo("Writing image database to {}", m_Path.string());
 
-    TRACY_SCOPED_LOCK(m_Mutex);
-    if (std::ofstream file{ m_Path })
+    WaitForCompaction();
+
+    bool needs_compaction{ false };
     {
-        nlohmann::json json{};
-        json["version"] = ImageDbFormatVersion();
-        json["db"] = m_DataBase;
+        TRACY_SCOPED_LOCK(m_JournalMutex);
+        m_Journal.flush();
+
+        needs_compaction = m_Journal.is_open() &&
+                           m_JournalRecords > m_LiveRecords.load(std::memory_order_relaxed);
+        if (needs_compaction)
+        {
+            m_Compacting = true;
+            m_CompactionBacklog.clear();
+        }
+    }
 
-        file << json;
-        file.close();
+    if (needs_compaction)
+    {
+        Compact();
     }
 }
 
@@ -170,54 +278,107 @@ bool ImageDataBase::FindEntry(const fs::path& destination) const
     TRACY_AUTO_SCOPE();
     TRACY_SCOPE_INFO_FMT("Dest: {}", destination.string());
 
-    TRACY_SCOPED_LOCK(m_Mutex);
+    const ImagePathKey key{ ImagePathKey::FromPath(destination) };
+    Shard& shard{ GetShard(key) };
 
-    return m_DataBase.contains(destination);
+    TRACY_SCOPED_LOCK(shard.m_Mutex);
+    return shard.m_DataBase.contains(key);
 }
 
-QByteArray ImageDataBase::TestEntry(const fs::path& destination, const fs::path& source, ImageParameters params) const
+QByteArray ImageDataBase::TestEntry(const fs::path& destination, const fs::path& source, ImageParameters params)
+{
+    return TestEntry(destination, HashSource(source), params);
+}
+
+QByteArray ImageDataBase::TestEntry(const fs::path& destination, const QByteArray& source_hash, ImageParameters params) const
 {
     TRACY_AUTO_SCOPE();
-    TRACY_SCOPE_INFO_FMT("Dest: {}\nSrc:  {}", destination.string(), source.string());
+    TRACY_SCOPE_INFO_FMT("Dest: {}", destination.string());
 
-    if (!fs::exists(source))
+    if (source_hash.isEmpty())
     {
         return {};
     }
 
-    auto get_source_data{
-        [&]()
-        {
-            QFile source_file{ ToQString(source) };
-            source_file.open(QFile::ReadOnly);
-            return source_file.readAll();
-        }
-    };
-    QByteArray cur_hash{ QCryptographicHash::hash(get_source_data(), QCryptographicHash::Md5) };
-
     if (params.m_WillWriteOutput && !fs::exists(destination))
     {
-        return cur_hash;
+        return source_hash;
     }
 
-    TRACY_SCOPED_LOCK(m_Mutex);
-    auto it{ m_DataBase.find(destination) };
-    if (it != m_DataBase.end())
+    const ImagePathKey key{ ImagePathKey::FromPath(destination) };
+    Shard& shard{ GetShard(key) };
+
+    TRACY_SCOPED_LOCK(shard.m_Mutex);
+    auto it{ shard.m_DataBase.find(key) };
+    if (it != shard.m_DataBase.end())
     {
-        if (it->second.m_Params != params)
+        if (it->second.m_Params != ImageParametersKey::FromParameters(params))
         {
-            return cur_hash;
+            return source_hash;
         }
 
         QByteArrayView hash{ it->second.m_SourceHash };
-        if (hash != cur_hash)
+        if (hash != source_hash)
+        {
+            return source_hash;
+        }
+
+        return {};
+    }
+    return source_hash;
+}
+
+QByteArray ImageDataBase::HashSource(const fs::path& source)
+{
+    TRACY_AUTO_SCOPE();
+    TRACY_SCOPE_INFO_FMT("Src: {}", source.string());
+
+    const std::optional<ImageSourceStat> source_stat{ StatSource(source) };
+    if (!source_stat.has_value())
+    {
+        return {};
+    }
+
+    const ImagePathKey key{ ImagePathKey::FromPath(source) };
+    Shard& shard{ GetShard(key) };
+
+    {
+        TRACY_SCOPED_LOCK(shard.m_Mutex);
+        const auto it{ shard.m_Sources.find(key) };
+        if (it != shard.m_Sources.end() && it->second.m_Stat == source_stat.value())
         {
-            return cur_hash;
+            return it->second.m_Hash;
         }
+    }
 
+    QByteArray hash{ StreamHashSource(source) };
+    if (hash.isEmpty())
+    {
         return {};
     }
-    return cur_hash;
+
+    // A file written to right now may change again without its time stamp changing,
+    // so we only remember stats that are old enough to be trusted
+    static constexpr std::chrono::seconds c_RacyWriteInterval{ 2 };
+    const auto last_write_time{ fs::file_time_type{ fs::file_time_type::duration{ source_stat->m_LastWriteTime } } };
+    if (fs::file_time_type::clock::now() - last_write_time > c_RacyWriteInterval)
+    {
+        ImageSourceEntry entry{
+            .m_Stat{ source_stat.value() },
+            .m_Hash{ hash },
+        };
+        const ImageDataBaseRecord record{ ImageDataBaseRecord::FromSource(key, entry) };
+
+        // Appending under the shard lock keeps the file in the same order as memory
+        TRACY_SCOPED_LOCK(shard.m_Mutex);
+        if (shard.m_Sources.insert_or_assign(key, std::move(entry)).second)
+        {
+            m_LiveRecords.fetch_add(1, std::memory_order_relaxed);
+        }
+        Append(record);
+    }
+
+    return hash;
 }
 
 void ImageDataBase::PutEntry(const fs::path& destination, QByteArray source_hash, ImageParameters params)
@@ -225,22 +386,250 @@ void ImageDataBase::PutEntry(const fs::path& destination, QByteArray source_hash
     TRACY_AUTO_SCOPE();
     TRACY_SCOPE_INFO_FMT("Dest: {}", destination.string());
 
-    TRACY_SCOPED_LOCK(m_Mutex);
-
-    m_DataBase[destination] = ImageDataBaseEntry{
+    const ImagePathKey key{ ImagePathKey::FromPath(destination) };
+    ImageDataBaseEntry entry{
         .m_SourceHash{ std::move(source_hash) },
-        .m_Params{ params },
+        .m_Params{ ImageParametersKey::FromParameters(params) },
     };
+    const ImageDataBaseRecord record{ ImageDataBaseRecord::FromEntry(key, entry) };
+
+    Shard& shard{ GetShard(key) };
+
+    // Appending under the shard lock keeps the file in the same order as memory
+    TRACY_SCOPED_LOCK(shard.m_Mutex);
+    if (shard.m_DataBase.insert_or_assign(key, std::move(entry)).second)
+    {
+        m_LiveRecords.fetch_add(1, std::memory_order_relaxed);
+    }
+    Append(record);
 }
 
 ImageDataBase::ImageDataBase(fs::path path)
     : m_Path{ std::move(path) }
 {
+    Load();
+}
+
+ImageDataBase::Shard& ImageDataBase::GetShard(const ImagePathKey& key) const
+{
+    // Use other bits than the hash map does, otherwise each shard only ever sees
+    // keys that land in the same buckets
+    return m_Shards[key.m_High % c_NumShards];
+}
+
+void ImageDataBase::Load()
+{
+    TRACY_AUTO_SCOPE();
+
+    if (m_Path.empty())
+    {
+        return;
+    }
+
+    size_t num_records{ 0 };
+    bool valid_file{ false };
+
+    try
+    {
+        if (std::ifstream in_file{ m_Path, std::ios_base::binary })
+        {
+            ImageDataBaseHeader header{};
+            in_file.read(reinterpret_cast<char*>(&header), sizeof(header));
+            if (in_file &&
+                header.m_Version == c_ImageDataBaseHeader.m_Version &&
+                header.m_RecordSize == c_ImageDataBaseHeader.m_RecordSize)
+            {
+                valid_file = true;
+
+                ImageDataBaseRecord record{};
+                while (in_file.read(reinterpret_cast<char*>(&record), sizeof(record)))
+                {
+                    num_records++;
+
+                    Shard& shard{ GetShard(record.m_Path) };
+                    TRACY_SCOPED_LOCK(shard.m_Mutex);
+                    switch (record.m_Type)
+                    {
+                    case ImageDataBaseRecord::Type::Entry:
+                        shard.m_DataBase[record.m_Path] = ImageDataBaseEntry{
+                            .m_SourceHash{ record.Hash() },
+                            .m_Params{ record.m_Params },
+                        };
+                        break;
+                    case ImageDataBaseRecord::Type::Source:
+                        shard.m_Sources[record.m_Path] = ImageSourceEntry{
+                            .m_Stat{ record.m_Stat },
+                            .m_Hash{ record.Hash() },
+                        };
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        LogError("Failed loading image database, continuing with an empty image database: {}", e.what());
+        Clear();
+        num_records = 0;
+        valid_file = false;
+    }
+
+    size_t live_records{ 0 };
+    for (Shard& shard : m_Shards)
+    {
+        TRACY_SCOPED_LOCK(shard.m_Mutex);
+        live_records += shard.m_DataBase.size() + shard.m_Sources.size();
+    }
+    m_LiveRecords.store(live_records, std::memory_order_relaxed);
+
+    std::error_code error{};
+    if (valid_file)
+    {
+        // Drop a partially written record at the end, otherwise everything
+        // appended after it would be misaligned
+        fs::resize_file(m_Path, sizeof(ImageDataBaseHeader) + num_records * sizeof(ImageDataBaseRecord), error);
+    }
+    else if (std::ofstream out_file{ m_Path, std::ios_base::binary | std::ios_base::trunc })
+    {
+        out_file.write(reinterpret_cast<const char*>(&c_ImageDataBaseHeader), sizeof(c_ImageDataBaseHeader));
+    }
+
+    TRACY_SCOPED_LOCK(m_JournalMutex);
+    m_Journal.open(m_Path, std::ios_base::binary | std::ios_base::app);
+    m_JournalRecords = num_records;
+}
+
+void ImageDataBase::Clear()
+{
+    TRACY_AUTO_SCOPE();
+
+    for (Shard& shard : m_Shards)
+    {
+        TRACY_SCOPED_LOCK(shard.m_Mutex);
+        shard.m_DataBase.clear();
+        shard.m_Sources.clear();
+    }
+    m_LiveRecords.store(0, std::memory_order_relaxed);
+
+    TRACY_SCOPED_LOCK(m_JournalMutex);
+    m_Journal.close();
+    m_JournalRecords = 0;
+}
+
+void ImageDataBase::Append(const ImageDataBaseRecord& record)
+{
+    TRACY_AUTO_SCOPE();
+
+    TRACY_SCOPED_LOCK(m_JournalMutex);
+    if (!m_Journal.is_open())
+    {
+        return;
+    }
+
+    m_Journal.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    m_Journal.flush();
+    m_JournalRecords++;
+
+    if (m_Compacting)
+    {
+        m_CompactionBacklog.push_back(record);
+    }
+    else
+    {
+        // Most stale records come from re-cropping the same cards over and over, we
+        // don't want to bother compacting a small file
+        static constexpr size_t c_MinRecordsForCompaction{ 4096 };
+        if (m_JournalRecords > c_MinRecordsForCompaction &&
+            m_JournalRecords > 2 * m_LiveRecords.load(std::memory_order_relaxed))
+        {
+            StartCompaction();
+        }
+    }
+}
+
+void ImageDataBase::StartCompaction()
+{
+    // Expects m_JournalMutex to be locked
+    m_Compacting = true;
+    m_CompactionBacklog.clear();
+    m_Compaction = std::async(std::launch::async,
+                              [this]()
+                              {
+                                  Compact();
+                              });
+}
+
+void ImageDataBase::Compact()
+{
+    TRACY_AUTO_SCOPE();
+
+    // Records appended from here on end up in the backlog, it does not matter if
+    // they also make it into the snapshot since replaying them is idempotent
+    std::vector<ImageDataBaseRecord> records{};
+    for (Shard& shard : m_Shards)
+    {
+        TRACY_SCOPED_LOCK(shard.m_Mutex);
+        for (const auto& [key, entry] : shard.m_DataBase)
+        {
+            records.push_back(ImageDataBaseRecord::FromEntry(key, entry));
+        }
+        for (const auto& [key, entry] : shard.m_Sources)
+        {
+            records.push_back(ImageDataBaseRecord::FromSource(key, entry));
+        }
+    }
+
+    const fs::path temp_path{ fs::path{ m_Path } += ".tmp" };
+    std::ofstream temp_file{ temp_path, std::ios_base::binary | std::ios_base::trunc };
+    temp_file.write(reinterpret_cast<const char*>(&c_ImageDataBaseHeader), sizeof(c_ImageDataBaseHeader));
+    temp_file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(ImageDataBaseRecord));
+
+    TRACY_SCOPED_LOCK(m_JournalMutex);
+    temp_file.write(reinterpret_cast<const char*>(m_CompactionBacklog.data()),
+                    m_CompactionBacklog.size() * sizeof(ImageDataBaseRecord));
+    temp_file.close();
+
+    if (temp_file)
+    {
+        m_Journal.close();
+
+        std::error_code error{};
+        fs::rename(temp_path, m_Path, error);
+        if (error)
+        {
+            LogError("Failed compacting image database: {}", error.message());
+            fs::remove(temp_path, error);
+        }
+        else
+        {
+            m_JournalRecords = records.size() + m_CompactionBacklog.size();
+        }
+
+        m_Journal.open(m_Path, std::ios_base::binary | std::ios_base::app);
+    }
+    else
+    {
+        std::error_code error{};
+        fs::remove(temp_path, error);
+    }
+
+    m_CompactionBacklog.clear();
+    m_Compacting = false;
 }
 
-ImageDataBase::ImageDataBase(DataBaseMap database,
-                             fs::path path)
-    : m_DataBase{ std::move(database) }
-    , m_Path{ std::move(path) }
+void ImageDataBase::WaitForCompaction()
 {
-}
\ No newline at end of file
+    TRACY_AUTO_SCOPE();
+
+    std::future<void> compaction{};
+    {
+        TRACY_SCOPED_LOCK(m_JournalMutex);
+        compaction = std::move(m_Compaction);
+    }
+
+    if (compaction.valid())
+    {
+        compaction.wait();
+    }
+}
@@ -2,6 +2,9 @@
 
 #include <array>
 #include <charconv>
+#include <cstring>
+#include <fstream>
+#include <random>
 #include <ranges>
 #include <string>
 
@@ -139,6 +142,54 @@ fs::path GetOutputDir(const fs::path& crop_dir, Length bleed_edge, const std::st
     return crop_dir;
 }
 
+namespace
+{
+struct PreviewCacheHeader
+{
+    uint64_t m_Version;
+    uint64_t m_Generation;
+    uint64_t m_IndexOffset;
+    uint64_t m_IndexSize;
+};
+
+// Keeps the preview cache mapped for as long as any preview references its bytes
+class PreviewCacheFile
+{
+  public:
+    PreviewCacheFile(const fs::path& path)
+        : m_File{ ToQString(path) }
+    {
+        if (m_File.open(QFile::ReadOnly) && m_File.size() > 0)
+        {
+            m_Data = m_File.map(0, m_File.size());
+        }
+    }
+
+    bool Valid() const
+    {
+        return m_Data != nullptr;
+    }
+
+    EncodedImageView Data() const
+    {
+        return EncodedImageView{
+            reinterpret_cast<const std::byte*>(m_Data),
+            static_cast<size_t>(m_File.size()),
+        };
+    }
+
+  private:
+    QFile m_File;
+    uchar* m_Data{ nullptr };
+};
+
+uint64_t NewPreviewCacheGeneration()
+{
+    std::random_device random_device{};
+    return (static_cast<uint64_t>(random_device()) << 32) | random_device();
+}
+} // namespace
+
 ImgDict ReadPreviews(const fs::path& img_cache_file, const fs::path& fallback_name)
 {
     TRACY_AUTO_SCOPE();
@@ -147,66 +198,83 @@ ImgDict ReadPreviews(const fs::path& img_cache_file, const fs::path& fallback_na
 
     try
     {
-        if (std::ifstream in_file{ img_cache_file, std::ios_base::binary })
+        auto cache_file{ std::make_shared<const PreviewCacheFile>(img_cache_file) };
+        if (cache_file->Valid())
         {
-            const auto read = [&in_file]<class T>(TagT<T>) -> T
+            // Only the index is read here, images are decoded once they are accessed
+            const EncodedImageView data{ cache_file->Data() };
+            const auto read_bytes{
+                [&data](uint64_t offset, uint64_t size) -> EncodedImageView
+                {
+                    if (offset > data.size() || size > data.size() - offset)
+                    {
+                        throw std::out_of_range{ "Preview cache is truncated" };
+                    }
+                    return data.subspan(offset, size);
+                }
+            };
+            const auto read = [&read_bytes]<class T>(TagT<T>, uint64_t& offset) -> T
             {
                 T val;
-                in_file.read(reinterpret_cast<char*>(&val), sizeof(val));
+                std::memcpy(&val, read_bytes(offset, sizeof(T)).data(), sizeof(T));
+                offset += sizeof(T);
                 return val;
             };
-            const auto read_arr = [&in_file, &read]<class T>(TagT<T>) -> std::vector<T>
-            {
-                const size_t size{ read(c_Tag<size_t>) };
-                std::vector<T> buffer(size, T{});
 
-                const size_t data_size{ size * sizeof(T) };
-                in_file.read(reinterpret_cast<char*>(buffer.data()), data_size);
-                return buffer;
-            };
-
-            const size_t version_uint64_read{ read(c_Tag<size_t>) };
-            if (version_uint64_read != ImageCacheFormatVersion())
+            uint64_t offset{ 0 };
+            const auto header{ read(c_Tag<PreviewCacheHeader>, offset) };
+            if (header.m_Version != ImageCacheFormatVersion())
             {
-                in_file.close();
+                cache_file.reset();
                 fs::remove(img_cache_file);
-                return {};
             }
-
-            const size_t num_images{ read(c_Tag<size_t>) };
-
-            for (size_t i = 0; i < num_images; ++i)
+            else
             {
-                const std::vector img_name_buf{ read_arr(c_Tag<char>) };
-                const std::string_view img_name{ img_name_buf.data(), img_name_buf.size() };
-
-                ImagePreview img{};
-
-                {
-                    const std::vector img_buf{ read_arr(c_Tag<std::byte>) };
-                    img.m_CroppedImage = Image::Decode(img_buf);
-                }
-
+                offset = header.m_IndexOffset;
+                const uint64_t index_end{ header.m_IndexOffset + header.m_IndexSize };
+                const auto read_image{
+                    [&]()
+                    {
+                        const PreviewCacheLocation location{
+                            .m_Generation = header.m_Generation,
+                            .m_Offset = read(c_Tag<uint64_t>, offset),
+                            .m_Size = read(c_Tag<uint64_t>, offset),
+                        };
+                        const EncodedImageView encoded{ read_bytes(location.m_Offset, location.m_Size) };
+                        return PreviewImage{ encoded, cache_file, location };
+                    }
+                };
+
+                const uint64_t num_images{ read(c_Tag<uint64_t>, offset) };
+                for (uint64_t i = 0; i < num_images && offset < index_end; ++i)
                 {
-                    const std::vector img_buf{ read_arr(c_Tag<std::byte>) };
-                    img.m_UncroppedImage = Image::Decode(img_buf);
+                    const uint64_t img_name_size{ read(c_Tag<uint64_t>, offset) };
+                    const EncodedImageView img_name_buf{ read_bytes(offset, img_name_size) };
+                    const std::string_view img_name{
+                        reinterpret_cast<const char*>(img_name_buf.data()),
+                        img_name_buf.size(),
+                    };
+                    offset += img_name_size;
+
+                    ImagePreview img{};
+                    img.m_CroppedImage = read_image();
+                    img.m_UncroppedImage = read_image();
+                    img.m_BadAspectRatio = read(c_Tag<uint8_t>, offset) != 0;
+                    img.m_BadRotation = read(c_Tag<uint8_t>, offset) != 0;
+
+                    img_dict[img_name] = std::move(img);
                 }
-
-                img.m_BadAspectRatio = read(c_Tag<bool>);
-                img.m_BadRotation = read(c_Tag<bool>);
-
-                img_dict[img_name] = std::move(img);
             }
         }
     }
     catch (std::exception& e)
     {
         fmt::print("Failed loading previews: {}", e.what());
+        img_dict.clear();
         if (fs::exists(img_cache_file))
         {
             fs::remove(img_cache_file);
         }
-        img_dict.clear();
     }
 
     if (!img_dict.contains(fallback_name))
@@ -220,45 +288,247 @@ ImgDict ReadPreviews(const fs::path& img_cache_file, const fs::path& fallback_na
     return img_dict;
 }
 
-void WritePreviews(const fs::path& img_cache_file, const ImgDict& img_dict)
+// Appends all previews that are not yet in the cache, followed by a new index. The header
+// is updated last, so until then the file stays valid with its old index. Returns false if
+// the cache has to be rewritten instead, e.g. because it holds too many stale images
+static bool AppendPreviews(const fs::path& img_cache_file, const ImgDict& img_dict)
 {
     TRACY_AUTO_SCOPE();
 
-    if (std::ofstream out_file{ img_cache_file, std::ios_base::binary | std::ios_base::trunc })
+    QFile file{ ToQString(img_cache_file) };
+    if (!file.open(QFile::ReadWrite))
+    {
+        return false;
+    }
+
+    PreviewCacheHeader header{};
+    if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) != sizeof(header) ||
+        header.m_Version != ImageCacheFormatVersion() ||
+        header.m_IndexOffset < sizeof(header) ||
+        header.m_IndexOffset > static_cast<uint64_t>(file.size()))
+    {
+        return false;
+    }
+
+    const auto is_cached{
+        [&header](const PreviewImage& image)
+        {
+            const auto location{ image.GetCacheLocation() };
+            return location.has_value() && location->m_Generation == header.m_Generation;
+        }
+    };
+
+    uint64_t live_bytes{ 0 };
+    for (const auto& [_, image] : img_dict)
+    {
+        for (const PreviewImage* preview_image : { &image.m_CroppedImage, &image.m_UncroppedImage })
+        {
+            if (is_cached(*preview_image))
+            {
+                live_bytes += preview_image->GetCacheLocation()->m_Size;
+            }
+        }
+    }
+
+    // Rewriting is only worth it once a good chunk of the file is stale
+    static constexpr uint64_t c_MinStaleBytes{ 16 * 1024 * 1024 };
+    const uint64_t data_bytes{ header.m_IndexOffset - sizeof(header) };
+    const uint64_t stale_bytes{ data_bytes - std::min(data_bytes, live_bytes) };
+    if (stale_bytes > c_MinStaleBytes && stale_bytes > live_bytes)
+    {
+        return false;
+    }
+
+    // The old index stays in place until the header points to the new one, afterwards
+    // it counts as stale bytes like any replaced image
+    const uint64_t file_size{ static_cast<uint64_t>(file.size()) };
+    uint64_t offset{ file_size };
+    file.seek(offset);
+
+    std::vector<std::byte> index{};
+    const auto write_index = [&index](const auto& val)
+    {
+        const auto* bytes{ reinterpret_cast<const std::byte*>(&val) };
+        index.insert(index.end(), bytes, bytes + sizeof(val));
+    };
+
+    write_index(static_cast<uint64_t>(img_dict.size()));
+    for (const auto& [name, image] : img_dict)
+    {
+        const std::string name_str{ name.string() };
+        write_index(static_cast<uint64_t>(name_str.size()));
+        index.insert(index.end(),
+                     reinterpret_cast<const std::byte*>(name_str.data()),
+                     reinterpret_cast<const std::byte*>(name_str.data() + name_str.size()));
+
+        for (const PreviewImage* preview_image : { &image.m_CroppedImage, &image.m_UncroppedImage })
+        {
+            if (!is_cached(*preview_image))
+            {
+                const EncodedImageView encoded{ preview_image->GetEncoded() };
+                if (file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size()) != static_cast<qint64>(encoded.size()))
+                {
+                    return false;
+                }
+
+                preview_image->SetCacheLocation(PreviewCacheLocation{
+                    .m_Generation = header.m_Generation,
+                    .m_Offset = offset,
+                    .m_Size = encoded.size(),
+                });
+                offset += encoded.size();
+            }
+
+            const auto location{ preview_image->GetCacheLocation().value() };
+            write_index(location.m_Offset);
+            write_index(location.m_Size);
+        }
+
+        write_index(static_cast<uint8_t>(image.m_BadAspectRatio));
+        write_index(static_cast<uint8_t>(image.m_BadRotation));
+    }
+
+    // Nothing to do if no image was appended and the index would come out the same,
+    // which is the common case when previews are written without any card changing
+    if (offset == file_size && header.m_IndexSize == index.size() && file.seek(header.m_IndexOffset))
+    {
+        const QByteArray old_index{ file.read(static_cast<qint64>(index.size())) };
+        if (static_cast<size_t>(old_index.size()) == index.size() &&
+            std::memcmp(old_index.data(), index.data(), index.size()) == 0)
+        {
+            return true;
+        }
+        file.seek(offset);
+    }
+
+    if (file.write(reinterpret_cast<const char*>(index.data()), index.size()) != static_cast<qint64>(index.size()) ||
+        !file.flush())
+    {
+        return false;
+    }
+
+    header.m_IndexOffset = offset;
+    header.m_IndexSize = index.size();
+    file.seek(0);
+    return file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header);
+}
+
+// Writes all previews into a new cache file, reusing already encoded images
+static void RewritePreviews(const fs::path& img_cache_file, const ImgDict& img_dict)
+{
+    TRACY_AUTO_SCOPE();
+
+    const fs::path temp_cache_file{ fs::path{ img_cache_file } += ".tmp" };
+
+    PreviewCacheHeader header{
+        .m_Version = ImageCacheFormatVersion(),
+        .m_Generation = NewPreviewCacheGeneration(),
+        .m_IndexOffset = 0,
+        .m_IndexSize = 0,
+    };
+
+    std::vector<std::pair<const PreviewImage*, PreviewCacheLocation>> locations{};
+    bool written{ false };
+    if (std::ofstream out_file{ temp_cache_file, std::ios_base::binary | std::ios_base::trunc })
     {
         const auto write = [&out_file](const auto& val)
         {
             out_file.write(reinterpret_cast<const char*>(&val), sizeof(val));
         };
-        const auto write_arr = [&out_file, &write](const auto* val, size_t size)
+
+        write(header);
+
+        uint64_t offset{ sizeof(header) };
+        for (const auto& [_, image] : img_dict)
         {
-            write(size);
+            for (const PreviewImage* preview_image : { &image.m_CroppedImage, &image.m_UncroppedImage })
+            {
+                const EncodedImageView encoded{ preview_image->GetEncoded() };
+                out_file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+
+                locations.push_back({
+                    preview_image,
+                    PreviewCacheLocation{
+                        .m_Generation = header.m_Generation,
+                        .m_Offset = offset,
+                        .m_Size = encoded.size(),
+                    },
+                });
+                offset += encoded.size();
+            }
+        }
 
-            const size_t data_size{ size * sizeof(*val) };
-            out_file.write(reinterpret_cast<const char*>(val), data_size);
-        };
+        header.m_IndexOffset = offset;
 
-        write(ImageCacheFormatVersion());
-        write(img_dict.size());
+        auto location_it{ locations.begin() };
+        write(static_cast<uint64_t>(img_dict.size()));
         for (const auto& [name, image] : img_dict)
         {
             const std::string name_str{ name.string() };
-            write_arr(name_str.data(), name_str.size());
+            write(static_cast<uint64_t>(name_str.size()));
+            out_file.write(name_str.data(), name_str.size());
 
+            for (size_t i = 0; i < 2; ++i, ++location_it)
             {
-                const auto buf{ image.m_CroppedImage.EncodeJpg(50) };
-                write_arr(buf.data(), buf.size());
-            }
-            {
-                const auto buf{ image.m_UncroppedImage.EncodeJpg(50) };
-                write_arr(buf.data(), buf.size());
+                write(location_it->second.m_Offset);
+                write(location_it->second.m_Size);
             }
-            write(image.m_BadAspectRatio);
-            write(image.m_BadRotation);
+
+            write(static_cast<uint8_t>(image.m_BadAspectRatio));
+            write(static_cast<uint8_t>(image.m_BadRotation));
+        }
+
+        header.m_IndexSize = static_cast<uint64_t>(out_file.tellp()) - header.m_IndexOffset;
+        out_file.seekp(0);
+        write(header);
+
+        written = static_cast<bool>(out_file);
+    }
+
+    std::error_code error{};
+    if (!written)
+    {
+        LogError("Failed writing preview cache to {}", temp_cache_file.string());
+        fs::remove(temp_cache_file, error);
+        return;
+    }
+
+    // Previews may still reference the old file, which can't be replaced while it is mapped
+    for (const auto& [preview_image, _] : locations)
+    {
+        preview_image->DetachFromCache();
+    }
+
+    fs::rename(temp_cache_file, img_cache_file, error);
+    if (error)
+    {
+        LogError("Failed writing preview cache: {}", error.message());
+        fs::remove(temp_cache_file, error);
+        return;
+    }
+
+    // Map the new file so previews don't have to hold on to their own copies
+    auto cache_file{ std::make_shared<const PreviewCacheFile>(img_cache_file) };
+    if (cache_file->Valid())
+    {
+        const EncodedImageView data{ cache_file->Data() };
+        for (const auto& [preview_image, location] : locations)
+        {
+            preview_image->BindToCache(location, data.subspan(location.m_Offset, location.m_Size), cache_file);
         }
     }
 }
 
+void WritePreviews(const fs::path& img_cache_file, const ImgDict& img_dict)
+{
+    TRACY_AUTO_SCOPE();
+
+    if (!fs::exists(img_cache_file) || !AppendPreviews(img_cache_file, img_dict))
+    {
+        RewritePreviews(img_cache_file, img_dict);
+    }
+}
+
 cv::Mat LoadColorCube(const fs::path& file_path)
 {
     QFile color_cube_file{ ToQString(file_path) };
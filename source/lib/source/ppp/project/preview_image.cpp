@@ -0,0 +1,107 @@
+#include <ppp/project/preview_image.hpp>
+
+PreviewImage::PreviewImage(Image image)
+    : m_State{ std::make_shared<State>() }
+{
+    m_State->m_Image = std::move(image);
+}
+
+PreviewImage::PreviewImage(EncodedImageView encoded,
+                           std::shared_ptr<const void> encoded_owner,
+                           PreviewCacheLocation location)
+    : m_State{ std::make_shared<State>() }
+{
+    m_State->m_EncodedView = encoded;
+    m_State->m_EncodedOwner = std::move(encoded_owner);
+    m_State->m_Location = location;
+}
+
+PreviewImage& PreviewImage::operator=(Image image)
+{
+    m_State = std::make_shared<State>();
+    m_State->m_Image = std::move(image);
+    return *this;
+}
+
+const Image& PreviewImage::Get() const
+{
+    static const Image c_EmptyImage{};
+    if (m_State == nullptr)
+    {
+        return c_EmptyImage;
+    }
+
+    TRACY_SCOPED_LOCK(m_State->m_Mutex);
+    if (!m_State->m_Image.Valid() && !m_State->m_EncodedView.empty())
+    {
+        TRACY_AUTO_SCOPE();
+        m_State->m_Image = Image::Decode(m_State->m_EncodedView);
+    }
+    return m_State->m_Image;
+}
+
+EncodedImageView PreviewImage::GetEncoded() const
+{
+    if (m_State == nullptr)
+    {
+        return {};
+    }
+
+    TRACY_SCOPED_LOCK(m_State->m_Mutex);
+    if (m_State->m_EncodedView.empty() && m_State->m_Image.Valid())
+    {
+        TRACY_AUTO_SCOPE();
+        m_State->m_Encoded = m_State->m_Image.EncodeJpg(50);
+        m_State->m_EncodedView = m_State->m_Encoded;
+    }
+    return m_State->m_EncodedView;
+}
+
+std::optional<PreviewCacheLocation> PreviewImage::GetCacheLocation() const
+{
+    if (m_State == nullptr)
+    {
+        return std::nullopt;
+    }
+
+    TRACY_SCOPED_LOCK(m_State->m_Mutex);
+    return m_State->m_Location;
+}
+
+void PreviewImage::SetCacheLocation(PreviewCacheLocation location) const
+{
+    if (m_State != nullptr)
+    {
+        TRACY_SCOPED_LOCK(m_State->m_Mutex);
+        m_State->m_Location = location;
+    }
+}
+
+void PreviewImage::BindToCache(PreviewCacheLocation location,
+                               EncodedImageView encoded,
+                               std::shared_ptr<const void> encoded_owner) const
+{
+    if (m_State != nullptr)
+    {
+        TRACY_SCOPED_LOCK(m_State->m_Mutex);
+        m_State->m_Encoded = EncodedImage{};
+        m_State->m_EncodedView = encoded;
+        m_State->m_EncodedOwner = std::move(encoded_owner);
+        m_State->m_Location = location;
+    }
+}
+
+void PreviewImage::DetachFromCache() const
+{
+    if (m_State != nullptr)
+    {
+        TRACY_SCOPED_LOCK(m_State->m_Mutex);
+        if (m_State->m_EncodedOwner != nullptr)
+        {
+            m_State->m_Encoded.assign(m_State->m_EncodedView.begin(), m_State->m_EncodedView.end());
+            m_State->m_EncodedView = m_State->m_Encoded;
+            m_State->m_EncodedOwner.reset();
+        }
+        m_State->m_Location.reset();
+    }
+}
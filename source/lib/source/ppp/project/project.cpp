@@ -1,7 +1,9 @@
 #include <ppp/project/project.hpp>
 
+#include <algorithm>
 #include <cmath>
 #include <ranges>
+#include <unordered_set>
 #include <utility>
 
 #include <nlohmann/json.hpp>
@@ -241,9 +243,18 @@ bool Project::LoadFromJson(const std::string& json_blob,
         m_Data.m_ImageCache = m_Data.m_CropDir / "preview.cache";
 
         // Note: Not using get_value as we don't support overriding card values right now
+        {
+            // Put all cards at once instead of one-by-one, avoids quadratic loading times
+            std::vector<fs::path> card_names;
+            for (const nlohmann::json& card_json : json["cards"])
+            {
+                card_names.push_back(card_json["name"].get<std::string>());
+            }
+            PutCards(card_names);
+        }
         for (const nlohmann::json& card_json : json["cards"])
         {
-            CardInfo& card{ PutCard(card_json["name"]) };
+            CardInfo& card{ *FindCard(card_json["name"].get<std::string>()) };
             card.m_Num = card_json["num"];
             card.m_Hidden = card_json["hidden"];
             if (card_json.contains("backside"))
@@ -287,6 +298,7 @@ bool Project::LoadFromJson(const std::string& json_blob,
                 };
             }
         }
+        m_Data.RebuildCardIndex();
 
         {
             // no-{}
@@ -819,14 +831,13 @@ void Project::InitProperties()
     };
 
     // Check that we have all our cards accounted for
-    for (const auto& img : img_list)
-    {
-        auto* card{ FindCard(img) };
-        if (card == nullptr && img != m_Cfg.m_FallbackName)
-        {
-            CardAdded(img);
-        }
-    }
+    const auto new_images{
+        img_list |
+            std::views::filter([this](const auto& img)
+                               { return FindCard(img) == nullptr && img != m_Cfg.m_FallbackName; }) |
+            std::ranges::to<std::vector>(),
+    };
+    CardsAdded(new_images);
 
     // And also check we don't have stale cards in here
     const auto stale_images{
@@ -1066,11 +1077,13 @@ uint32_t Project::DecrementCardCount(const fs::path& card_name)
 void Project::CardOrderChanged()
 {
     std::ranges::sort(m_Data.m_Cards, GetSortFunction(m_Cfg));
+    m_Data.RebuildCardIndex();
 }
 
 void Project::CardOrderDirectionChanged()
 {
     std::ranges::sort(m_Data.m_Cards, GetSortFunction(m_Cfg));
+    m_Data.RebuildCardIndex();
 }
 
 void Project::RestoreCardsOrder()
@@ -1113,13 +1126,7 @@ CardInfo& Project::CardAdded(const fs::path& card_name)
     if (card == nullptr)
     {
         card = &PutCard(card_name);
-        for (const auto& other_card : m_Data.m_Cards)
-        {
-            if (other_card.m_Backside == card_name)
-            {
-                card->m_Hidden++;
-            }
-        }
+        card->m_Hidden += static_cast<uint32_t>(m_Data.FindFrontsides(card_name).size());
     }
     else if (card->m_Transient)
     {
@@ -1139,6 +1146,28 @@ CardInfo& Project::CardAdded(const fs::path& card_name)
     return *card;
 }
 
+void Project::CardsAdded(std::span<const fs::path> card_names)
+{
+    TRACY_AUTO_SCOPE();
+
+    // Insert all cards at once, so that the card index is only rebuilt once
+    PutCards(card_names);
+
+    // Count frontsides before matching any backsides, otherwise cards that are
+    // matched as backsides within this batch would be hidden twice
+    for (const auto& card_name : card_names)
+    {
+        auto& card{ *FindCard(card_name) };
+        card.m_Hidden += static_cast<uint32_t>(m_Data.FindFrontsides(card_name).size());
+    }
+
+    for (const auto& card_name : card_names)
+    {
+        AutoMatchBackside(card_name);
+        AppendCardToList(card_name);
+    }
+}
+
 void Project::CardRemoved(const fs::path& card_name)
 {
     auto* card{ FindCard(card_name) };
@@ -1183,19 +1212,21 @@ void Project::CardRenamed(const fs::path& old_card_name, const fs::path& new_car
         old_card.value().m_LastWriteTime = TryGetLastWriteTime(old_card->GetSourceFolder(m_Data) / new_card_name);
         PutCard(std::move(old_card).value());
 
-        for (auto& other_card : m_Data.m_Cards)
+        const auto frontsides{
+            m_Data.FindFrontsides(old_card_name) |
+            std::ranges::to<std::vector>()
+        };
+        for (const auto& frontside : frontsides)
         {
-            if (other_card.m_Backside == old_card_name)
+            auto& other_card{ *FindCard(frontside) };
+            if (other_card.m_BacksideAutoAssigned == true)
             {
-                if (other_card.m_BacksideAutoAssigned == true)
-                {
-                    SetBacksideImage(other_card.m_Name, "");
-                    UnhideCard(new_card_name);
-                }
-                else
-                {
-                    other_card.m_Backside = new_card_name;
-                }
+                SetBacksideImage(other_card.m_Name, "");
+                UnhideCard(new_card_name);
+            }
+            else
+            {
+                m_Data.SetCardBackside(other_card, new_card_name);
             }
         }
         AutoMatchBackside(new_card_name);
@@ -1227,9 +1258,7 @@ void Project::CardModified(const fs::path& card_name)
 
 bool Project::HasCard(const fs::path& card_name) const
 {
-    return std::ranges::find(m_Data.m_Cards,
-                             card_name,
-                             &CardInfo::m_Name) != m_Data.m_Cards.end();
+    return m_Data.FindCard(card_name) != nullptr;
 }
 
 const CardInfo* Project::FindCard(const fs::path& card_name) const
@@ -1244,25 +1273,17 @@ CardInfo* Project::FindCard(const fs::path& card_name)
 
 bool Project::HasCardByStem(const fs::path& card_name) const
 {
-    return std::ranges::find(m_Data.m_Cards,
-                             card_name,
-                             &CardInfo::Stem) != m_Data.m_Cards.end();
+    return m_Data.FindCardByStem(card_name) != nullptr;
 }
 
 const CardInfo* Project::FindCardByStem(const fs::path& card_name) const
 {
-    auto it{ std::ranges::find(m_Data.m_Cards,
-                               card_name,
-                               &CardInfo::Stem) };
-    return it != m_Data.m_Cards.end() ? &*it : nullptr;
+    return m_Data.FindCardByStem(card_name);
 }
 
 CardInfo* Project::FindCardByStem(const fs::path& card_name)
 {
-    auto it{ std::ranges::find(m_Data.m_Cards,
-                               card_name,
-                               &CardInfo::Stem) };
-    return it != m_Data.m_Cards.end() ? &*it : nullptr;
+    return m_Data.FindCardByStem(card_name);
 }
 
 CardInfo& Project::PutCard(const fs::path& card_name)
@@ -1287,6 +1308,7 @@ CardInfo& Project::PutCard(const fs::path& card_name)
         m_Data.m_Cards
             .insert(insert_at, std::move(new_card))
     };
+    m_Data.IndexInsertedCard(static_cast<size_t>(new_card_it - m_Data.m_Cards.begin()));
 
     return *new_card_it;
 }
@@ -1308,20 +1330,55 @@ CardInfo& Project::PutCard(CardInfo card)
         m_Data.m_Cards.insert(insert_at,
                               std::move(card))
     };
+    m_Data.IndexInsertedCard(static_cast<size_t>(new_card_it - m_Data.m_Cards.begin()));
 
     return *new_card_it;
 }
 
+void Project::PutCards(std::span<const fs::path> card_names)
+{
+    TRACY_AUTO_SCOPE();
+
+    const auto sort_function{ GetSortFunction(m_Cfg) };
+    const auto num_old_cards{ static_cast<std::ptrdiff_t>(m_Data.m_Cards.size()) };
+
+    std::unordered_set<fs::path> new_card_names;
+    for (const auto& card_name : card_names)
+    {
+        if (FindCard(card_name) != nullptr || !new_card_names.insert(card_name).second)
+        {
+            continue;
+        }
+
+        m_Data.m_Cards.push_back(CardInfo{
+            .m_Name{ card_name },
+            .m_Num = 1,
+            .m_Hidden = card_name.string().starts_with("__") ? 1u : 0u,
+            .m_LastWriteTime{ TryGetLastWriteTime(m_Data.m_ImageDir / card_name) },
+            .m_TimeAdded{ CardInfoClock::now() },
+        });
+    }
+
+    // Same order as inserting the cards one-by-one via PutCard, since both
+    // sorting and merging are stable
+    const auto new_cards_begin{ m_Data.m_Cards.begin() + num_old_cards };
+    std::stable_sort(new_cards_begin, m_Data.m_Cards.end(), sort_function);
+    std::inplace_merge(m_Data.m_Cards.begin(), new_cards_begin, m_Data.m_Cards.end(), sort_function);
+    m_Data.RebuildCardIndex();
+}
+
 std::optional<CardInfo> Project::EatCard(const fs::path& card_name)
 {
-    auto it{ std::ranges::find(m_Data.m_Cards,
-                               card_name,
-                               &CardInfo::m_Name) };
-    if (it == m_Data.m_Cards.end())
+    auto* existing_card{ FindCard(card_name) };
+    if (existing_card == nullptr)
     {
         return std::nullopt;
     }
 
+    const auto card_index{ static_cast<size_t>(existing_card - m_Data.m_Cards.data()) };
+    m_Data.UnindexCard(card_index);
+
+    const auto it{ m_Data.m_Cards.begin() + card_index };
     std::optional<CardInfo> card{ std::move(*it) };
     m_Data.m_Cards.erase(it);
     return card;
@@ -1359,11 +1416,11 @@ const ImagePreview& Project::GetPreview(const fs::path& card_name) const
 
 const Image& Project::GetCroppedPreview(const fs::path& card_name) const
 {
-    return GetPreview(card_name).m_CroppedImage;
+    return GetPreview(card_name).m_CroppedImage.Get();
 }
 const Image& Project::GetUncroppedPreview(const fs::path& card_name) const
 {
-    return GetPreview(card_name).m_UncroppedImage;
+    return GetPreview(card_name).m_UncroppedImage.Get();
 }
 
 const Image& Project::GetCroppedBacksidePreview(const fs::path& card_name) const
@@ -1372,7 +1429,7 @@ const Image& Project::GetCroppedBacksidePreview(const fs::path& card_name) const
     {
         return GetCroppedPreview(backside_image.value().get());
     }
-    return m_Data.m_FallbackPreview.m_CroppedImage;
+    return m_Data.m_FallbackPreview.m_CroppedImage.Get();
 }
 const Image& Project::GetUncroppedBacksidePreview(const fs::path& card_name) const
 {
@@ -1380,7 +1437,7 @@ const Image& Project::GetUncroppedBacksidePreview(const fs::path& card_name) con
     {
         return GetUncroppedPreview(backside_image.value().get());
     }
-    return m_Data.m_FallbackPreview.m_UncroppedImage;
+    return m_Data.m_FallbackPreview.m_UncroppedImage.Get();
 }
 
 void Project::SetOutputFilename(fs::path output_filename)
@@ -1890,8 +1947,8 @@ bool Project::SetBacksideImage(const fs::path& card_name, fs::path backside_imag
             return false;
         }
 
-        auto old_backside{ std::move(card->m_Backside) };
-        card->m_Backside = std::move(backside_image);
+        auto old_backside{ card->m_Backside };
+        m_Data.SetCardBackside(*card, std::move(backside_image));
 
         CardBacksideChanged(card_name, card->m_Backside.value());
 
@@ -1913,7 +1970,7 @@ bool Project::ClearBacksideImage(const fs::path& card_name)
         if (card->m_Backside.has_value())
         {
             const bool old_backside_shown{ UnhideCard(card->m_Backside.value()) };
-            card->m_Backside = std::nullopt;
+            m_Data.SetCardBackside(*card, std::nullopt);
             CardBacksideChanged(card_name, std::nullopt);
             return old_backside_shown;
         }
@@ -2734,18 +2791,170 @@ const Svg& ProjectData::CardSvgData(const ConfigData& config) const
 
 const CardInfo* ProjectData::FindCard(const fs::path& card_name) const
 {
-    auto it{ std::ranges::find(m_Cards,
-                               card_name,
-                               &CardInfo::m_Name) };
-    return it != m_Cards.end() ? &*it : nullptr;
+    auto it{ m_CardIndex.m_ByName.find(card_name) };
+    return it != m_CardIndex.m_ByName.end() ? &m_Cards[it->second] : nullptr;
 }
 
 CardInfo* ProjectData::FindCard(const fs::path& card_name)
 {
-    auto it{ std::ranges::find(m_Cards,
-                               card_name,
-                               &CardInfo::m_Name) };
-    return it != m_Cards.end() ? &*it : nullptr;
+    auto it{ m_CardIndex.m_ByName.find(card_name) };
+    return it != m_CardIndex.m_ByName.end() ? &m_Cards[it->second] : nullptr;
+}
+
+const CardInfo* ProjectData::FindCardByStem(const fs::path& card_stem) const
+{
+    const auto indices{ FindCardsByStem(card_stem) };
+    return !indices.empty() ? &m_Cards[indices.front()] : nullptr;
+}
+
+CardInfo* ProjectData::FindCardByStem(const fs::path& card_stem)
+{
+    const auto indices{ FindCardsByStem(card_stem) };
+    return !indices.empty() ? &m_Cards[indices.front()] : nullptr;
+}
+
+std::span<const size_t> ProjectData::FindCardsByStem(const fs::path& card_stem) const
+{
+    auto it{ m_CardIndex.m_ByStem.find(card_stem) };
+    if (it == m_CardIndex.m_ByStem.end())
+    {
+        return {};
+    }
+    return it->second;
+}
+
+std::span<const fs::path> ProjectData::FindFrontsides(const fs::path& backside_name) const
+{
+    auto it{ m_CardIndex.m_FrontsByBackside.find(backside_name) };
+    if (it == m_CardIndex.m_FrontsByBackside.end())
+    {
+        return {};
+    }
+    return it->second;
+}
+
+void ProjectData::RebuildCardIndex()
+{
+    TRACY_AUTO_SCOPE();
+
+    m_CardIndex.m_ByName.clear();
+    m_CardIndex.m_ByStem.clear();
+    m_CardIndex.m_FrontsByBackside.clear();
+    m_CardIndex.m_ByName.reserve(m_Cards.size());
+    m_CardIndex.m_ByStem.reserve(m_Cards.size());
+
+    for (size_t i = 0; i < m_Cards.size(); ++i)
+    {
+        const CardInfo& card{ m_Cards[i] };
+        m_CardIndex.m_ByName.try_emplace(card.m_Name, i);
+        m_CardIndex.m_ByStem[card.Stem()].push_back(i);
+        if (HasNonClearNonDefaultBackside(card))
+        {
+            m_CardIndex.m_FrontsByBackside[card.m_Backside.value()].push_back(card.m_Name);
+        }
+    }
+}
+
+static void EraseFrontside(ProjectData::CardIndex& card_index, const CardInfo& card)
+{
+    if (HasNonClearNonDefaultBackside(card))
+    {
+        auto it{ card_index.m_FrontsByBackside.find(card.m_Backside.value()) };
+        if (it != card_index.m_FrontsByBackside.end())
+        {
+            std::erase(it->second, card.m_Name);
+            if (it->second.empty())
+            {
+                card_index.m_FrontsByBackside.erase(it);
+            }
+        }
+    }
+}
+
+void ProjectData::IndexInsertedCard(size_t card_index)
+{
+    TRACY_AUTO_SCOPE();
+
+    // All cards behind the new one moved back by one
+    for (auto& [_, i] : m_CardIndex.m_ByName)
+    {
+        if (i >= card_index)
+        {
+            ++i;
+        }
+    }
+    for (auto& [_, indices] : m_CardIndex.m_ByStem)
+    {
+        for (size_t& i : indices)
+        {
+            if (i >= card_index)
+            {
+                ++i;
+            }
+        }
+    }
+
+    const CardInfo& card{ m_Cards[card_index] };
+    m_CardIndex.m_ByName.try_emplace(card.m_Name, card_index);
+
+    auto& stem_indices{ m_CardIndex.m_ByStem[card.Stem()] };
+    stem_indices.insert(std::ranges::upper_bound(stem_indices, card_index), card_index);
+
+    if (HasNonClearNonDefaultBackside(card))
+    {
+        m_CardIndex.m_FrontsByBackside[card.m_Backside.value()].push_back(card.m_Name);
+    }
+}
+
+void ProjectData::UnindexCard(size_t card_index)
+{
+    TRACY_AUTO_SCOPE();
+
+    const CardInfo& card{ m_Cards[card_index] };
+    m_CardIndex.m_ByName.erase(card.m_Name);
+
+    const auto stem_it{ m_CardIndex.m_ByStem.find(card.Stem()) };
+    if (stem_it != m_CardIndex.m_ByStem.end())
+    {
+        std::erase(stem_it->second, card_index);
+        if (stem_it->second.empty())
+        {
+            m_CardIndex.m_ByStem.erase(stem_it);
+        }
+    }
+
+    EraseFrontside(m_CardIndex, card);
+
+    // All cards behind the removed one will move forward by one
+    for (auto& [_, i] : m_CardIndex.m_ByName)
+    {
+        if (i > card_index)
+        {
+            --i;
+        }
+    }
+    for (auto& [_, indices] : m_CardIndex.m_ByStem)
+    {
+        for (size_t& i : indices)
+        {
+            if (i > card_index)
+            {
+                --i;
+            }
+        }
+    }
+}
+
+void ProjectData::SetCardBackside(CardInfo& card, std::optional<fs::path> backside)
+{
+    EraseFrontside(m_CardIndex, card);
+
+    card.m_Backside = std::move(backside);
+
+    if (HasNonClearNonDefaultBackside(card))
+    {
+        m_CardIndex.m_FrontsByBackside[card.m_Backside.value()].push_back(card.m_Name);
+    }
 }
 
 CardSorting ProjectData::GenerateDefaultCardsSorting() const
@@ -2944,12 +3153,9 @@ std::optional<fs::path> Project::FindCardAutoBackside(const fs::path& card_name)
     const auto placeholder_pos{ auto_backside.find('$') };
     auto_backside.replace(placeholder_pos, 1, card_name.stem().string());
 
-    for (auto& card : m_Data.m_Cards)
+    if (const auto* card{ m_Data.FindCardByStem(auto_backside) })
     {
-        if (card.m_Name.stem() == auto_backside)
-        {
-            return card.m_Name;
-        }
+        return card->m_Name;
     }
 
     return std::nullopt;
@@ -2974,14 +3180,12 @@ std::optional<fs::path> Project::MatchAsAutoBackside(const fs::path& card_name)
                 .substr(0, name_str.size() - back.size())
                 .substr(front.size()),
         };
-        for (auto& card : m_Data.m_Cards)
+        for (const size_t i : m_Data.FindCardsByStem(front_name))
         {
+            const auto& card{ m_Data.m_Cards[i] };
             if (HasDefaultBackside(card) || card.m_BacksideAutoAssigned)
             {
-                if (card.m_Name.stem() == front_name)
-                {
-                    return card.m_Name;
-                }
+                return card.m_Name;
             }
         }
     }
@@ -0,0 +1,511 @@
+#include <ppp/worker_pools.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <magic_enum/magic_enum.hpp>
+
+#include <ppp/util/log.hpp>
+
+#include <ppp/profile/profile.hpp>
+
+float WorkerPoolStats::Utilization() const
+{
+    return m_MaxThreads == 0
+               ? 0.0f
+               : static_cast<float>(m_ActiveThreads) / static_cast<float>(m_MaxThreads);
+}
+
+class PrioritizedPool;
+
+// Limits the number of threads running work across all pools, a pool that finds no
+// free thread defers its work and registers itself to be restarted once one is released
+// A number of threads is reserved for a single pool, all other pools share the rest,
+// that pool is also restarted first whenever a thread is released
+class SharedThreadBudget
+{
+  public:
+    void SetMaxThreads(uint32_t max_threads, PrioritizedPool* reserved_pool, uint32_t reserved_threads)
+    {
+        std::vector<PrioritizedPool*> waiting_pools{};
+        {
+            TRACY_SCOPED_LOCK(m_Mutex);
+            m_MaxThreads = max_threads;
+            m_ReservedPool = reserved_pool;
+            m_ReservedThreads = std::min(reserved_threads, max_threads);
+            waiting_pools = TakeWaitingPools();
+        }
+        RestartPools(waiting_pools);
+    }
+
+    bool TryAcquire(PrioritizedPool* pool)
+    {
+        TRACY_SCOPED_LOCK(m_Mutex);
+        const bool is_reserved_pool{ pool == m_ReservedPool };
+        if (m_ActiveThreads < m_MaxThreads &&
+            (is_reserved_pool || m_ActiveSharedThreads < m_MaxThreads - m_ReservedThreads))
+        {
+            ++m_ActiveThreads;
+            if (!is_reserved_pool)
+            {
+                ++m_ActiveSharedThreads;
+            }
+            return true;
+        }
+
+        if (!std::ranges::contains(m_WaitingPools, pool))
+        {
+            m_WaitingPools.push_back(pool);
+        }
+        return false;
+    }
+
+    void Release(PrioritizedPool* pool)
+    {
+        std::vector<PrioritizedPool*> waiting_pools{};
+        {
+            TRACY_SCOPED_LOCK(m_Mutex);
+            --m_ActiveThreads;
+            if (pool != m_ReservedPool)
+            {
+                --m_ActiveSharedThreads;
+            }
+            waiting_pools = TakeWaitingPools();
+        }
+        RestartPools(waiting_pools);
+    }
+
+    void Forget(PrioritizedPool* pool)
+    {
+        TRACY_SCOPED_LOCK(m_Mutex);
+        std::erase(m_WaitingPools, pool);
+    }
+
+  private:
+    // The reserved pool goes first, so it gets the chance to pick up the released thread
+    std::vector<PrioritizedPool*> TakeWaitingPools()
+    {
+        std::vector<PrioritizedPool*> waiting_pools{ std::exchange(m_WaitingPools, {}) };
+        const auto reserved_it{ std::ranges::find(waiting_pools, m_ReservedPool) };
+        if (reserved_it != waiting_pools.end())
+        {
+            std::rotate(waiting_pools.begin(), reserved_it, reserved_it + 1);
+        }
+        return waiting_pools;
+    }
+
+    static void RestartPools(std::span<PrioritizedPool* const> pools);
+
+    TRACY_DECLARE_MUTEX(std::mutex, m_Mutex);
+    uint32_t m_MaxThreads{ 1 };
+    uint32_t m_ActiveThreads{ 0 };
+
+    PrioritizedPool* m_ReservedPool{ nullptr };
+    uint32_t m_ReservedThreads{ 0 };
+    uint32_t m_ActiveSharedThreads{ 0 };
+
+    std::vector<PrioritizedPool*> m_WaitingPools;
+};
+
+static SharedThreadBudget& GetThreadBudget()
+{
+    static SharedThreadBudget s_ThreadBudget{};
+    return s_ThreadBudget;
+}
+
+// QThreadPool only orders work by priority when it is queued, but has no way of
+// telling how much is queued, so we keep the queue ourselves and only hand the
+// QThreadPool tasks that pick the next work from our queue
+// The same way we only admit work while its estimated memory fits into the budget and
+// a thread of the shared budget is free
+class PrioritizedPool
+{
+    struct QueuedWork
+    {
+        QRunnable* m_Work{ nullptr };
+        uint64_t m_MemoryEstimate{ 0 };
+    };
+
+    // Highest priority first, std::multimap keeps insertion order for equal keys
+    using Queue = std::multimap<int, QueuedWork, std::greater<int>>;
+
+  public:
+    // Constructs the budget before any pool, so that it outlives all of them
+    PrioritizedPool()
+        : m_ThreadBudget{ GetThreadBudget() }
+    {
+    }
+
+    ~PrioritizedPool()
+    {
+        m_ThreadBudget.Forget(this);
+
+        // Work that never started is dropped, running work is waited on since
+        // it still accesses the queue once it finishes
+        {
+            TRACY_SCOPED_LOCK(m_QueueMutex);
+            for (auto& [_, queued] : m_Queue)
+            {
+                if (queued.m_Work->autoDelete())
+                {
+                    delete queued.m_Work;
+                }
+            }
+            m_Queue.clear();
+        }
+        m_Pool.waitForDone();
+    }
+
+    void SetMaxThreads(uint32_t max_threads)
+    {
+        m_Pool.setMaxThreadCount(static_cast<int>(max_threads));
+    }
+
+    void SetMemoryBudget(uint64_t memory_budget)
+    {
+        {
+            TRACY_SCOPED_LOCK(m_QueueMutex);
+            m_MemoryBudget = memory_budget;
+        }
+        RestartDeferred();
+    }
+
+    void Start(QRunnable* work, int priority, uint64_t memory_estimate)
+    {
+        {
+            TRACY_SCOPED_LOCK(m_QueueMutex);
+            m_Queue.emplace(priority, QueuedWork{ work, memory_estimate });
+            m_PeakQueued = std::max(m_PeakQueued, static_cast<uint32_t>(m_Queue.size()));
+        }
+
+        m_Pool.start([this]()
+                     { RunNext(); });
+    }
+
+    bool TryTake(QRunnable* work)
+    {
+        TRACY_SCOPED_LOCK(m_QueueMutex);
+        if (m_Paused)
+        {
+            return false;
+        }
+
+        const auto it{ FindQueued(work) };
+        if (it == m_Queue.end())
+        {
+            return false;
+        }
+
+        // The task that would have run this work will pick other work or do nothing
+        m_Queue.erase(it);
+        return true;
+    }
+
+    bool Reprioritize(QRunnable* work, int priority)
+    {
+        TRACY_SCOPED_LOCK(m_QueueMutex);
+        const auto it{ FindQueued(work) };
+        if (it == m_Queue.end())
+        {
+            return false;
+        }
+
+        if (it->first != priority)
+        {
+            const QueuedWork queued{ it->second };
+            m_Queue.erase(it);
+            m_Queue.emplace(priority, queued);
+        }
+        return true;
+    }
+
+    void Pause()
+    {
+        TRACY_SCOPED_LOCK(m_QueueMutex);
+        m_Paused = true;
+    }
+
+    void Resume()
+    {
+        size_t parked_work{ 0 };
+        {
+            TRACY_SCOPED_LOCK(m_QueueMutex);
+            if (!m_Paused)
+            {
+                return;
+            }
+
+            m_Paused = false;
+            parked_work = m_Queue.size();
+        }
+
+        // Tasks that ran while paused returned without picking any work, so we
+        // need one new task per parked work, the queue still has it in order
+        for (size_t i = 0; i < parked_work; ++i)
+        {
+            m_Pool.start([this]()
+                         { RunNext(); });
+        }
+    }
+
+    WorkerPoolStats Stats(bool reset_peak)
+    {
+        TRACY_SCOPED_LOCK(m_QueueMutex);
+        const auto queued{ static_cast<uint32_t>(m_Queue.size()) };
+        WorkerPoolStats stats{
+            .m_MaxThreads{ static_cast<uint32_t>(m_Pool.maxThreadCount()) },
+            .m_ActiveThreads{ m_ActiveThreads.load(std::memory_order_relaxed) },
+            .m_QueuedWork{ queued },
+            .m_PeakQueuedWork{ m_PeakQueued },
+            .m_FinishedWork{ m_FinishedWork.load(std::memory_order_relaxed) },
+            .m_Paused{ m_Paused },
+            .m_MemoryBudget{ m_MemoryBudget },
+            .m_InFlightMemory{ m_InFlightMemory },
+            .m_PeakInFlightMemory{ m_PeakInFlightMemory },
+        };
+        if (reset_peak)
+        {
+            m_PeakQueued = queued;
+            m_PeakInFlightMemory = m_InFlightMemory;
+        }
+        return stats;
+    }
+
+    // Restarts tasks that found no work fitting the memory or thread budget
+    void RestartDeferred()
+    {
+        size_t deferred_tasks{ 0 };
+        {
+            TRACY_SCOPED_LOCK(m_QueueMutex);
+            deferred_tasks = std::exchange(m_DeferredTasks, 0);
+        }
+
+        for (size_t i = 0; i < deferred_tasks; ++i)
+        {
+            m_Pool.start([this]()
+                         { RunNext(); });
+        }
+    }
+
+  private:
+    Queue::iterator FindQueued(QRunnable* work)
+    {
+        return std::ranges::find(m_Queue, work, [](const auto& entry)
+                                 { return entry.second.m_Work; });
+    }
+
+    void RunNext()
+    {
+        QueuedWork queued{};
+        {
+            TRACY_SCOPED_LOCK(m_QueueMutex);
+            if (m_Paused || m_Queue.empty())
+            {
+                return;
+            }
+
+            // Take the first work that fits into the budget, if nothing is running
+            // we take the first work regardless, otherwise it might never run
+            const auto fits{
+                [this](const auto& entry)
+                {
+                    return m_MemoryBudget == 0 ||
+                           m_InFlightMemory == 0 ||
+                           m_InFlightMemory + entry.second.m_MemoryEstimate <= m_MemoryBudget;
+                }
+            };
+            const auto it{ std::ranges::find_if(m_Queue, fits) };
+            if (it == m_Queue.end())
+            {
+                // Picked up again once running work releases its memory
+                ++m_DeferredTasks;
+                return;
+            }
+
+            if (!m_ThreadBudget.TryAcquire(this))
+            {
+                // Picked up again once any pool releases a thread
+                ++m_DeferredTasks;
+                return;
+            }
+
+            queued = it->second;
+            m_Queue.erase(it);
+
+            m_InFlightMemory += queued.m_MemoryEstimate;
+            m_PeakInFlightMemory = std::max(m_PeakInFlightMemory, m_InFlightMemory);
+        }
+
+        QRunnable* work{ queued.m_Work };
+
+        // Read before running, the work may delete itself otherwise
+        const bool auto_delete{ work->autoDelete() };
+
+        m_ActiveThreads.fetch_add(1, std::memory_order_relaxed);
+        work->run();
+        m_ActiveThreads.fetch_sub(1, std::memory_order_relaxed);
+        m_FinishedWork.fetch_add(1, std::memory_order_relaxed);
+
+        if (auto_delete)
+        {
+            delete work;
+        }
+
+        m_ThreadBudget.Release(this);
+
+        if (queued.m_MemoryEstimate > 0)
+        {
+            {
+                TRACY_SCOPED_LOCK(m_QueueMutex);
+                m_InFlightMemory -= queued.m_MemoryEstimate;
+            }
+            RestartDeferred();
+        }
+    }
+
+    TRACY_DECLARE_MUTEX(std::mutex, m_QueueMutex);
+    Queue m_Queue;
+    uint32_t m_PeakQueued{ 0 };
+    bool m_Paused{ false };
+
+    uint64_t m_MemoryBudget{ 0 };
+    uint64_t m_InFlightMemory{ 0 };
+    uint64_t m_PeakInFlightMemory{ 0 };
+    size_t m_DeferredTasks{ 0 };
+
+    std::atomic_uint32_t m_ActiveThreads{ 0 };
+    std::atomic_uint64_t m_FinishedWork{ 0 };
+
+    SharedThreadBudget& m_ThreadBudget;
+    QThreadPool m_Pool;
+};
+
+void SharedThreadBudget::RestartPools(std::span<PrioritizedPool* const> pools)
+{
+    for (PrioritizedPool* pool : pools)
+    {
+        pool->RestartDeferred();
+    }
+}
+
+static PrioritizedPool& GetPool(WorkerPool pool)
+{
+    static std::array<PrioritizedPool, magic_enum::enum_count<WorkerPool>()> s_Pools{};
+    return s_Pools[magic_enum::enum_integer(pool)];
+}
+
+void ApplyMaxWorkerThreads(uint32_t max_worker_threads)
+{
+    max_worker_threads = std::max(max_worker_threads, 1u);
+
+    const uint32_t preview_threads{ std::max(max_worker_threads / 4, 1u) };
+    const uint32_t crop_threads{ std::max(max_worker_threads - preview_threads, 1u) };
+    const uint32_t pdf_threads{ max_worker_threads };
+    const uint32_t download_threads{ std::max(max_worker_threads / 2, 1u) };
+
+    GetPool(WorkerPool::Crop).SetMaxThreads(crop_threads);
+    GetPool(WorkerPool::Preview).SetMaxThreads(preview_threads);
+    GetPool(WorkerPool::Pdf).SetMaxThreads(pdf_threads);
+    GetPool(WorkerPool::Download).SetMaxThreads(download_threads);
+
+    // Previews keep their threads for themselves, unless that would leave no thread
+    // for the other pools at all
+    const uint32_t reserved_preview_threads{ std::min(preview_threads, max_worker_threads - 1) };
+    GetThreadBudget().SetMaxThreads(max_worker_threads, &GetPool(WorkerPool::Preview), reserved_preview_threads);
+
+    LogInfo("Worker threads: {} in total, {} reserved for preview, at most {} crop, {} preview, {} pdf, {} download",
+            max_worker_threads,
+            reserved_preview_threads,
+            crop_threads,
+            preview_threads,
+            pdf_threads,
+            download_threads);
+}
+
+void ApplyMaxWorkerMemory(uint32_t max_worker_memory)
+{
+    SetWorkerPoolMemoryBudget(WorkerPool::Crop, uint64_t{ max_worker_memory } * 1024 * 1024);
+
+    if (max_worker_memory > 0)
+    {
+        LogInfo("Crop work memory budget: {} MiB", max_worker_memory);
+    }
+}
+
+void SetWorkerPoolMemoryBudget(WorkerPool pool, uint64_t memory_budget)
+{
+    GetPool(pool).SetMemoryBudget(memory_budget);
+}
+
+void StartWork(WorkerPool pool, QRunnable* work, int priority, uint64_t memory_estimate)
+{
+    GetPool(pool).Start(work, priority, memory_estimate);
+}
+
+void StartWork(WorkerPool pool, std::function<void()> work, int priority, uint64_t memory_estimate)
+{
+    StartWork(pool, QRunnable::create(std::move(work)), priority, memory_estimate);
+}
+
+bool ReprioritizeWork(WorkerPool pool, QRunnable* work, int priority)
+{
+    return GetPool(pool).Reprioritize(work, priority);
+}
+
+void PauseWorkerPool(WorkerPool pool)
+{
+    GetPool(pool).Pause();
+}
+
+void ResumeWorkerPool(WorkerPool pool)
+{
+    GetPool(pool).Resume();
+}
+
+bool TryTakeWork(WorkerPool pool, QRunnable* work)
+{
+    return GetPool(pool).TryTake(work);
+}
+
+WorkerPoolStats GetWorkerPoolStats(WorkerPool pool)
+{
+    return GetPool(pool).Stats(false);
+}
+
+void LogWorkerPoolStats(std::string_view reason)
+{
+    static constexpr uint64_t c_MiB{ 1024 * 1024 };
+
+    for (const WorkerPool pool : magic_enum::enum_values<WorkerPool>())
+    {
+        const WorkerPoolStats stats{ GetPool(pool).Stats(true) };
+        LogInfo("{} - {} pool{}: {}/{} threads active ({:.0f}%), {} queued, {} peak queued, {} finished",
+                reason,
+                magic_enum::enum_name(pool),
+                stats.m_Paused ? " (paused)" : "",
+                stats.m_ActiveThreads,
+                stats.m_MaxThreads,
+                stats.Utilization() * 100.0f,
+                stats.m_QueuedWork,
+                stats.m_PeakQueuedWork,
+                stats.m_FinishedWork);
+        if (stats.m_MemoryBudget > 0)
+        {
+            LogInfo("{} - {} pool: {} MiB in flight, {} MiB peak, {} MiB budget",
+                    reason,
+                    magic_enum::enum_name(pool),
+                    stats.m_InFlightMemory / c_MiB,
+                    stats.m_PeakInFlightMemory / c_MiB,
+                    stats.m_MemoryBudget / c_MiB);
+        }
+    }
+}
@@ -20,7 +20,7 @@ SemanticVersion ProxyPdfToSemanticVersion(std::string_view version);
 
 consteval uint64_t ImageCacheFormatVersion()
 {
-    constexpr char c_Version[8]{ 'P', 'P', 'P', '0', '0', '0', '0', '6' };
+    constexpr char c_Version[8]{ 'P', 'P', 'P', '0', '0', '0', '0', '7' };
     return std::bit_cast<uint64_t>(c_Version);
 }
 
@@ -29,9 +29,10 @@ consteval std::string_view JsonFormatVersion()
     return "PPP00009";
 }
 
-consteval std::string_view ImageDbFormatVersion()
+consteval uint64_t ImageDbFormatVersion()
 {
-    return "PPP00002";
+    constexpr char c_Version[8]{ 'P', 'P', 'P', '0', '0', '0', '0', '4' };
+    return std::bit_cast<uint64_t>(c_Version);
 }
 
 consteval std::string_view ConfigFormatVersion()
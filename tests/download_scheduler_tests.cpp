@@ -0,0 +1,233 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QHostAddress>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include <ppp/plugins/download_scheduler.hpp>
+
+// Minimal http server, answers each request after a delay, while tracking how many
+// requests it was handling at once
+class StandInServer : public QTcpServer
+{
+  public:
+    StandInServer(std::chrono::milliseconds delay)
+        : m_Delay{ delay }
+    {
+        QObject::connect(this,
+                         &QTcpServer::newConnection,
+                         this,
+                         [this]()
+                         {
+                             while (QTcpSocket* socket{ nextPendingConnection() })
+                             {
+                                 QObject::connect(socket,
+                                                  &QTcpSocket::readyRead,
+                                                  socket,
+                                                  [this, socket]()
+                                                  { Read(socket); });
+                             }
+                         });
+        listen(QHostAddress::LocalHost);
+    }
+
+    QString Url(const QString& path) const
+    {
+        return QString{ "http://127.0.0.1:%1/%2" }.arg(serverPort()).arg(path);
+    }
+
+    // Status codes to answer with before answering with 200, one per request
+    std::vector<int> m_FailFirst;
+
+    uint32_t m_Requests{ 0 };
+    uint32_t m_Active{ 0 };
+    uint32_t m_PeakActive{ 0 };
+
+  private:
+    void Read(QTcpSocket* socket)
+    {
+        QByteArray& request{ m_Buffers[socket] };
+        request += socket->readAll();
+        if (!request.contains("\r\n\r\n"))
+        {
+            return;
+        }
+        request.clear();
+
+        ++m_Requests;
+        ++m_Active;
+        m_PeakActive = std::max(m_PeakActive, m_Active);
+
+        int status{ 200 };
+        if (!m_FailFirst.empty())
+        {
+            status = m_FailFirst.front();
+            m_FailFirst.erase(m_FailFirst.begin());
+        }
+
+        QTimer::singleShot(m_Delay,
+                           socket,
+                           [this, socket, status]()
+                           {
+                               --m_Active;
+
+                               const QByteArray body{ "card" };
+                               socket->write(QString{ "HTTP/1.1 %1 Status\r\n"
+                                                      "Content-Length: %2\r\n"
+                                                      "Connection: close\r\n\r\n" }
+                                                 .arg(status)
+                                                 .arg(body.size())
+                                                 .toUtf8());
+                               socket->write(body);
+                               socket->disconnectFromHost();
+                           });
+    }
+
+    std::chrono::milliseconds m_Delay;
+    std::unordered_map<QTcpSocket*, QByteArray> m_Buffers;
+};
+
+// Network requests need an application to run their event loop
+struct TestApplication
+{
+    int m_Argc{ 1 };
+    char m_Name[16]{ "download_tests" };
+    char* m_Argv[1]{ m_Name };
+    QCoreApplication m_App{ m_Argc, m_Argv };
+};
+
+// Runs the event loop until the given number of requests finished
+static void WaitForRequests(DownloadScheduler& scheduler, uint64_t num_requests)
+{
+    QEventLoop loop;
+    QObject::connect(&scheduler,
+                     &DownloadScheduler::RequestFinished,
+                     &loop,
+                     [&](uint64_t finished, uint64_t)
+                     {
+                         if (finished == num_requests)
+                         {
+                             loop.quit();
+                         }
+                     });
+    QTimer::singleShot(std::chrono::seconds{ 10 }, &loop, &QEventLoop::quit);
+    loop.exec();
+}
+
+TEST_CASE("Download scheduler keeps requests within the in-flight window", "[download_scheduler_window]")
+{
+    TestApplication app;
+
+    StandInServer server{ std::chrono::milliseconds{ 50 } };
+    REQUIRE(server.isListening());
+
+    QNetworkAccessManager network_manager;
+    DownloadScheduler scheduler{ network_manager };
+    scheduler.SetHostPolicy("127.0.0.1",
+                            DownloadHostPolicy{
+                                .m_MaxInFlight = 2,
+                            });
+
+    uint32_t succeeded{ 0 };
+    for (int i = 0; i < 8; i++)
+    {
+        scheduler.Get(DownloadScheduler::MakeRequest(server.Url(QString::number(i))),
+                      [&](QNetworkReply* reply)
+                      {
+                          if (reply->error() == QNetworkReply::NoError && reply->readAll() == "card")
+                          {
+                              ++succeeded;
+                          }
+                      });
+    }
+    WaitForRequests(scheduler, 8);
+
+    REQUIRE(succeeded == 8);
+    REQUIRE(server.m_PeakActive == 2);
+
+    const DownloadSchedulerStats stats{ scheduler.GetStats() };
+    REQUIRE(stats.m_Finished == 8);
+    REQUIRE(stats.m_PeakInFlight == 2);
+    REQUIRE(stats.m_InFlight == 0);
+    REQUIRE(stats.m_BytesReceived == 8 * 4);
+}
+
+TEST_CASE("Download scheduler limits the request rate", "[download_scheduler_rate]")
+{
+    TestApplication app;
+
+    StandInServer server{ std::chrono::milliseconds{ 0 } };
+    REQUIRE(server.isListening());
+
+    QNetworkAccessManager network_manager;
+    DownloadScheduler scheduler{ network_manager };
+    scheduler.SetHostPolicy("127.0.0.1",
+                            DownloadHostPolicy{
+                                .m_MaxInFlight = 8,
+                                .m_RequestsPerSecond = 20.0f,
+                                .m_Burst = 1,
+                            });
+
+    const auto start_point{ std::chrono::high_resolution_clock::now() };
+    for (int i = 0; i < 5; i++)
+    {
+        scheduler.Get(DownloadScheduler::MakeRequest(server.Url(QString::number(i))),
+                      [](QNetworkReply*) {});
+    }
+    WaitForRequests(scheduler, 5);
+    const auto duration{ std::chrono::high_resolution_clock::now() - start_point };
+
+    // The first request uses the initial token, the remaining four wait 50ms each
+    REQUIRE(server.m_Requests == 5);
+    REQUIRE(duration >= std::chrono::milliseconds{ 190 });
+}
+
+TEST_CASE("Download scheduler retries transient errors", "[download_scheduler_retry]")
+{
+    TestApplication app;
+
+    StandInServer server{ std::chrono::milliseconds{ 0 } };
+    REQUIRE(server.isListening());
+    server.m_FailFirst = { 503, 429, 404 };
+
+    QNetworkAccessManager network_manager;
+    DownloadScheduler scheduler{ network_manager };
+    scheduler.SetHostPolicy("127.0.0.1",
+                            DownloadHostPolicy{
+                                .m_MaxInFlight = 1,
+                                .m_MaxRetries = 3,
+                                .m_RetryBackoff{ 10 },
+                            });
+
+    std::vector<QNetworkReply::NetworkError> errors;
+    for (int i = 0; i < 2; i++)
+    {
+        scheduler.Get(DownloadScheduler::MakeRequest(server.Url(QString::number(i))),
+                      [&](QNetworkReply* reply)
+                      {
+                          errors.push_back(reply->error());
+                      });
+    }
+    WaitForRequests(scheduler, 2);
+
+    // Both requests fail with a retryable error first, the retry of one of them then
+    // fails with an error that is not worth retrying
+    REQUIRE(server.m_Requests == 4);
+    REQUIRE(std::ranges::count(errors, QNetworkReply::NoError) == 1);
+    REQUIRE(std::ranges::count(errors, QNetworkReply::ContentNotFoundError) == 1);
+
+    const DownloadSchedulerStats stats{ scheduler.GetStats() };
+    REQUIRE(stats.m_Retried == 2);
+    REQUIRE(stats.m_Failed == 1);
+}
@@ -0,0 +1,99 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <fstream>
+
+#include <ppp/project/image_database.hpp>
+
+TEST_CASE("Hash missing source", "[image_db_hash_missing]")
+{
+    std::atexit(
+        []()
+        {
+            fs::remove("hash_missing.db");
+        });
+
+    ImageDataBase image_db{ ImageDataBase::FromFile("hash_missing.db") };
+    REQUIRE(image_db.HashSource("does_not_exist.png").isEmpty());
+}
+
+TEST_CASE("Hash source", "[image_db_hash]")
+{
+    fs::copy_file("fallback.png", "hash_source.png", fs::copy_options::overwrite_existing);
+    std::atexit(
+        []()
+        {
+            fs::remove("hash_source.png");
+            fs::remove("hash_source.db");
+        });
+
+    ImageDataBase image_db{ ImageDataBase::FromFile("hash_source.db") };
+
+    const QByteArray hash{ image_db.HashSource("hash_source.png") };
+    REQUIRE_FALSE(hash.isEmpty());
+    REQUIRE(image_db.HashSource("hash_source.png") == hash);
+
+    std::ofstream{ "hash_source.png", std::ios::app | std::ios::binary } << "modified";
+    REQUIRE(image_db.HashSource("hash_source.png") != hash);
+}
+
+TEST_CASE("Test entries against source hash", "[image_db_test_entry]")
+{
+    fs::copy_file("fallback.png", "test_entry_source.png", fs::copy_options::overwrite_existing);
+    fs::copy_file("fallback.png", "test_entry_destination.png", fs::copy_options::overwrite_existing);
+    std::atexit(
+        []()
+        {
+            fs::remove("test_entry_source.png");
+            fs::remove("test_entry_destination.png");
+            fs::remove("test_entry.db");
+        });
+
+    ImageDataBase image_db{ ImageDataBase::FromFile("test_entry.db") };
+
+    const ImageParameters params{};
+    QByteArray hash{ image_db.TestEntry("test_entry_destination.png", "test_entry_source.png", params) };
+    REQUIRE_FALSE(hash.isEmpty());
+
+    image_db.PutEntry("test_entry_destination.png", hash, params);
+    REQUIRE(image_db.TestEntry("test_entry_destination.png", "test_entry_source.png", params).isEmpty());
+
+    ImageParameters changed_params{};
+    changed_params.m_Rotation = Image::Rotation::Degree90;
+    REQUIRE(image_db.TestEntry("test_entry_destination.png", "test_entry_source.png", changed_params) == hash);
+}
+
+TEST_CASE("Entries survive reloading", "[image_db_reload]")
+{
+    fs::copy_file("fallback.png", "reload_source.png", fs::copy_options::overwrite_existing);
+    fs::copy_file("fallback.png", "reload_destination.png", fs::copy_options::overwrite_existing);
+    std::atexit(
+        []()
+        {
+            fs::remove("reload_source.png");
+            fs::remove("reload_destination.png");
+            fs::remove("reload.db");
+        });
+
+    const ImageParameters params{};
+    {
+        ImageDataBase image_db{ ImageDataBase::FromFile("reload.db") };
+        const QByteArray hash{ image_db.TestEntry("reload_destination.png", "reload_source.png", params) };
+        REQUIRE_FALSE(hash.isEmpty());
+
+        // Put the same entry a few times, only the last one should survive compaction
+        image_db.PutEntry("reload_destination.png", QByteArray(16, 'x'), params);
+        image_db.PutEntry("reload_destination.png", hash, params);
+    }
+
+    {
+        ImageDataBase image_db{ ImageDataBase::FromFile("reload.db") };
+        REQUIRE(image_db.FindEntry("reload_destination.png"));
+        REQUIRE(image_db.TestEntry("reload_destination.png", "reload_source.png", params).isEmpty());
+        image_db.Write();
+    }
+
+    {
+        ImageDataBase image_db{ ImageDataBase::FromFile("reload.db") };
+        REQUIRE(image_db.TestEntry("reload_destination.png", "reload_source.png", params).isEmpty());
+    }
+}
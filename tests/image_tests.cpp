@@ -1,7 +1,20 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
 
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include <ppp/color_cube_lut.hpp>
 #include <ppp/constants.hpp>
 #include <ppp/image.hpp>
+#include <ppp/image_allocator.hpp>
 #include <ppp/project/image_ops.hpp>
 
 Image g_BaseImage{};
@@ -73,7 +86,7 @@ TEST_CASE("Apply color cube", "[image_color_cube]")
 {
     {
         const cv::Mat vibrance_cube{ LoadColorCube("Foils Vibrance.CUBE") };
-        const Image filtered_image{ g_BaseImage.ApplyColorCube(vibrance_cube) };
+        const Image filtered_image{ g_BaseImage.ApplyColorCube(ColorCubeLut{ vibrance_cube }) };
         REQUIRE(filtered_image.Width() == 248_pix);
         REQUIRE(filtered_image.Height() == 322_pix);
 
@@ -87,7 +100,7 @@ TEST_CASE("Apply color cube", "[image_color_cube]")
 
     {
         const cv::Mat madness_cube{ LoadColorCube("madness.CUBE") };
-        const Image filtered_image{ g_BaseImage.ApplyColorCube(madness_cube) };
+        const Image filtered_image{ g_BaseImage.ApplyColorCube(ColorCubeLut{ madness_cube }) };
         REQUIRE(filtered_image.Width() == 248_pix);
         REQUIRE(filtered_image.Height() == 322_pix);
 
@@ -100,6 +113,156 @@ TEST_CASE("Apply color cube", "[image_color_cube]")
     }
 }
 
+// Straight-forward per-pixel implementation that color cubes used to be applied with,
+// kept as a reference for correctness and performance of Image::ApplyColorCube
+static Image ApplyColorCubeReference(const Image& image, const cv::Mat& color_cube)
+{
+    const cv::Mat& input{ image.GetUnderlying() };
+    cv::Mat output{ input.clone() };
+
+    const int cube_size_minus_one{ color_cube.cols - 1 };
+    for (int y = 0; y < input.rows; y++)
+    {
+        for (int x = 0; x < input.cols; x++)
+        {
+            const uchar* col{ input.ptr<uchar>(y) + x * input.channels() };
+            uchar* out_col{ output.ptr<uchar>(y) + x * output.channels() };
+
+            const float r{ (static_cast<float>(col[2]) / 255) * cube_size_minus_one };
+            const float g{ (static_cast<float>(col[1]) / 255) * cube_size_minus_one };
+            const float b{ (static_cast<float>(col[0]) / 255) * cube_size_minus_one };
+
+#ifdef NDEBUG
+            const int r_lo{ static_cast<int>(std::floor(r)) };
+            const int r_hi{ static_cast<int>(std::ceil(r)) };
+            const float r_frac{ r - static_cast<float>(r_lo) };
+            const int g_lo{ static_cast<int>(std::floor(g)) };
+            const int g_hi{ static_cast<int>(std::ceil(g)) };
+            const float g_frac{ g - static_cast<float>(g_lo) };
+            const int b_lo{ static_cast<int>(std::floor(b)) };
+            const int b_hi{ static_cast<int>(std::ceil(b)) };
+            const float b_frac{ b - static_cast<float>(b_lo) };
+
+            for (int c = 0; c < 3; c++)
+            {
+                const auto at{
+                    [&](int r, int g, int b)
+                    {
+                        return static_cast<float>(color_cube.at<cv::Vec3b>(r, g, b)[c]);
+                    }
+                };
+                const auto lerp{
+                    [](float from, float to, float alpha)
+                    {
+                        return from * (1 - alpha) + to * alpha;
+                    }
+                };
+
+                const float lo_b{ lerp(lerp(at(r_lo, g_lo, b_lo), at(r_hi, g_lo, b_lo), r_frac),
+                                       lerp(at(r_lo, g_hi, b_lo), at(r_hi, g_hi, b_lo), r_frac),
+                                       g_frac) };
+                const float hi_b{ lerp(lerp(at(r_lo, g_lo, b_hi), at(r_hi, g_lo, b_hi), r_frac),
+                                       lerp(at(r_lo, g_hi, b_hi), at(r_hi, g_hi, b_hi), r_frac),
+                                       g_frac) };
+                out_col[c] = static_cast<uchar>(lerp(lo_b, hi_b, b_frac));
+            }
+#else
+            const auto res{ color_cube.at<cv::Vec3b>((int)r, (int)g, (int)b) };
+            out_col[0] = res[0];
+            out_col[1] = res[1];
+            out_col[2] = res[2];
+#endif
+        }
+    }
+
+    return Image{ std::move(output) };
+}
+
+TEST_CASE("Color cube matches reference implementation", "[image_color_cube_reference]")
+{
+    const cv::Mat madness_cube{ LoadColorCube("madness.CUBE") };
+    const ColorCubeLut madness_lut{ madness_cube };
+
+    for (const Image& image : { g_BaseImage, g_BaseImage.EnsureAlpha(), g_BaseImage.Crop(15_pix, 15_pix, 15_pix, 15_pix) })
+    {
+        const Image filtered_image{ image.ApplyColorCube(madness_lut) };
+        const Image reference_image{ ApplyColorCubeReference(image, madness_cube) };
+        REQUIRE(cv::norm(filtered_image.GetUnderlying(), reference_image.GetUnderlying(), cv::NORM_INF) == 0);
+    }
+}
+
+TEST_CASE("Cancelled color cube produces no image", "[image_color_cube_cancel]")
+{
+    const ColorCubeLut madness_lut{ LoadColorCube("madness.CUBE") };
+
+    std::atomic_bool cancelled{ true };
+    REQUIRE_FALSE(g_BaseImage.ApplyColorCube(madness_lut, CancellationToken{ &cancelled }).Valid());
+
+    cancelled = false;
+    REQUIRE(g_BaseImage.ApplyColorCube(madness_lut, CancellationToken{ &cancelled }).Valid());
+}
+
+TEST_CASE("Color cube benchmark", "[.][image_color_cube_benchmark]")
+{
+    const cv::Mat vibrance_cube{ LoadColorCube("Foils Vibrance.CUBE") };
+    const ColorCubeLut vibrance_lut{ vibrance_cube };
+
+    // Roughly the size of a card at 1200 dpi
+    const Image large_image{ Image::Read("fallback.png").EnsureAlpha().Resize({ 3000_pix, 4200_pix }) };
+
+    BENCHMARK("Reference")
+    {
+        return ApplyColorCubeReference(large_image, vibrance_cube);
+    };
+
+    BENCHMARK("ApplyColorCube")
+    {
+        return large_image.ApplyColorCube(vibrance_lut);
+    };
+}
+
+TEST_CASE("Pooled allocator recycles image buffers", "[image_allocator]")
+{
+    InstallPooledImageAllocator();
+
+    const ImageAllocatorStats before{ GetImageAllocatorStats() };
+    {
+        const Image first{ g_BaseImage.EnsureAlpha().Resize({ 600_pix, 800_pix }) };
+    }
+    {
+        const Image second{ g_BaseImage.EnsureAlpha().Resize({ 600_pix, 800_pix }) };
+    }
+    const ImageAllocatorStats after{ GetImageAllocatorStats() };
+
+    REQUIRE(after.m_Hits > before.m_Hits);
+    REQUIRE(after.m_BytesRecycled >= before.m_BytesRecycled + 600 * 800 * 4);
+
+    TrimImageAllocator();
+    REQUIRE(GetImageAllocatorStats().m_BytesPooled == 0);
+}
+
+TEST_CASE("Round corners and fill them again", "[image_round_corners]")
+{
+    const Image rounded_image{ g_BaseImage.RoundCorners({ 2.48_in, 3.22_in }, 0.1_in) };
+    const cv::Mat& rounded{ rounded_image.GetUnderlying() };
+    REQUIRE(rounded.channels() == 4);
+    REQUIRE(rounded.at<cv::Vec4b>(0, 0)[3] == 0);
+    REQUIRE(rounded.at<cv::Vec4b>(rounded.rows - 1, rounded.cols - 1)[3] == 0);
+    REQUIRE(rounded.at<cv::Vec4b>(rounded.rows / 2, 0)[3] == 255);
+    REQUIRE(rounded.at<cv::Vec4b>(0, rounded.cols / 2)[3] == 255);
+
+    const Image filled_image{ rounded_image.FillHoles() };
+    const cv::Mat& filled{ filled_image.GetUnderlying() };
+    std::vector<cv::Mat> channels;
+    cv::split(filled, channels);
+    REQUIRE(cv::countNonZero(channels[3] != 255) == 0);
+
+    // Nothing outside the corners is touched
+    const cv::Rect center{ 10, 10, rounded.cols - 20, rounded.rows - 20 };
+    const Image base_image{ g_BaseImage.EnsureAlpha() };
+    REQUIRE(cv::norm(rounded(center), base_image.GetUnderlying()(center), cv::NORM_INF) == 0);
+}
+
 TEST_CASE("Shrink image", "[image_resize_shrink]")
 {
     const Image resized_image{ g_BaseImage.Resize({ 50_pix, 50_pix }) };
@@ -132,6 +295,163 @@ inline Size GetCardSize(const CardSizeInfo& card_size_info)
     }
 }
 
+TEST_CASE("Png files contain their density", "[image_write_png_density]")
+{
+    const fs::path png_path{ "density_test.png" };
+    REQUIRE(g_BaseImage.Write(png_path, 3, std::nullopt, { 2.48_in, 3.22_in }));
+
+    std::ifstream png_file{ png_path, std::ios::binary };
+    const std::vector<char> png_buf{ std::istreambuf_iterator<char>{ png_file }, std::istreambuf_iterator<char>{} };
+    png_file.close();
+
+    // pHYs directly follows signature and IHDR
+    REQUIRE(png_buf.size() > 33 + 21);
+    REQUIRE(std::string_view{ png_buf.data() + 33 + 4, 4 } == "pHYs");
+
+    uint32_t dots_per_meter{};
+    std::memcpy(&dots_per_meter, png_buf.data() + 33 + 8, 4);
+    REQUIRE(std::byteswap(dots_per_meter) == static_cast<uint32_t>(g_BaseImage.Density({ 2.48_in, 3.22_in }).value));
+
+    const Image read_image{ Image::Read(png_path) };
+    REQUIRE(cv::norm(read_image.GetUnderlying(), g_BaseImage.GetUnderlying(), cv::NORM_INF) == 0);
+
+    fs::remove(png_path);
+}
+
+// How Image::Write used to add the density to pngs, kept as a reference for performance
+static bool WritePngWithDensityReference(const Image& image, const fs::path& path, ::Size dimensions)
+{
+    std::vector<uchar> buf;
+    if (!cv::imencode(".png", image.GetUnderlying(), buf, { cv::IMWRITE_PNG_COMPRESSION, 3 }))
+    {
+        return false;
+    }
+
+    size_t idat_idx{};
+    for (size_t j = 0; j < buf.size() - 4; j++)
+    {
+        if (std::string_view{ reinterpret_cast<const char*>(&buf[j]), 4 } == "IDAT")
+        {
+            idat_idx = j - 4;
+            break;
+        }
+    }
+
+    // Contents don't matter for performance, only size
+    const uint32_t dots_per_meter{ static_cast<uint32_t>(image.Density(dimensions).value) };
+    std::array<uchar, 21> phys_buf{};
+    std::memcpy(phys_buf.data() + 8, &dots_per_meter, 4);
+    buf.insert(buf.begin() + idat_idx, phys_buf.begin(), phys_buf.end());
+
+    if (FILE * file{ fopen(path.string().c_str(), "wb") })
+    {
+        fwrite(buf.data(), 1, buf.size(), file);
+        fclose(file);
+    }
+
+    cv::imdecode(buf, cv::IMREAD_UNCHANGED);
+    return true;
+}
+
+TEST_CASE("Png write benchmark", "[.][image_write_png_benchmark]")
+{
+    // Roughly the size of a card at 1200 dpi
+    const Image large_image{ Image::Read("fallback.png").Resize({ 3000_pix, 4200_pix }) };
+    const ::Size large_image_size{ 2.5_in, 3.5_in };
+    const fs::path png_path{ "png_benchmark.png" };
+
+    BENCHMARK("Reference")
+    {
+        return WritePngWithDensityReference(large_image, png_path, large_image_size);
+    };
+
+    BENCHMARK("Write")
+    {
+        return large_image.Write(png_path, 3, std::nullopt, large_image_size);
+    };
+
+    fs::remove(png_path);
+}
+
+TEST_CASE("Intermediate images read back unchanged", "[image_intermediate]")
+{
+    const fs::path intermediate_path{ "intermediate_test.png" };
+    for (const Image& image : { g_BaseImage, g_BaseImage.EnsureAlpha() })
+    {
+        REQUIRE(image.WriteIntermediate(intermediate_path, IntermediateImageFormat::Zstd, { 2.48_in, 3.22_in }));
+
+        const ImageMetaData meta_data{ Image::ReadMetaData(intermediate_path) };
+        REQUIRE(meta_data.Width() == image.Width());
+        REQUIRE(meta_data.Height() == image.Height());
+
+        const Image read_image{ Image::Read(intermediate_path) };
+        REQUIRE(read_image.GetUnderlying().type() == image.GetUnderlying().type());
+        REQUIRE(cv::norm(read_image.GetUnderlying(), image.GetUnderlying(), cv::NORM_INF) == 0);
+    }
+    fs::remove(intermediate_path);
+}
+
+TEST_CASE("Intermediate jpg images stay jpg", "[image_intermediate_jpg]")
+{
+    const fs::path intermediate_path{ "intermediate_test.jpg" };
+    REQUIRE(g_BaseImage.WriteIntermediate(intermediate_path, IntermediateImageFormat::Zstd, { 2.48_in, 3.22_in }));
+
+    {
+        std::ifstream file{ intermediate_path, std::ios::binary };
+        std::array<char, 2> start_of_image{};
+        REQUIRE(file.read(start_of_image.data(), start_of_image.size()));
+        REQUIRE(static_cast<uint8_t>(start_of_image[0]) == 0xFF);
+        REQUIRE(static_cast<uint8_t>(start_of_image[1]) == 0xD8);
+    }
+    fs::remove(intermediate_path);
+}
+
+TEST_CASE("Decoded 16-bit images become 8-bit", "[image_decode_16bit]")
+{
+    cv::Mat wide_image{};
+    g_BaseImage.GetUnderlying().convertTo(wide_image, CV_MAKETYPE(CV_16U, g_BaseImage.GetUnderlying().channels()), 256.0);
+
+    std::vector<uchar> buf;
+    REQUIRE(cv::imencode(".png", wide_image, buf));
+
+    const Image decoded_image{ Image::Decode(std::as_bytes(std::span{ buf })) };
+    REQUIRE(decoded_image.GetUnderlying().depth() == CV_8U);
+    REQUIRE(cv::norm(decoded_image.GetUnderlying(), g_BaseImage.GetUnderlying(), cv::NORM_INF) <= 1);
+}
+
+TEST_CASE("Intermediate image benchmark", "[.][image_intermediate_benchmark]")
+{
+    // Roughly the size of a card at 1200 dpi
+    const Image large_image{ Image::Read("fallback.png").Resize({ 3000_pix, 4200_pix }) };
+    const ::Size large_image_size{ 2.5_in, 3.5_in };
+
+    const fs::path png_path{ "intermediate_benchmark.png" };
+    const fs::path zstd_path{ "intermediate_benchmark_zstd.png" };
+
+    BENCHMARK("Write Png")
+    {
+        return large_image.WriteIntermediate(png_path, IntermediateImageFormat::Png, large_image_size);
+    };
+
+    BENCHMARK("Write Zstd")
+    {
+        return large_image.WriteIntermediate(zstd_path, IntermediateImageFormat::Zstd, large_image_size);
+    };
+
+    BENCHMARK("Read Png")
+    {
+        return Image::Read(png_path);
+    };
+
+    BENCHMARK("Read Zstd")
+    {
+        return Image::Read(zstd_path);
+    };
+
+    fs::remove(png_path);
+    fs::remove(zstd_path);
+}
+
 TEST_CASE("Calculate DPI", "[image_dpi]")
 {
     const auto card_size_info{ g_Cfg.m_CardSizes.at("Standard") };
@@ -1,8 +1,20 @@
 #include <catch2/catch_test_macros.hpp>
 
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <ppp/image.hpp>
 #include <ppp/pdf/generate.hpp>
 #include <ppp/project/project.hpp>
 
+static std::string ReadFile(const fs::path& path)
+{
+    std::ifstream file{ path, std::ios::binary };
+    return std::string{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+}
+
 TEST_CASE("Generate empty pdf", "[pdf_empty]")
 {
     const Config config{};
@@ -17,3 +29,75 @@ TEST_CASE("Generate empty pdf", "[pdf_empty]")
             fs::remove("empty.pdf");
         });
 }
+
+TEST_CASE("Generate streamed pdf", "[pdf_streamed]")
+{
+    fs::create_directories("pdf_streamed_images");
+    fs::copy_file("fallback.png", "pdf_streamed_images/card.png", fs::copy_options::overwrite_existing);
+
+    std::atexit(
+        []()
+        {
+            fs::remove_all("pdf_streamed_images");
+            fs::remove("pdf_streamed.cache");
+            fs::remove("streamed.pdf");
+        });
+
+    // Without a base pdf the document is streamed to a temporary file and moved in place
+    const Config config{};
+    Project project{ config };
+    project.m_Data.m_ImageDir = "pdf_streamed_images";
+    project.m_Data.m_CropDir = "pdf_streamed_images/crop";
+    project.m_Data.m_UncropDir = "pdf_streamed_images/uncrop";
+    project.m_Data.m_ImageCache = "pdf_streamed.cache";
+    project.m_Data.m_FileName = "streamed.pdf";
+    REQUIRE(project.m_Data.m_BasePdf == "None");
+    REQUIRE_NOTHROW(project.Init());
+
+    const PdfResults results{ GeneratePdf(project, config) };
+    REQUIRE(fs::exists(results.m_FrontsidePdf));
+
+    const std::string pdf{ ReadFile(results.m_FrontsidePdf) };
+    REQUIRE(pdf.starts_with("%PDF-"));
+    REQUIRE(pdf.find("%%EOF") != std::string::npos);
+
+    for (const auto& entry : fs::directory_iterator{ "." })
+    {
+        const std::string file_name{ entry.path().filename().string() };
+        REQUIRE_FALSE((file_name.starts_with("streamed.pdf.") && file_name.ends_with(".tmp")));
+    }
+}
+
+TEST_CASE("Lossy images are embedded as they are", "[pdf_jpg_passthrough]")
+{
+    fs::create_directories("pdf_jpg_images");
+    REQUIRE(Image::Read("fallback.png").Write("pdf_jpg_images/card.jpg"));
+
+    std::atexit(
+        []()
+        {
+            fs::remove_all("pdf_jpg_images");
+            fs::remove("pdf_jpg.cache");
+            fs::remove("jpg_passthrough.pdf");
+        });
+
+    // Lossy compression without a quality override and no rotation, so nothing needs re-encoding
+    const Config config{};
+    REQUIRE(config.m_PdfImageCompression == ImageCompression::Lossy);
+    REQUIRE_FALSE(config.m_JpgQuality.has_value());
+
+    Project project{ config };
+    project.m_Data.m_ImageDir = "pdf_jpg_images";
+    project.m_Data.m_CropDir = "pdf_jpg_images/crop";
+    project.m_Data.m_UncropDir = "pdf_jpg_images/uncrop";
+    project.m_Data.m_ImageCache = "pdf_jpg.cache";
+    project.m_Data.m_FileName = "jpg_passthrough.pdf";
+    REQUIRE_NOTHROW(project.Init());
+
+    const PdfResults results{ GeneratePdf(project, config) };
+
+    const std::string jpg{ ReadFile("pdf_jpg_images/card.jpg") };
+    const std::string pdf{ ReadFile(results.m_FrontsidePdf) };
+    REQUIRE_FALSE(jpg.empty());
+    REQUIRE(pdf.find(jpg) != std::string::npos);
+}
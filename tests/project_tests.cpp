@@ -111,3 +111,48 @@ TEST_CASE("Non-empty project can be loaded", "[project_load_non_empty]")
     Project project{ config };
     REQUIRE_NOTHROW(project.Load("non_empty_project.json"));
 }
+
+TEST_CASE("Card lookup stays consistent", "[project_card_lookup]")
+{
+    fs::create_directories("lookup_images");
+    fs::copy_file("fallback.png", "lookup_images/card.png", fs::copy_options::overwrite_existing);
+    fs::copy_file("fallback.png", "lookup_images/__back_card.png", fs::copy_options::overwrite_existing);
+    fs::copy_file("fallback.png", "lookup_images/other.png", fs::copy_options::overwrite_existing);
+
+    std::atexit(
+        []()
+        {
+            fs::remove_all("lookup_images");
+            fs::remove("lookup_project.cache");
+        });
+
+    const Config& config{};
+    Project project{ config };
+    project.m_Data.m_ImageDir = "lookup_images";
+    project.m_Data.m_CropDir = "lookup_images/crop";
+    project.m_Data.m_UncropDir = "lookup_images/uncrop";
+    project.m_Data.m_ImageCache = "lookup_project.cache";
+    REQUIRE_NOTHROW(project.Init());
+
+    REQUIRE(project.HasCard("card.png"));
+    REQUIRE(project.FindCardByStem("other") == project.FindCard("other.png"));
+    REQUIRE(project.FindCard("card.png")->m_Backside == fs::path{ "__back_card.png" });
+    REQUIRE(project.m_Data.FindFrontsides("__back_card.png").size() == 1);
+
+    project.CardRenamed("__back_card.png", "__back_renamed.png");
+    REQUIRE_FALSE(project.HasCard("__back_card.png"));
+    REQUIRE(project.HasCardByStem("__back_renamed"));
+    REQUIRE(project.m_Data.FindFrontsides("__back_card.png").empty());
+
+    project.CardRenamed("other.png", "renamed.png");
+    REQUIRE_FALSE(project.HasCard("other.png"));
+    REQUIRE(project.FindCardByStem("renamed") == project.FindCard("renamed.png"));
+    REQUIRE(project.FindCard("card.png") != nullptr);
+
+    // Renames erase and insert single cards, which must leave the same index as a rebuild
+    for (const CardInfo& card : project.m_Data.m_Cards)
+    {
+        REQUIRE(project.FindCard(card.m_Name) == &card);
+        REQUIRE(project.m_Data.FindCardsByStem(card.Stem()).size() == 1);
+    }
+}
@@ -0,0 +1,257 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <latch>
+#include <mutex>
+#include <vector>
+
+#include <QRunnable>
+
+#include <ppp/worker_pools.hpp>
+
+TEST_CASE("Worker pools run queued work by priority", "[worker_pools_priority]")
+{
+    ApplyMaxWorkerThreads(1);
+
+    // Occupy the only crop thread, so that everything after is queued
+    std::latch blocker_started{ 1 };
+    std::latch release_blocker{ 1 };
+    StartWork(WorkerPool::Crop,
+              [&]()
+              {
+                  blocker_started.count_down();
+                  release_blocker.wait();
+              });
+    blocker_started.wait();
+
+    std::mutex order_mutex;
+    std::vector<int> order;
+    std::latch all_done{ 3 };
+    const auto push_work{
+        [&](int id, int priority)
+        {
+            StartWork(
+                WorkerPool::Crop,
+                [&, id]()
+                {
+                    {
+                        std::lock_guard lock{ order_mutex };
+                        order.push_back(id);
+                    }
+                    all_done.count_down();
+                },
+                priority);
+        }
+    };
+    push_work(0, 0);
+    push_work(1, 1);
+    push_work(2, 0);
+
+    REQUIRE(GetWorkerPoolStats(WorkerPool::Crop).m_QueuedWork == 3);
+    REQUIRE(GetWorkerPoolStats(WorkerPool::Crop).m_ActiveThreads == 1);
+
+    release_blocker.count_down();
+    all_done.wait();
+
+    REQUIRE(order == std::vector<int>{ 1, 0, 2 });
+}
+
+TEST_CASE("Worker pools allow taking back queued work", "[worker_pools_take]")
+{
+    ApplyMaxWorkerThreads(1);
+
+    std::latch blocker_started{ 1 };
+    std::latch release_blocker{ 1 };
+    StartWork(WorkerPool::Preview,
+              [&]()
+              {
+                  blocker_started.count_down();
+                  release_blocker.wait();
+              });
+    blocker_started.wait();
+
+    bool ran{ false };
+    QRunnable* work{ QRunnable::create([&]()
+                                       { ran = true; }) };
+    work->setAutoDelete(false);
+
+    StartWork(WorkerPool::Preview, work);
+    REQUIRE(TryTakeWork(WorkerPool::Preview, work));
+    REQUIRE_FALSE(TryTakeWork(WorkerPool::Preview, work));
+    REQUIRE(GetWorkerPoolStats(WorkerPool::Preview).m_QueuedWork == 0);
+
+    release_blocker.count_down();
+
+    work->run();
+    REQUIRE(ran);
+    delete work;
+}
+
+TEST_CASE("Paused worker pools park work without occupying threads", "[worker_pools_pause]")
+{
+    ApplyMaxWorkerThreads(1);
+
+    PauseWorkerPool(WorkerPool::Download);
+
+    std::mutex order_mutex;
+    std::vector<int> order;
+    std::latch all_done{ 2 };
+    for (int id : { 0, 1 })
+    {
+        StartWork(
+            WorkerPool::Download,
+            [&, id]()
+            {
+                {
+                    std::lock_guard lock{ order_mutex };
+                    order.push_back(id);
+                }
+                all_done.count_down();
+            },
+            id);
+    }
+
+    const WorkerPoolStats paused_stats{ GetWorkerPoolStats(WorkerPool::Download) };
+    REQUIRE(paused_stats.m_Paused);
+    REQUIRE(paused_stats.m_QueuedWork == 2);
+
+    ResumeWorkerPool(WorkerPool::Download);
+    all_done.wait();
+
+    REQUIRE(order == std::vector<int>{ 1, 0 });
+}
+
+TEST_CASE("Worker pools reprioritize queued work", "[worker_pools_reprioritize]")
+{
+    ApplyMaxWorkerThreads(1);
+
+    PauseWorkerPool(WorkerPool::Pdf);
+
+    std::mutex order_mutex;
+    std::vector<int> order;
+    std::latch all_done{ 3 };
+    std::vector<QRunnable*> work;
+    for (int id : { 0, 1, 2 })
+    {
+        work.push_back(QRunnable::create(
+            [&, id]()
+            {
+                {
+                    std::lock_guard lock{ order_mutex };
+                    order.push_back(id);
+                }
+                all_done.count_down();
+            }));
+        StartWork(WorkerPool::Pdf, work.back());
+    }
+
+    REQUIRE(ReprioritizeWork(WorkerPool::Pdf, work[2], 1));
+
+    ResumeWorkerPool(WorkerPool::Pdf);
+    all_done.wait();
+
+    REQUIRE(order == std::vector<int>{ 2, 0, 1 });
+}
+
+TEST_CASE("Worker pools admit work within their memory budget", "[worker_pools_memory]")
+{
+    ApplyMaxWorkerThreads(4);
+    SetWorkerPoolMemoryBudget(WorkerPool::Download, 100);
+
+    std::latch first_started{ 1 };
+    std::latch release_first{ 1 };
+    StartWork(
+        WorkerPool::Download,
+        [&]()
+        {
+            first_started.count_down();
+            release_first.wait();
+        },
+        0,
+        80);
+    first_started.wait();
+
+    std::latch second_done{ 1 };
+    StartWork(
+        WorkerPool::Download,
+        [&]()
+        { second_done.count_down(); },
+        0,
+        80);
+
+    const WorkerPoolStats stats{ GetWorkerPoolStats(WorkerPool::Download) };
+    REQUIRE(stats.m_QueuedWork == 1);
+    REQUIRE(stats.m_InFlightMemory == 80);
+
+    release_first.count_down();
+    second_done.wait();
+
+    REQUIRE(GetWorkerPoolStats(WorkerPool::Download).m_PeakInFlightMemory == 80);
+
+    SetWorkerPoolMemoryBudget(WorkerPool::Download, 0);
+}
+
+TEST_CASE("Worker pools share one thread budget", "[worker_pools_budget]")
+{
+    ApplyMaxWorkerThreads(1);
+
+    std::latch blocker_started{ 1 };
+    std::latch release_blocker{ 1 };
+    StartWork(WorkerPool::Crop,
+              [&]()
+              {
+                  blocker_started.count_down();
+                  release_blocker.wait();
+              });
+    blocker_started.wait();
+
+    // The pdf pool has a thread of its own, but the only thread of the budget is taken
+    std::latch pdf_done{ 1 };
+    StartWork(WorkerPool::Pdf,
+              [&]()
+              { pdf_done.count_down(); });
+
+    const WorkerPoolStats stats{ GetWorkerPoolStats(WorkerPool::Pdf) };
+    REQUIRE(stats.m_QueuedWork == 1);
+    REQUIRE(stats.m_ActiveThreads == 0);
+
+    release_blocker.count_down();
+    pdf_done.wait();
+
+    REQUIRE(GetWorkerPoolStats(WorkerPool::Pdf).m_QueuedWork == 0);
+}
+
+TEST_CASE("Worker pools reserve threads for previews", "[worker_pools_preview_reserve]")
+{
+    // One thread is reserved for previews, the other pools share the other three
+    ApplyMaxWorkerThreads(4);
+
+    std::latch blockers_started{ 3 };
+    std::latch release_blockers{ 1 };
+    for (int i = 0; i < 3; i++)
+    {
+        StartWork(WorkerPool::Crop,
+                  [&]()
+                  {
+                      blockers_started.count_down();
+                      release_blockers.wait();
+                  });
+    }
+    blockers_started.wait();
+
+    std::latch pdf_done{ 1 };
+    StartWork(WorkerPool::Pdf,
+              [&]()
+              { pdf_done.count_down(); });
+    REQUIRE(GetWorkerPoolStats(WorkerPool::Pdf).m_QueuedWork == 1);
+
+    std::latch preview_done{ 1 };
+    StartWork(WorkerPool::Preview,
+              [&]()
+              { preview_done.count_down(); });
+    preview_done.wait();
+
+    REQUIRE(GetWorkerPoolStats(WorkerPool::Pdf).m_QueuedWork == 1);
+
+    release_blockers.count_down();
+    pdf_done.wait();
+}